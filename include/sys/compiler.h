@@ -49,12 +49,10 @@
 
 #endif
 
-#ifdef __8080__
-#define __DISABLE_BUILTIN
-#endif
-
-#ifdef __8085__
-#define __DISABLE_BUILTIN
+#if __8080__ || __8085__
+// memset() and memcpy() are expanded with loops, the others need ldi/cpi
+#define __DISABLE_BUILTIN_STRCPY
+#define __DISABLE_BUILTIN_STRCHR
 #endif
 
 #if __SDCC && __GBZ80__
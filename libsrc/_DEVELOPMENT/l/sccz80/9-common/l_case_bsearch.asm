@@ -0,0 +1,102 @@
+;       Small C+ Z80 Run time library
+;       Switch by a binary search of the cases
+
+SECTION code_clib
+SECTION code_l_sccz80
+
+PUBLIC l_case_bsearch
+
+; Entry: hl = value to switch on
+;       (sp) = switch table (i.e. the return address):
+;
+;              defw number of cases
+;              defw default address
+;              defw case value, case address, ...
+;
+;       The cases are sorted by their value taken as unsigned
+
+l_case_bsearch:
+
+   ld d,h
+   ld e,l                      ; de = switch value
+   pop hl                      ; hl = & switch_table
+
+   ld c,(hl)
+   inc hl
+   ld b,(hl)                   ; bc = number of cases
+   inc hl
+   push hl                     ; save & default address
+   inc hl
+   inc hl                      ; hl = & first case
+
+loop:
+
+   ; hl = & first case still possible, bc = number of them
+
+   ld a,b
+   or c
+   jr z, default
+
+   ld a,b
+   or a
+   rra
+   ld b,a
+   ld a,c
+   rra
+   ld c,a                      ; bc = number / 2, carry = number was odd
+   push af
+   push hl
+
+   add hl,bc
+   add hl,bc
+   add hl,bc
+   add hl,bc                   ; hl = & middle case
+   inc hl
+
+   ld a,d
+   cp (hl)
+   jr nz, decided
+   dec hl
+   ld a,e
+   cp (hl)
+   inc hl
+   jr z, found
+
+decided:
+
+   jr c, lower
+
+   inc hl
+   inc hl
+   inc hl                      ; hl = & case after the middle one
+   pop af
+   pop af
+   jr c, loop                  ; number - number / 2 - 1 cases left
+   dec bc
+   jr loop
+
+lower:
+
+   pop hl                      ; number / 2 cases left from the same first case
+   pop af
+   jr loop
+
+found:
+
+   pop af
+   pop af
+   pop af
+   inc hl                      ; hl = & case address
+   jr jump
+
+default:
+
+   pop hl                      ; hl = & default address
+
+jump:
+
+   ld a,(hl)
+   inc hl
+   ld h,(hl)
+   ld l,a
+   jp (hl)
@@ -0,0 +1,39 @@
+;       Small C+ Z80 Run time library
+;       Switch on a char through a jump table indexed by the value
+
+SECTION code_clib
+SECTION code_l_sccz80
+
+PUBLIC l_case_char_table
+
+; Entry: a = value to switch on
+;       (sp) = jump table (i.e. the return address):
+;
+;              defb lowest case value, number of entries
+;              defw default address
+;              defw case address, ...   (default address for the gaps)
+
+l_case_char_table:
+
+   pop hl                      ; hl = & jump_table
+
+   sub (hl)                    ; a = switch value - lowest case value
+   inc hl
+   cp (hl)
+   inc hl                      ; hl = & default address
+   jr nc, jump                 ; outside the table
+
+   inc hl
+   inc hl
+   ld e,a
+   ld d,0
+   add hl,de
+   add hl,de                   ; hl = & case address
+
+jump:
+
+   ld a,(hl)
+   inc hl
+   ld h,(hl)
+   ld l,a
+   jp (hl)
@@ -0,0 +1,51 @@
+;       Small C+ Z80 Run time library
+;       Switch through a jump table indexed by the value
+
+SECTION code_clib
+SECTION code_l_sccz80
+
+PUBLIC l_case_table
+
+; Entry: hl = value to switch on
+;       (sp) = jump table (i.e. the return address):
+;
+;              defw lowest case value
+;              defw number of entries
+;              defw default address
+;              defw case address, ...   (default address for the gaps)
+
+l_case_table:
+
+   ld d,h
+   ld e,l                      ; de = switch value
+   pop hl                      ; hl = & jump_table
+
+   ld a,e
+   sub (hl)
+   ld e,a
+   inc hl
+   ld a,d
+   sbc a,(hl)
+   ld d,a                      ; de = switch value - lowest case value
+   inc hl
+
+   ld a,e
+   sub (hl)
+   inc hl
+   ld a,d
+   sbc a,(hl)
+   inc hl                      ; hl = & default address
+   jr nc, jump                 ; outside the table
+
+   inc hl
+   inc hl
+   add hl,de
+   add hl,de                   ; hl = & case address
+
+jump:
+
+   ld a,(hl)
+   inc hl
+   ld h,(hl)
+   ld l,a
+   jp (hl)
@@ -66,7 +66,7 @@ l0_small_divs_16_16x16:
    
    ld a,b
    xor c
-   jp m, l_neg_hl              ; negate quotient
+   call m, l_neg_hl            ; negate quotient if signs different
    
    bit 7,b
    ret z                       ; if dividend was positive
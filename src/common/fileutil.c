@@ -629,13 +629,25 @@ argv_t *path_find_glob(const char *pattern)
 	return files;
 }
 
+static int try_mkdir(const char *path)
+{
+#ifdef _WIN32
+	return _mkdir(path_os(path));
+#else
+	return mkdir(path_os(path), 0777);
+#endif
+}
+
 void path_mkdir(const char *path)
 {
 	path = path_canon(path);
 	if (!dir_exists(path)) {
 		const char *parent = path_dir(path);
 		path_mkdir(parent);
-		xmkdir(path);
+
+		// another process may have created it meanwhile, e.g. a z80asm -j job
+		if (try_mkdir(path) != 0 && !dir_exists(path))
+			xmkdir(path);			// report the error
 	}
 }
 
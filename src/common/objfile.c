@@ -200,6 +200,8 @@ void symbol_free(symbol_t* self)
 //-----------------------------------------------------------------------------
 // expressions
 //-----------------------------------------------------------------------------
+static UT_icd ut_byte_icd = { sizeof(byte_t),NULL,NULL,NULL };
+
 expr_t* expr_new()
 {
 	expr_t* self = xnew(expr_t);
@@ -213,6 +215,9 @@ expr_t* expr_new()
 	self->filename = utstr_new();
 	self->line_num = 0;
 
+	utarray_new(self->rpn, &ut_byte_icd);
+	self->rpn_names = argv_new();
+
 	self->next = self->prev = NULL;
 
 	return self;
@@ -223,15 +228,70 @@ void expr_free(expr_t* self)
 	utstr_free(self->text);
 	utstr_free(self->target_name);
 	utstr_free(self->filename);
+	utarray_free(self->rpn);
+	argv_free(self->rpn_names);
 	xfree(self);
 }
 
+// size of the arguments that follow an RPN code
+static int rpn_args_size(byte_t code)
+{
+	switch (code) {
+	case RPN_NUMBER:	return 4;
+	case RPN_NUMBER64:	return 8;
+	case RPN_SYMBOL:	return 2;
+	default:			return 0;
+	}
+}
+
+// index of name in names, appended if not there yet
+static int names_index(argv_t* names, const char* name)
+{
+	int index = 0;
+	for (char** p = argv_front(names); p < argv_back(names); p++, index++) {
+		if (strcmp(*p, name) == 0)
+			return index;
+	}
+	argv_push(names, name);
+	return index;
+}
+
+// copy RPN code to out, translating symbol indices into from_names to indices
+// into to_names; return false if the code is malformed
+static bool rpn_translate(UT_array* out, const byte_t* code, int size,
+	argv_t* from_names, argv_t* to_names)
+{
+	int i = 0;
+	while (i < size) {
+		byte_t c = code[i++];
+		int args_size = rpn_args_size(c);
+		if (i + args_size > size)
+			return false;
+
+		utarray_push_back(out, &c);
+		if (c == RPN_SYMBOL) {
+			int index = code[i] | (code[i + 1] << 8);
+			if (index >= (int)argv_len(from_names))
+				return false;
+
+			index = names_index(to_names, argv_get(from_names, index));
+			byte_t lo = index & 0xFF, hi = (index >> 8) & 0xFF;
+			utarray_push_back(out, &lo);
+			utarray_push_back(out, &hi);
+		}
+		else {
+			for (int j = 0; j < args_size; j++)
+				utarray_push_back(out, &code[i + j]);
+		}
+		i += args_size;
+	}
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // section
 //-----------------------------------------------------------------------------
 
-static UT_icd ut_byte_icd = { sizeof(byte_t),NULL,NULL,NULL };
-
 section_t* section_new()
 {
 	section_t* self = xnew(section_t);
@@ -494,6 +554,21 @@ static void objfile_read_exprs(objfile_t* obj, FILE* fp, long fpos_start, long f
 		printf("  Expressions:\n");
 
 	xfseek(fp, fpos_start, SEEK_SET);
+
+	// names referred to by the RPN code
+	argv_t* names = argv_new();
+	UT_string* name = utstr_new();
+	UT_array* code;
+	utarray_new(code, &ut_byte_icd);
+
+	if (obj->version >= 17) {
+		int num_names = xfread_word(fp);
+		for (int i = 0; i < num_names; i++) {
+			xfread_wcount_str(name, fp);
+			argv_push(names, utstr_body(name));
+		}
+	}
+
 	while (ftell(fp) < fpos_end) {
 		char type = xfread_byte(fp);
 		if (type == 0)
@@ -561,6 +636,18 @@ static void objfile_read_exprs(objfile_t* obj, FILE* fp, long fpos_start, long f
 					utstr_body(obj->filename));
 		}
 
+		if (obj->version >= 17) {
+			int size = xfread_word(fp);
+			utarray_resize(code, size);
+			if (size > 0)
+				xfread_bytes(utarray_front(code), size, fp);
+
+			if (!rpn_translate(expr->rpn, (byte_t*)utarray_front(code), size,
+				names, expr->rpn_names))
+				die("invalid expression code in file '%s'\n",
+					utstr_body(obj->filename));
+		}
+
 		if (show_expr)
 			printf("%s", utstr_body(expr->text));
 
@@ -576,6 +663,10 @@ static void objfile_read_exprs(objfile_t* obj, FILE* fp, long fpos_start, long f
 		// insert in the list
 		DL_APPEND(expr->section->exprs, expr);
 	}
+
+	argv_free(names);
+	utstr_free(name);
+	utarray_free(code);
 }
 
 void objfile_read(objfile_t* obj, FILE* fp)
@@ -637,19 +728,35 @@ void objfile_read(objfile_t* obj, FILE* fp)
 //-----------------------------------------------------------------------------
 // object file write
 //-----------------------------------------------------------------------------
-static long objfile_write_exprs1(objfile_t* obj, FILE* fp, UT_string* last_filename, UT_string* empty)
+static long objfile_write_exprs1(objfile_t* obj, FILE* fp, UT_string* last_filename, UT_string* empty,
+	argv_t* names, UT_array* code)
 {
 	long fpos0 = ftell(fp);					// start of expressions area
 	bool has_exprs = false;
 
+	// collect names referred to by the RPN code
 	section_t* section;
 	DL_FOREACH(obj->sections, section) {
-		utstr_clear(last_filename);
-
 		expr_t* expr;
 		DL_FOREACH(section->exprs, expr) {
 			has_exprs = true;
+			for (char** p = argv_front(expr->rpn_names); p < argv_back(expr->rpn_names); p++)
+				names_index(names, *p);
+		}
+	}
 
+	if (!has_exprs)
+		return -1;
+
+	xfwrite_word((int)argv_len(names), fp);
+	for (char** p = argv_front(names); p < argv_back(names); p++)
+		xfwrite_wcount_cstr(*p, fp);
+
+	DL_FOREACH(obj->sections, section) {
+		utstr_clear(last_filename);
+
+		expr_t* expr;
+		DL_FOREACH(section->exprs, expr) {
 			// store type
 			xfwrite_byte(expr->type, fp);
 
@@ -669,26 +776,33 @@ static long objfile_write_exprs1(objfile_t* obj, FILE* fp, UT_string* last_filen
 			xfwrite_word(expr->patch_ptr, fp);				// patchptr
 			xfwrite_wcount_str(expr->target_name, fp);		// target symbol for expression
 			xfwrite_wcount_str(expr->text, fp);				// expression
+
+			// RPN code, empty if read from an older version
+			utarray_clear(code);
+			rpn_translate(code, (byte_t*)utarray_front(expr->rpn), utarray_len(expr->rpn),
+				expr->rpn_names, names);
+			xfwrite_wcount_bytes(utarray_front(code), utarray_len(code), fp);
 		}
 	}
 
-	if (has_exprs) {
-		xfwrite_byte(0, fp);			// store end-terminator
-		return fpos0;
-	}
-	else
-		return -1;
+	xfwrite_byte(0, fp);			// store end-terminator
+	return fpos0;
 }
 
 static long objfile_write_exprs(objfile_t* obj, FILE* fp)
 {
 	UT_string* last_filename = utstr_new();
 	UT_string* empty = utstr_new();
+	argv_t* names = argv_new();
+	UT_array* code;
+	utarray_new(code, &ut_byte_icd);
 
-	long ret = objfile_write_exprs1(obj, fp, last_filename, empty);
+	long ret = objfile_write_exprs1(obj, fp, last_filename, empty, names, code);
 
 	utstr_free(last_filename);
 	utstr_free(empty);
+	argv_free(names);
+	utarray_free(code);
 	return ret;
 }
 
@@ -1105,6 +1219,13 @@ static void obj_rename_symbol(objfile_t* obj, const char* old_name, const char*
 				utstr_set(expr->target_name, new_name);
 			}
 
+			for (char** p = argv_front(expr->rpn_names); p < argv_back(expr->rpn_names); p++) {
+				if (strcmp(*p, old_name) == 0) {
+					argv_set(expr->rpn_names, p - argv_front(expr->rpn_names), new_name);
+					break;
+				}
+			}
+
 			char* p = NULL;
 			size_t n = 0;
 			while (n < utstr_len(expr->text) &&
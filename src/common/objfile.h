@@ -14,7 +14,7 @@
 #include <stdio.h>
 
 #define MIN_VERSION				1
-#define MAX_VERSION				16
+#define MAX_VERSION				17
 #define CUR_VERSION				MAX_VERSION
 #define SIGNATURE_SIZE			8
 #define SIGNATURE_OBJ			"Z80RMF"
@@ -22,6 +22,14 @@
 #define SIGNATURE_VERS			"%02d"
 #define DEFAULT_ALIGN_FILLER	0xFF
 
+// expression RPN code, version 17 and up: one byte per operand or operator,
+// operands followed by their little-endian arguments, any other byte is an
+// operator without arguments (see z80asm expr_def.h)
+#define RPN_ASMPC				'$'		// ASMPC
+#define RPN_NUMBER				'k'		// dword constant
+#define RPN_NUMBER64			'K'		// constant wider than a dword: low dword, high dword
+#define RPN_SYMBOL				's'		// word index into the name table
+
 extern byte_t opt_obj_align_filler;
 extern bool opt_obj_verbose;
 extern bool opt_obj_list;
@@ -77,6 +85,9 @@ typedef struct expr_s
 	UT_string* filename;
 	int		 line_num;
 
+	UT_array* rpn;					// RPN code, symbols indexed in rpn_names
+	argv_t*	 rpn_names;				// names referred to by the RPN code
+
 	struct expr_s* next, * prev;
 } expr_t;
 
@@ -50,8 +50,33 @@ struct onode {
     struct lnode *o_old, *o_new;
     struct onode* o_next;
     long firecount;
+    int o_index;              /* position in opts list */
+    char* o_prefix;           /* literal text at start of last pattern line */
+    int o_prefix_len;
+    struct onode* o_bucket;   /* next rule in same index bucket */
 }* opts = 0, *activerule = 0;
 
+/* rules are indexed by the first word of the literal prefix of their last
+   pattern line, e.g. "\tld\t"; rules without such a prefix are kept in
+   rules_any and tried on every line */
+#define RSIZE 211
+struct rnode {
+    char* r_key;
+    int r_key_len;
+    struct onode *r_first, *r_last;
+    struct rnode* r_next;
+}* rtab[RSIZE] = { 0 };
+struct onode *rules_any = 0, *rules_any_last = 0;
+
+/* compiled regular expressions, keyed by the installed pattern text */
+#ifdef USE_REGEXP
+struct xnode {
+    char* x_text;
+    regex_t x_reg;
+    struct xnode* x_next;
+}* xtab[HSIZE] = { 0 };
+#endif
+
 void printlines(struct lnode* beg, struct lnode* end, FILE* out)
 {
     struct lnode* p;
@@ -122,6 +147,36 @@ char* install(char* str)
     return (p->h_str);
 }
 
+#ifdef USE_REGEXP
+/* compile_regex - return compiled regex, compile only on first use */
+regex_t* compile_regex(char* re, char* start)
+{
+    struct xnode* x;
+    char errbuf[MAXLINE];
+    int i, reerr;
+
+    re = install(re); /* installed strings can be compared by pointer */
+    i = (int)(((size_t)re >> 3) % HSIZE);
+    for (x = xtab[i]; x; x = x->x_next)
+        if (x->x_text == re)
+            return &x->x_reg;
+
+    x = (struct xnode*)malloc(sizeof *x);
+    if (x == NULL)
+        error("compile_regex: out of memory\n");
+    reerr = regcomp(&x->x_reg, re, REG_EXTENDED);
+    if (reerr != 0) {
+        regerror(reerr, &x->x_reg, errbuf, sizeof(errbuf));
+        fprintf(stderr, "error in \"%s\": %s\n", start, errbuf);
+        error("error: invalid rule\n");
+    }
+    x->x_text = re;
+    x->x_next = xtab[i];
+    xtab[i] = x;
+    return &x->x_reg;
+}
+#endif
+
 /* insert - insert a new node with text s before node p */
 void insert(char* s, struct lnode* p)
 {
@@ -205,6 +260,177 @@ void init(FILE* fp)
     *next = 0;
 }
 
+/* is_directive - check for a rule line that does not match an input line */
+int is_directive(char* text)
+{
+    return strncmp(text, "%check", 6) == 0
+        || strncmp(text, "%notopt", 7) == 0
+        || strncmp(text, "%opt", 4) == 0
+        || strncmp(text, "%notcpu", 7) == 0
+        || strncmp(text, "%cpu", 4) == 0
+        || strncmp(text, "%eval", 5) == 0
+        || strncmp(text, "%title", 6) == 0;
+}
+
+/* key_len - length of first word of s including the blank after it, 0 if none */
+int key_len(char* s, int len)
+{
+    int i = 0;
+
+    while (i < len && isspace(s[i]))
+        ++i;
+    if (i == len || isspace(s[i]))
+        return 0;
+    while (i < len && !isspace(s[i]))
+        ++i;
+    return i < len ? i + 1 : 0;
+}
+
+/* key_hash - hash of the first len chars of s */
+int key_hash(char* s, int len)
+{
+    int i, h = 0;
+
+    for (i = 0; i < len; i++)
+        h += s[i];
+    return abs(h) % RSIZE;
+}
+
+/* find_bucket - return index bucket of rules for input line, NULL if none */
+struct rnode* find_bucket(char* text)
+{
+    struct rnode* b;
+    int len = key_len(text, strlen(text));
+
+    if (len == 0)
+        return 0;
+    for (b = rtab[key_hash(text, len)]; b; b = b->r_next)
+        if (b->r_key_len == len && strncmp(b->r_key, text, len) == 0)
+            return b;
+    return 0;
+}
+
+/* compile_rule - compile the regular expressions of the pattern of rule o */
+void compile_rule(struct onode* o)
+{
+#ifdef USE_REGEXP
+    struct lnode* p;
+    char *s, *e, re[MAXLINE];
+
+    for (p = o->o_old; p; p = p->l_prev) {
+        for (s = p->l_text; (s = strstr(s, "%\"")) != NULL; s = e) {
+            for (e = s + 2; *e && (*e != '"' || e[-1] == '\\'); ++e)
+                ;
+            if (*e != '"' || e - s - 2 >= MAXLINE)
+                break;
+            strncpy(re, s + 2, e - s - 2);
+            re[e - s - 2] = '\0';
+            compile_regex(re, p->l_text);
+        }
+    }
+#endif
+}
+
+/* index_rules - number the rules and group them by the first word of the
+   literal text of their last pattern line */
+void index_rules()
+{
+    char prefix[MAXLINE], *s;
+    struct rnode *b, *bnext;
+    struct lnode* p;
+    struct onode* o;
+    int i, len, klen, h;
+
+    for (i = 0; i < RSIZE; i++) {
+        for (b = rtab[i]; b; b = bnext) {
+            bnext = b->r_next;
+            free(b);
+        }
+        rtab[i] = 0;
+    }
+    rules_any = rules_any_last = 0;
+
+    for (o = opts, i = 0; o; o = o->o_next, i++) {
+        o->o_index = i;
+        o->o_bucket = 0;
+
+        /* the first line matched against the input */
+        for (p = o->o_old; p && is_directive(p->l_text); p = p->l_prev)
+            ;
+
+        /* literal text up to the first variable */
+        len = 0;
+        for (s = p ? p->l_text : ""; *s && len < MAXLINE - 1; s++) {
+            if (s[0] == '%' && s[1] == '%')
+                ++s;
+            else if (s[0] == '%')
+                break;
+            prefix[len++] = *s;
+        }
+        prefix[len] = '\0';
+        o->o_prefix = install(prefix);
+        o->o_prefix_len = len;
+
+        klen = key_len(prefix, len);
+        if (klen == 0) {
+            if (rules_any_last)
+                rules_any_last->o_bucket = o;
+            else
+                rules_any = o;
+            rules_any_last = o;
+        } else {
+            h = key_hash(prefix, klen);
+            for (b = rtab[h]; b; b = b->r_next)
+                if (b->r_key_len == klen && strncmp(b->r_key, prefix, klen) == 0)
+                    break;
+            if (b == NULL) {
+                b = (struct rnode*)malloc(sizeof *b);
+                if (b == NULL)
+                    error("index_rules: out of memory\n");
+                b->r_key = o->o_prefix;
+                b->r_key_len = klen;
+                b->r_first = b->r_last = 0;
+                b->r_next = rtab[h];
+                rtab[h] = b;
+            }
+            if (b->r_last)
+                b->r_last->o_bucket = o;
+            else
+                b->r_first = o;
+            b->r_last = o;
+        }
+
+        compile_rule(o);
+    }
+}
+
+/* first_rules - start list of candidate rules for line r after rule number n */
+void first_rules(struct lnode* r, int n, struct onode** ob, struct onode** oa)
+{
+    struct rnode* b = find_bucket(r->l_text);
+
+    for (*ob = b ? b->r_first : 0; *ob && (*ob)->o_index <= n; *ob = (*ob)->o_bucket)
+        ;
+    for (*oa = rules_any; *oa && (*oa)->o_index <= n; *oa = (*oa)->o_bucket)
+        ;
+}
+
+/* next_rule - return next candidate rule in opts order, NULL at end */
+struct onode* next_rule(struct onode** ob, struct onode** oa)
+{
+    struct onode* o;
+
+    if (*ob && (*oa == 0 || (*ob)->o_index < (*oa)->o_index)) {
+        o = *ob;
+        *ob = o->o_bucket;
+    } else if (*oa) {
+        o = *oa;
+        *oa = o->o_bucket;
+    } else
+        o = 0;
+    return o;
+}
+
 /* match - check conditions in rules */
 /* format: %check min <= %n <= max */
 int check(char* pat, char** vars)
@@ -247,7 +473,7 @@ int match(char* ins, char* pat, char** vars)
 #ifdef USE_REGEXP
     char re[MAXLINE]; /* regular expression */
     char* istart = ins;
-    regex_t reg;
+    regex_t* reg;
 #define NMATCH 3
     regmatch_t match[NMATCH];
     char var;
@@ -285,22 +511,16 @@ int match(char* ins, char* pat, char** vars)
                 strncpy(re, pat + 2, p - pat - 2);
                 re[p - pat - 2] = '\0';
                 pat = p;
-                reerr = regcomp(&reg, re, REG_EXTENDED);
-                if (reerr != 0) {
-                    regerror(reerr, &reg, re, sizeof(re));
-                    fprintf(stderr, "error in \"%s\": %s\n", start, re);
-                    error("error: invalid rule\n");
-                }
+                reg = compile_regex(re, start);
                 eflags = 0;
                 if (ins != istart)
                     eflags |= REG_NOTBOL;
-                reerr = regexec(&reg, ins, NMATCH, match, eflags);
+                reerr = regexec(reg, ins, NMATCH, match, eflags);
                 if (reerr != 0 && reerr != REG_NOMATCH) {
-                    regerror(reerr, &reg, re, sizeof(re));
+                    regerror(reerr, reg, re, sizeof(re));
                     fprintf(stderr, "error in \"%s\": %s\n", start, re);
                     error("error: while matching REGEXP\n");
                 }
-                regfree(&reg);
                 if (reerr != 0 || match[0].rm_so != 0)
                     return 0; /* not matched */
                 mi = match[1].rm_eo == -1 ? 0 : 1; /* which match to use */
@@ -493,13 +713,16 @@ struct lnode* opt(struct lnode* r)
     char* vars[10];
     int i, lines;
     struct lnode *c, *p;
-    struct onode* o;
+    struct onode *o, *ob, *oa;
     static char* activated = "%activated ";
 
-    for (o = opts; o; o = o->o_next) {
+    first_rules(r, -1, &ob, &oa);
+    while ((o = next_rule(&ob, &oa)) != NULL) {
         activerule = o;
         if (o->firecount < 1)
             continue;
+        if (strncmp(r->l_text, o->o_prefix, o->o_prefix_len) != 0)
+            continue;
         c = r;
         p = o->o_old;
         if (p == 0)
@@ -633,6 +856,10 @@ struct lnode* opt(struct lnode* r)
             while (--lines && r->l_prev)
                 r = r->l_prev;
             global_again = 1; /* signalize changes */
+
+            /* continue with the rules after this one, including the new ones */
+            index_rules();
+            first_rules(r, o->o_index, &ob, &oa);
             continue;
         }
         if ( debug && strlen(titlebuf)) {
@@ -649,15 +876,39 @@ struct lnode* opt(struct lnode* r)
 
 /* #define _TESTING */
 
+/* optimize - apply the current rule set to the lines between head and tail */
+void optimize(struct lnode* head, struct lnode* tail)
+{
+    int pass;
+    struct lnode* p;
+
+    pass = 0;
+    do {
+        ++pass;
+        if (debug)
+            fprintf(stderr, "\n--- pass %d ---\n", pass);
+        global_again = 0;
+        for (p = head->l_next; p != tail; p = opt(p))
+            ;
+    } while (global_again && pass < MAX_PASS);
+
+    if (global_again) {
+        fprintf(stderr, "error: maximum of %d passes exceeded\n", MAX_PASS);
+        error("       check for recursive substitutions");
+    }
+}
+
 /* main - peephole optimizer */
+/* rule files separated by -s are applied in turn as independent rule sets,
+   as if piping the output of one copt run into the next */
 int main(int argc, char** argv)
 {
     FILE* fp;
 #ifdef _TESTING
     FILE* inp;
 #endif
-    int i, pass;
-    struct lnode head, *p, *opt(), tail;
+    int i;
+    struct lnode head, tail;
 
     for (i = 1; i < argc; i++)
         if (strcasecmp(argv[i], "-D") == 0)
@@ -668,10 +919,7 @@ int main(int argc, char** argv)
             int j = c_options_num++;
             c_options = realloc(c_options, c_options_num * sizeof(c_options[0]));
             c_options[j] = strdup(argv[i] + 2);
-        } else if ((fp = fopen(argv[i], "r")) == NULL)
-            error("copt: can't open patterns file\n");
-        else
-            init(fp);
+        }
 
 #ifdef _TESTING
     if ((inp = fopen("input.asm", "r")) == NULL)
@@ -683,20 +931,22 @@ int main(int argc, char** argv)
 #endif
     head.l_text = tail.l_text = "";
 
-    pass = 0;
+    i = 1;
     do {
-        ++pass;
-        if (debug)
-            fprintf(stderr, "\n--- pass %d ---\n", pass);
-        global_again = 0;
-        for (p = head.l_next; p != &tail; p = opt(p))
-            ;
-    } while (global_again && pass < MAX_PASS);
+        /* load rule files of this stage */
+        opts = 0;
+        for (; i < argc && strcmp(argv[i], "-s") != 0; i++)
+            if (strcasecmp(argv[i], "-D") == 0 || strncmp(argv[i], "-m", 2) == 0
+                || strncmp(argv[i], "-O", 2) == 0)
+                continue;
+            else if ((fp = fopen(argv[i], "r")) == NULL)
+                error("copt: can't open patterns file\n");
+            else
+                init(fp);
+        index_rules();
 
-    if (global_again) {
-        fprintf(stderr, "error: maximum of %d passes exceeded\n", MAX_PASS);
-        error("       check for recursive substitutions");
-    }
+        optimize(&head, &tail);
+    } while (i++ < argc);
 
     printlines(head.l_next, &tail, stdout);
     exit(0);
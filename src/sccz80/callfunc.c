@@ -356,10 +356,10 @@ void callfunction(SYMBOL *ptr, Type *fnptr_type)
         } else if ( strcmp(funcname,"__builtin_strchr") == 0 && !IS_808x() ) {
             gen_builtin_strchr(isconstarg[2] ? constargval[2] : -1);
             nargs = 0;
-        } else if ( strcmp(funcname, "__builtin_memset") == 0 && !IS_808x() ) {
+        } else if ( strcmp(funcname, "__builtin_memset") == 0 ) {
             gen_builtin_memset(isconstarg[2] ? constargval[2] : -1,  constargval[3]);
             nargs = 0;
-        } else if ( strcmp(funcname, "__builtin_memcpy") == 0 && !IS_808x() ) {
+        } else if ( strcmp(funcname, "__builtin_memcpy") == 0 ) {
             gen_builtin_memcpy(isconstarg[2] ? constargval[2] : -1,  constargval[3]);
             nargs = 0;
         } else if ( functype->flags & SHORTCALL ) {
@@ -94,12 +94,14 @@ extern void gen_emit_line(int);
 extern void gen_load_indirect(LVALUE *lval);
 extern void gen_load_static(SYMBOL *sym);
 extern void gen_store_static(SYMBOL *sym);
+extern int gen_register_variable_possible(Type *type);
+extern void gen_register_variable(SYMBOL *sym, int load_from_stack);
+extern int gen_register_variable_slot(void);
+extern int gen_unwind_register_variable(int slot, int newsp, Kind save, int saveaf, int usebc);
 extern void gen_load_constant_as_float(double value, Kind to, unsigned char isunsigned);
 extern void gen_leave_function(Kind save,char type, int incritical);
 extern int gen_push_function_argument(Kind expr, Type *type, int push_sdccchar);
-extern void gen_switch_preamble(Kind kind);
-extern void gen_switch_case(Kind kind, int64_t value, int label);
-extern void gen_switch_postamble(Kind kind);
+extern void gen_switch(Type *type, SW_TAB *swtab, int count, int default_label);
 extern void gen_jp_label(int label, int end_of_scope);
 extern void gen_save_pointer(LVALUE *lval);
 
@@ -233,6 +235,11 @@ extern int      dolabel(void);
 extern void     dogoto(void);
 extern void     goto_cleanup(void);
 
+/* insn.c */
+extern void     insn_outc(char c);
+extern void     insn_user_asm(int on);
+extern void     insn_flush(void);
+
 #include "io.h"
 extern void     discardbuffer(t_buffer *buf);
 
@@ -263,6 +270,7 @@ extern void     WriteDefined(char *sname, int value);
 
 extern int      c_notaltreg;
 extern int      c_cline_directive;
+extern int      c_insn_optimise;
 extern int      c_cpu;
 extern int      c_params_offset;
 extern int      c_fp_mantissa_bytes;
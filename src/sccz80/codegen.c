@@ -53,9 +53,13 @@ static void immed2(void);
 static void constbc(int32_t val);
 static void addbchl(int val);
 static void dcallrts(char *sname,Kind to);
+static void callrts_stack(char *sname, int bytes);
+static void dcallrts_stack(char *sname, Kind to, int bytes);
+static void call_helper(const char *name, int bytes);
+static void gen_load_register_variable(SYMBOL *sym);
+static void gen_store_register_variable(SYMBOL *sym);
 static void quikmult(int type, int32_t size, char preserve);
 static void threereg(void);
-static void fivereg(void);
 static void sixreg(void);
 static void loada(int n);
 static void setcond(int val);
@@ -67,6 +71,8 @@ static void setcond(int val);
 static int    donelibheader;
 static const char  *current_section = ""; /**< Name of the current section */
 static const char  *current_nspace = NULL;
+static SYMBOL *register_variable;       /**< The local held in ix */
+static int    register_variable_slot;   /**< Zsp of the caller's ix saved on the stack */
 
 /* Mappings between default library names - allows use of sdcc maths library with sccz80 */
 struct _mapping {
@@ -286,6 +292,10 @@ static void switch_namespace(char *name)
  */
 void gen_load_static(SYMBOL* sym)
 {
+    if ( sym->isregister ) {
+        gen_load_register_variable(sym);
+        return;
+    }
     switch_namespace(sym->ctype->namespace);
     if (sym->ctype->kind == KIND_CHAR) {
         if ( (sym->ctype->isunsigned) == 0 )  {
@@ -381,6 +391,10 @@ int getloc(SYMBOL* sym, int off)
 /*      static memory cell */
 void gen_store_static(SYMBOL* sym)
 {
+    if ( sym->isregister ) {
+        gen_store_register_variable(sym);
+        return;
+    }
     switch_namespace(sym->ctype->namespace);
     if (sym->ctype->kind == KIND_DOUBLE && c_fp_size > 4 ) {
         address(sym);
@@ -446,6 +460,183 @@ void gen_store_static(SYMBOL* sym)
     }
 }
 
+/*
+ * Register variables
+ *
+ * The first char, int or pointer local (or parameter) of a function that
+ * is declared register lives in ix rather than on the stack. ix belongs
+ * to the caller, so it's pushed where the variable comes into scope and
+ * popped by modstk() whenever the stack is unwound past that slot: at the
+ * end of the block, break, continue, goto and return. The long and
+ * floating point helpers take their arguments on the stack and don't
+ * preserve ix, so a second word is pushed after the caller's ix and the
+ * variable is copied there around the helpers that use it.
+ */
+
+/* The register variable, if it's still in scope */
+static SYMBOL *live_register_variable(void)
+{
+    if ( register_variable != NULL && register_variable < locptr && register_variable->isregister ) {
+        return register_variable;
+    }
+    return NULL;
+}
+
+/* Check whether a variable of this type can be kept in ix */
+int gen_register_variable_possible(Type *type)
+{
+    if ( IS_808x() || IS_GBZ80() || c_framepointer_is_ix == 1 ) {
+        return NO;
+    }
+    if ( currfn == NULL || (currfn->ctype->flags & NAKED) || live_register_variable() != NULL ) {
+        return NO;
+    }
+    if ( type->isvolatile ) {
+        return NO;
+    }
+    return type->kind == KIND_CHAR || type->kind == KIND_INT || type->kind == KIND_PTR;
+}
+
+/* Where the caller's ix is saved, 0 if there's no register variable */
+int gen_register_variable_slot(void)
+{
+    if ( live_register_variable() == NULL ) {
+        return 0;
+    }
+    return register_variable_slot;
+}
+
+void gen_register_variable(SYMBOL *sym, int load_from_stack)
+{
+    sym->isregister = YES;
+    register_variable = sym;
+    if ( load_from_stack ) {
+        /* Parameters arrive on the stack */
+        getloc(sym, 0);
+        if ( sym->ctype->kind == KIND_CHAR ) {
+            ol("ld\tl,(hl)");
+        } else {
+            ol("ld\ta,(hl)");
+            ol("inc\thl");
+            ol("ld\th,(hl)");
+            ol("ld\tl,a");
+        }
+    }
+    ol("push\tix");
+    Zsp -= 2;
+    register_variable_slot = Zsp;
+    ol("push\tix");
+    Zsp -= 2;
+    if ( load_from_stack ) {
+        gen_store_register_variable(sym);
+    }
+}
+
+/* Move the stack from Zsp to newsp, popping the caller's ix back if that
+   drops the slot it was saved in */
+int gen_unwind_register_variable(int slot, int newsp, Kind save, int saveaf, int usebc)
+{
+    int    sp = Zsp;
+
+    if ( slot != 0 && newsp > slot && Zsp <= slot ) {
+        Zsp = modstk(slot, save, saveaf, usebc);
+        ol("pop\tix");
+        Zsp += 2;
+    }
+    newsp = modstk(newsp, save, saveaf, usebc);
+    Zsp = sp;
+    return newsp;
+}
+
+/* Chars are kept extended to an int so loading is just a copy, the pop is
+   tagged so the rules that track what's on the stack leave it alone */
+static void gen_load_register_variable(SYMBOL *sym)
+{
+    ol("push\tix");
+    ol("pop\thl\t;ix");
+}
+
+/* hl is the value of the assignment so it's left alone */
+static void gen_store_register_variable(SYMBOL *sym)
+{
+    if ( sym->ctype->kind == KIND_CHAR ) {
+        ol("ld\tc,l");
+        if ( sym->ctype->isunsigned ) {
+            ol("ld\tb,0");
+        } else {
+            ol("ld\ta,l");
+            ol("rlca");
+            ol("sbc\ta,a");
+            ol("ld\tb,a");
+        }
+        ol("push\tbc");
+        ol("pop\tix");
+    } else {
+        ol("push\thl");
+        ol("pop\tix");
+    }
+}
+
+/* Helpers that leave ix alone (or don't return) */
+static const char *helpers_preserving_ix[] = {
+    "l_and", "l_asl", "l_asr", "l_asr_hl_by_e", "l_asr_u", "l_asr_u_hl_by_e",
+    "l_case", "l_case_bsearch", "l_case_char_table", "l_case_table", "l_com",
+    "l_debug_pop_frame", "l_debug_push_frame", "l_declong", "l_div", "l_div_u",
+    "l_eq", "l_farcall", "l_gchar", "l_ge", "l_getptr", "l_gint", "l_glong",
+    "l_gt", "l_i64_case", "l_inclong", "l_int2long_s", "l_jphl", "l_le",
+    "l_lneg", "l_long_case", "l_long_com", "l_long_neg", "l_lt", "l_mod",
+    "l_mod_u", "l_mult", "l_mult_u", "l_ne", "l_neg", "l_or", "l_pint",
+    "l_plong", "l_pop_ei", "l_push_di", "l_putptr", "l_sub", "l_sxt", "l_uge",
+    "l_ugt", "l_ule", "l_ult", "l_xor", NULL
+};
+
+/* bytes is how far the helper moves the stack up, Zsp is adjusted after
+   the call so that ix is reloaded from the right place */
+static void call_helper(const char *name, int bytes)
+{
+    int   i, save = NO;
+
+    /* Nothing to save once the variable's words have been popped */
+    if ( live_register_variable() != NULL && Zsp <= register_variable_slot - 2 ) {
+        save = YES;
+        for ( i = 0; helpers_preserving_ix[i] != NULL; i++ ) {
+            if ( strcmp(name, helpers_preserving_ix[i]) == 0 ) {
+                save = NO;
+                break;
+            }
+        }
+    }
+    /* The arguments are on top of the stack so ix can't be pushed there,
+       it's copied to the word pushed after the caller's ix instead. Only
+       the flags are changed either side of the call */
+    if ( save ) {
+        ol("push\tix");
+        ot("ld\tix,");
+        outdec(register_variable_slot - Zsp);
+        nl();
+        ol("add\tix,sp");
+        ol("ex\t(sp),hl");
+        ol("ld\t(ix+0),l");
+        ol("ld\t(ix+1),h");
+        ol("pop\thl");
+    }
+    ot("call\t");
+    outstr(name);
+    nl();
+    Zsp += bytes;
+    if ( save ) {
+        ol("push\thl");
+        ot("ld\tix,");
+        outdec(register_variable_slot - Zsp);
+        nl();
+        ol("add\tix,sp");
+        ol("ld\tl,(ix+0)");
+        ol("ld\th,(ix+1)");
+        ol("ex\t(sp),hl");
+        ol("pop\tix");
+    }
+}
+
 /*
  *  Store type at TOS - used for initialising auto vars
  */
@@ -930,8 +1121,7 @@ void lpush(void)
 
 void llpush(void)
 {
-    callrts("l_i64_push");
-    Zsp -= 8;
+    callrts_stack("l_i64_push", -8);
 }
 
 void gen_push_primary(LVALUE *lval)
@@ -969,8 +1159,7 @@ void gen_push_float(Kind typeToPush)
         push("de");
         push("hl");
     } else {
-        dcallrts("fpush",KIND_DOUBLE);
-        Zsp -= c_fp_size;
+        dcallrts_stack("fpush",KIND_DOUBLE, -c_fp_size);
     }
 }
 
@@ -1026,8 +1215,7 @@ int push_function_argument_fnptr(Kind expr, Type *type, Type *functype, int push
         }
     } else if ( expr == KIND_LONGLONG ) {
         if (is_last_argument == 0 || (functype->flags & FASTCALL) == 0 ) {
-            callrts("l_i64_push_under_int");
-            Zsp -= 6;
+            callrts_stack("l_i64_push_under_int", -6);
             return 8;
         }
     } else if (expr == KIND_DOUBLE  ) {
@@ -1079,8 +1267,7 @@ void dpush_under(Kind val_type)
             push("hl");     // addr -> stack
             ol("push\tbc"); // addr2 -> stack
         } else {
-           dcallrts("dpush_under_long",KIND_DOUBLE);
-           Zsp -= c_fp_size;
+           dcallrts_stack("dpush_under_long",KIND_DOUBLE, -c_fp_size);
         }
     } else {
         if ( c_fp_size == 4 ) {
@@ -1092,8 +1279,7 @@ void dpush_under(Kind val_type)
             ol("ex\t(sp),hl"); /* float -> stack, addr -> hl */
             push("hl");
         } else {
-            dcallrts("dpush_under_int",KIND_DOUBLE);
-            Zsp -= c_fp_size;
+            dcallrts_stack("dpush_under_int",KIND_DOUBLE, -c_fp_size);
         }
     }
 }
@@ -1185,18 +1371,23 @@ char dopref(SYMBOL* sym)
 /* Call a run-time library routine */
 void callrts(char* sname)
 {
-    const char *func_name = map_library_routine(sname, KIND_VOID);
-    ot("call\t");
-    outstr(func_name);
-    nl();
+    call_helper(map_library_routine(sname, KIND_VOID), 0);
 }
 
 void dcallrts(char* sname, Kind to)
 {
-    const char *func_name = map_library_routine(sname, to);
-    ot("call\t");
-    outstr(func_name);
-    nl();
+    call_helper(map_library_routine(sname, to), 0);
+}
+
+/* Call a helper that pops bytes of arguments, or pushes if negative */
+void callrts_stack(char* sname, int bytes)
+{
+    call_helper(map_library_routine(sname, KIND_VOID), bytes);
+}
+
+void dcallrts_stack(char* sname, Kind to, int bytes)
+{
+    call_helper(map_library_routine(sname, to), bytes);
 }
 
 
@@ -1509,7 +1700,11 @@ int gen_restore_frame_after_call(int offset, Kind save, int saveaf, int usebc)
  */
 int modstk(int newsp, Kind save, int saveaf, int usebc)
 {
-    int k, flag = NO;
+    int k, flag = NO, slot = gen_register_variable_slot();
+
+    if ( slot != 0 && newsp > slot && Zsp <= slot ) {
+        return gen_unwind_register_variable(slot, newsp, save, saveaf, usebc);
+    }
 
     k = newsp - Zsp;
 
@@ -1677,6 +1872,281 @@ void scale(Kind type, Type *tag)
     }
 }
 
+/*
+ * Multiplying by a constant
+ *
+ * The multiplier is worked from the top bit down: the product is doubled
+ * and the original value (kept in bc) added for each set bit. Where there's
+ * sbc hl,bc a run of set bits can subtract instead, and whole bytes of
+ * trailing zeros are moved rather than shifted. The cheapest chain is used
+ * if it's no more than two bytes longer than calling the library, or with
+ * --opt-code-speed=mult if it's quicker than the library.
+ *
+ * The chains are written as a string of steps:
+ *
+ *   C = copy, S = shift, A = add, U = subtract, B = shift by 8, N = negate
+ *
+ * and for longs, which keep the high word of the copy on the stack:
+ *
+ *   c = copy, s = shift, a = add, p = drop the copy, b = shift by 8,
+ *   w = shift by 16
+ */
+#define MULT_CHAIN_MAX   80
+
+typedef struct {
+    int     shift;          /* add hl,hl */
+    int     add;            /* add hl,bc */
+    int     sub;            /* and a / sbc hl,bc, 0 = not available */
+    int     copy;           /* ld b,h / ld c,l */
+    int     bytemove;       /* ld h,l / ld l,0 */
+    int     neg;            /* call l_neg */
+    int     lshift;         /* add hl,hl / rl e / rl d, 0 = no long chains */
+    int     ladd;           /* add the copy to dehl */
+    int     lcopy;          /* ld b,h / ld c,l / push de */
+    int     pop;            /* pop bc */
+    int     lbytemove;      /* ld d,e / ld e,h / ld h,l / ld l,0 */
+    int     lwordmove;      /* ex de,hl / ld hl,0 */
+    int     mult;           /* ld de,nn / call l_mult */
+    int     long_mult;      /* push, push, ld hl, ld de, call l_long_mult */
+} mult_costs;
+
+static mult_costs mult_bytes = { 1, 1, 3, 2, 3, 3, 5, 9, 3, 1, 5, 4, 6, 11 };
+
+static struct {
+    int         cpu;
+    mult_costs  cycles;
+} mult_cycles[] = {
+    { CPU_Z80,   { 11, 11, 19,  8, 11, 57, 27, 73, 19, 10, 19, 14, 1125, 3890 } },
+    { CPU_Z80N,  { 11, 11, 19,  8, 11, 57, 27, 73, 19, 10, 19, 14, 1125, 3890 } },
+    { CPU_Z180,  {  7,  7, 14,  8, 10, 45, 21, 63, 19,  9, 18, 12, 1030, 3340 } },
+    { CPU_R2KA,  {  2,  2,  6,  4,  6, 40, 10, 44, 14,  7, 10,  8,   42, 1200 } },
+    { CPU_R3K,   {  2,  2,  6,  4,  6, 40, 10, 44, 14,  7, 10,  8,   42, 1200 } },
+    { CPU_8080,  { 10, 10,  0, 10, 12, 60, 38, 74, 21, 10, 22, 14, 1780, 3340 } },
+    { CPU_8085,  { 10, 10,  0,  8, 11, 60, 20, 70, 20, 10, 19, 14, 1780, 3340 } },
+    { CPU_GBZ80, {  8,  8,  0,  8, 12, 60,  0,  0,  0, 12,  0,  0,  770, 2390 } },
+};
+
+static const mult_costs *get_mult_costs(int speed)
+{
+    int   i;
+
+    if ( speed == 0 ) {
+        mult_bytes.lshift = IS_GBZ80() ? 0 : IS_8080() ? 7 : IS_8085() ? 2 : 5;
+        return &mult_bytes;
+    }
+    for ( i = 0; i < sizeof(mult_cycles) / sizeof(mult_cycles[0]); i++ ) {
+        if ( mult_cycles[i].cpu == c_cpu ) {
+            return &mult_cycles[i].cycles;
+        }
+    }
+    return &mult_cycles[0].cycles;
+}
+
+/* Build the chain for x * value, optionally recoding runs of set bits to subtract */
+static void mult_plan(uint32_t value, int bits, int recode, char *ops)
+{
+    int64_t  v;
+    int      digits[34];
+    int      ndigits = 0;
+    int      shift = 0;
+    int      i;
+
+    while ( (value & 1) == 0 ) {
+        value >>= 1;
+        shift++;
+    }
+    for ( v = value; v != 0; v >>= 1 ) {
+        int   digit = 0;
+
+        if ( v & 1 ) {
+            digit = recode ? 2 - (int)(v & 3) : 1;
+            v -= digit;
+        }
+        digits[ndigits++] = digit;
+    }
+    if ( ndigits > 1 ) {
+        *ops++ = bits == 32 ? 'c' : 'C';
+    }
+    for ( i = ndigits - 2; i >= 0; i-- ) {
+        *ops++ = bits == 32 ? 's' : 'S';
+        if ( digits[i] == 1 ) {
+            *ops++ = bits == 32 ? 'a' : 'A';
+        } else if ( digits[i] == -1 ) {
+            *ops++ = 'U';
+        }
+    }
+    if ( bits == 32 ) {
+        if ( ndigits > 1 ) {
+            *ops++ = 'p';
+        }
+        for ( ; shift >= 16; shift -= 16 ) {
+            *ops++ = 'w';
+        }
+    }
+    for ( ; shift >= 8; shift -= 8 ) {
+        *ops++ = bits == 32 ? 'b' : 'B';
+    }
+    for ( ; shift > 0; shift-- ) {
+        *ops++ = bits == 32 ? 's' : 'S';
+    }
+    *ops = 0;
+}
+
+static int mult_chain_cost(const char *ops, const mult_costs *costs)
+{
+    int   cost = 0;
+
+    for ( ; *ops; ops++ ) {
+        switch ( *ops ) {
+        case 'C': cost += costs->copy; break;
+        case 'S': cost += costs->shift; break;
+        case 'A': cost += costs->add; break;
+        case 'U': cost += costs->sub; break;
+        case 'B': cost += costs->bytemove; break;
+        case 'N': cost += costs->neg; break;
+        case 'c': cost += costs->lcopy; break;
+        case 'p': cost += costs->pop; break;
+        case 's': cost += costs->lshift; break;
+        case 'a': cost += costs->ladd; break;
+        case 'b': cost += costs->lbytemove; break;
+        case 'w': cost += costs->lwordmove; break;
+        }
+    }
+    return cost;
+}
+
+static void gen_mult_chain(const char *ops)
+{
+    for ( ; *ops; ops++ ) {
+        switch ( *ops ) {
+        case 'C':
+        case 'c':
+            ol("ld\tb,h");
+            ol("ld\tc,l");
+            if ( *ops == 'c' ) {
+                ol("push\tde");
+            }
+            break;
+        case 'S':
+            ol("add\thl,hl");
+            break;
+        case 's':
+            ol("add\thl,hl");
+            if ( IS_8085() ) {
+                ol("rl\tde");
+            } else if ( IS_8080() ) {
+                ol("ld\ta,e");
+                ol("rla");
+                ol("ld\te,a");
+                ol("ld\ta,d");
+                ol("rla");
+                ol("ld\td,a");
+            } else {
+                ol("rl\te");
+                ol("rl\td");
+            }
+            break;
+        case 'A':
+            ol("add\thl,bc");
+            break;
+        case 'a':
+            ol("add\thl,bc");
+            ol("ex\t(sp),hl");
+            ol("ld\ta,e");
+            ol("adc\tl");
+            ol("ld\te,a");
+            ol("ld\ta,d");
+            ol("adc\th");
+            ol("ld\td,a");
+            ol("ex\t(sp),hl");
+            break;
+        case 'U':
+            ol("and\ta");
+            ol("sbc\thl,bc");
+            break;
+        case 'B':
+            ol("ld\th,l");
+            ol("ld\tl,0");
+            break;
+        case 'b':
+            ol("ld\td,e");
+            ol("ld\te,h");
+            ol("ld\th,l");
+            ol("ld\tl,0");
+            break;
+        case 'w':
+            ol("ex\tde,hl");
+            vconst(0);
+            break;
+        case 'p':
+            ol("pop\tbc");
+            break;
+        case 'N':
+            callrts("l_neg");
+            break;
+        }
+    }
+}
+
+/* Pick the cheapest chain for x * value, the speed costs break ties in size and vice versa */
+static int mult_best_chain(uint32_t value, int bits, int speed, char *best)
+{
+    const mult_costs *costs = get_mult_costs(speed);
+    const mult_costs *other = get_mult_costs(!speed);
+    char              ops[MULT_CHAIN_MAX];
+    int               best_cost = -1, best_other = 0;
+    int               i;
+
+    for ( i = 0; i < 4; i++ ) {
+        int   recode = i & 1;
+        int   cost, other_cost;
+
+        if ( recode && (bits == 32 || costs->sub == 0) ) {
+            continue;
+        }
+        if ( i < 2 ) {
+            mult_plan(value, bits, recode, ops);
+        } else if ( bits == 16 && value >= 0x8000 ) {
+            // Multiply by -value and negate
+            mult_plan(0x10000 - value, bits, recode, ops);
+            strcat(ops, "N");
+        } else {
+            continue;
+        }
+        cost = mult_chain_cost(ops, costs);
+        other_cost = mult_chain_cost(ops, other);
+        if ( best_cost == -1 || cost < best_cost || (cost == best_cost && other_cost < best_other) ) {
+            best_cost = cost;
+            best_other = other_cost;
+            strcpy(best, ops);
+        }
+    }
+    return best_cost;
+}
+
+/* Multiply by a constant with a chain if it beats calling the library */
+static int quikmult_chain(uint32_t value, int bits, char preserve)
+{
+    int               speed = (c_speed_optimisation & OPT_MULT) ? 1 : 0;
+    const mult_costs *costs = get_mult_costs(speed);
+    char              ops[MULT_CHAIN_MAX];
+    int               cost, library;
+
+    if ( bits == 32 && costs->lshift == 0 ) {
+        return 0;
+    }
+    cost = mult_best_chain(value, bits, speed, ops);
+    library = bits == 32 ? costs->long_mult : costs->mult;
+    if ( preserve ) {
+        library += speed ? 21 : 2;    /* push de / pop de */
+    }
+    if ( speed ? cost >= library : cost > library + 2 ) {
+        return 0;
+    }
+    gen_mult_chain(ops);
+    return 1;
+}
+
 static void quikmult(int type, int32_t size, char preserve)
 {
      if ( type == KIND_LONG ) {
@@ -2143,105 +2613,27 @@ static void quikmult(int type, int32_t size, char preserve)
                 }
                 // Fall through all the way to default for 8080
             default:
+                if ( quikmult_chain(size, 32, preserve) ) {
+                    break;
+                }
                 lpush();
                 vlongconst(size);
-                callrts("l_long_mult");
-                Zsp += 4;
+                callrts_stack("l_long_mult", 4);
         }
 
     } else {    // type == KIND_INT
+        uint16_t value = size;
 
-        switch (size) {
-        case 0:
+        if ( value == 0 ) {
             vconst(0);
-            break;
-        case 2048:
-            ol("ld\th,l"); /* 6 bytes, 44T */
-            ol("ld\tl,0");
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            break;
-        case 1024:
-            ol("ld\th,l"); /* 5 bytes, 33T */
-            ol("ld\tl,0");
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            break;
-        case 512:
-            ol("ld\th,l");  /* 4 bytes, 22T */
-            ol("ld\tl,0");
-            ol("add\thl,hl");
-            break;
-        case 256:
-            ol("ld\th,l"); /* 3 bytes, 11T */
-            ol("ld\tl,0");
-            break;
-        case 1:
-            break;
-        case 64:
-            ol("add\thl,hl");  /* 6 bytes, 66T, (RCM) 6 bytes, 12T */
-        case 32:
-            ol("add\thl,hl");
-        case 16:
-            ol("add\thl,hl");
-        case 8:
-            ol("add\thl,hl");
-        case 4:
-            ol("add\thl,hl");
-        case 2:
-            ol("add\thl,hl");
-            break;
-        case 12:
-            ol("add\thl,hl");
-        case 6:
-            sixreg();
-            break;
-        case 9:
-            threereg();
-        case 3:
-            threereg();
-            break;
-        case 15:
-            threereg();
-        case 5:
-            fivereg();
-            break;
-        case 10:
-            fivereg();
-            ol("add\thl,hl");
-            break;
-        case 20:
-            fivereg();
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            break;
-        case 40:
-            fivereg();
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            ol("add\thl,hl");
-            break;
-        case 14:
-            ol("add\thl,hl");
-        case 7:
-            sixreg();
-            ol("add\thl,bc");  /* BC contains original value */
-            break;
-        case 65535:
-        case -1:
-            callrts("l_neg");
-            break;
-        default:
+        } else if ( quikmult_chain(value, 16, preserve) == 0 ) {
             if (preserve)
                 ol("push\tde");
             const2(size);
             callrts("l_mult"); /* WATCH OUT!! */
             if (preserve)
                 ol("pop\tde");
-            break;
         }
-
     }
 }
 
@@ -2254,16 +2646,6 @@ static void threereg(void)
     ol("add\thl,bc");
 }
 
-/* Multiply the primary register by five */
-static void fivereg(void)
-{
-    ol("ld\tb,h");
-    ol("ld\tc,l");
-    ol("add\thl,hl");;
-    ol("add\thl,hl");;
-    ol("add\thl,bc");
-}
-
 /* Multiply the primary register by six */
 static void sixreg(void)
 {
@@ -2282,8 +2664,7 @@ void zadd(LVALUE* lval)
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_add");
-        Zsp += 8;
+        callrts_stack("l_i64_add", 8);
         break;
     case KIND_LONG:
     case KIND_ACCUM32:
@@ -2307,18 +2688,16 @@ void zadd(LVALUE* lval)
                 ol("adc\thl,bc");
                 ol("ex\tde,hl");
             }
+            Zsp += 4;
         } else {
-            callrts("l_long_add");  /* 3 bytes, 76 + 17 = 93T */
+            callrts_stack("l_long_add", 4);  /* 3 bytes, 76 + 17 = 93T */
         }
-        Zsp += 4;
         break;
     case KIND_FLOAT16:
-        dcallrts("fadd",lval->val_type);
-        Zsp += 2;
+        dcallrts_stack("fadd",lval->val_type, 2);
         break;
     case KIND_DOUBLE:
-        dcallrts("fadd",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("fadd",lval->val_type, c_fp_size);
         break;
     case KIND_ACCUM16:
         zpop();
@@ -2474,11 +2853,12 @@ void zadd_const(LVALUE *lval, int64_t value64)
         } else {
             if ( IS_808x() || IS_GBZ80()) {
                 uint32_t v = ((uint32_t)value) / 65536;
-                outfmt("\tld\ta,%d\n",v % 256);         // 2, 7
-                ol("adc\te");                         // 1, 4
+                // Not ld a,n / adc e, the peephole would turn ld a,0 into xor a
+                ol("ld\ta,e");                        // 1, 4
+                outfmt("\tadc\t%d\n",v % 256);          // 2, 7
                 ol("ld\te,a");                        // 1, 4
-                outfmt("\tld\ta,%d\n",v / 256);         // 2, 7
-                ol("adc\td");                         // 1, 4
+                ol("ld\ta,d");                        // 1, 4
+                outfmt("\tadc\t%d\n",v / 256);          // 2, 7
                 ol("ld\td,a");                        // 1, 4
             } else {
                 ol("ex\tde,hl");                      // 1, 4
@@ -2522,8 +2902,7 @@ void zsub(LVALUE* lval)
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_sub");
-        Zsp += 8;
+        callrts_stack("l_i64_sub", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
@@ -2566,18 +2945,16 @@ void zsub(LVALUE* lval)
                 ol("sbc\thl,bc");
                 ol("ex\tde,hl");
             }
+            Zsp += 4;
         } else {
-            callrts("l_long_sub"); /* 3 bytes: 100 + 17T = 117t */
+            callrts_stack("l_long_sub", 4); /* 3 bytes: 100 + 17T = 117t */
         }
-        Zsp += 4;
         break;
     case KIND_FLOAT16:
-        dcallrts("fsub",lval->val_type);
-        Zsp += 2;
+        dcallrts_stack("fsub",lval->val_type, 2);
         break;
     case KIND_DOUBLE:
-        dcallrts("fsub",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("fsub",lval->val_type, c_fp_size);
         break;
     case KIND_ACCUM16:
         zpop();
@@ -2613,40 +2990,34 @@ void mult(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_mult_u");
+            callrts_stack("l_i64_mult_u", 8);
         else
-            callrts("l_i64_mult");
-        Zsp += 8;
+            callrts_stack("l_i64_mult", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
         if (ulvalue(lval))
-            callrts("l_long_mult_u");
+            callrts_stack("l_long_mult_u", 4);
         else
-            callrts("l_long_mult");
-        Zsp += 4;
+            callrts_stack("l_long_mult", 4);
         break;
     case KIND_FLOAT16:
-        dcallrts("fmul",lval->val_type);
-        Zsp += 2;
+        dcallrts_stack("fmul",lval->val_type, 2);
         break;
     case KIND_ACCUM16:
         if ( ulvalue(lval))
-            callrts("l_fix16_mulu");
+            callrts_stack("l_fix16_mulu", 2);
         else 
-            callrts("l_fix16_muls");
-        Zsp += 2;
+            callrts_stack("l_fix16_muls", 2);
         break;
     case KIND_ACCUM32:
         if ( ulvalue(lval))
-            callrts("l_fix32_mulu");
+            callrts_stack("l_fix32_mulu", 4);
         else 
-            callrts("l_fix32_muls");
-        Zsp += 4;
+            callrts_stack("l_fix32_muls", 4);
         break;
     case KIND_DOUBLE:
-        dcallrts("fmul",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("fmul",lval->val_type, c_fp_size);
         break;
     case KIND_CHAR:
         if ( lval->ltype->isunsigned ) {
@@ -2693,13 +3064,11 @@ void mult_const(LVALUE *lval, int64_t value64)
         if ( p == 1 ) {
             llpush();
             loada(c);
-            callrts("l_i64_aslo");
-            Zsp += 8;
+            callrts_stack("l_i64_aslo", 8);
         } else {
             llpush();
             vllongconst(value);
-            callrts("l_i64_mult");
-            Zsp += 8;
+            callrts_stack("l_i64_mult", 8);
         }
         return;
     } else {
@@ -2731,40 +3100,34 @@ void zdiv(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_div_u");
+            callrts_stack("l_i64_div_u", 8);
         else
-            callrts("l_i64_div");
-        Zsp += 8;
+            callrts_stack("l_i64_div", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
         if (ulvalue(lval))
-            callrts("l_long_div_u");
+            callrts_stack("l_long_div_u", 4);
         else
-            callrts("l_long_div");
-        Zsp += 4;
+            callrts_stack("l_long_div", 4);
         break;
     case KIND_ACCUM16:
         if ( ulvalue(lval))
-            callrts("l_fix16_divu");
+            callrts_stack("l_fix16_divu", 2);
         else 
-            callrts("l_fix16_divs");
-        Zsp += 2;
+            callrts_stack("l_fix16_divs", 2);
         break;
     case KIND_FLOAT16:
-        dcallrts("fdiv",lval->val_type);
-        Zsp += 2;
+        dcallrts_stack("fdiv",lval->val_type, 2);
         break;
     case KIND_ACCUM32:
       if ( ulvalue(lval))
-            callrts("l_fix32_divu");
+            callrts_stack("l_fix32_divu", 4);
         else 
-            callrts("l_fix32_divs");
-        Zsp += 4;
+            callrts_stack("l_fix32_divs", 4);
         break;
     case KIND_DOUBLE:
-        dcallrts("fdiv",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("fdiv",lval->val_type, c_fp_size);
         break;
     default:
         if (ulvalue(lval))
@@ -2774,6 +3137,20 @@ void zdiv(LVALUE* lval)
     }
 }
 
+/* Returns n where value == 2^n, or -1 */
+static int exact_log2(uint32_t value)
+{
+    int   n = 0;
+
+    if ( value == 0 || (value & (value - 1)) ) {
+        return -1;
+    }
+    while ( value >>= 1 ) {
+        n++;
+    }
+    return n;
+}
+
 static void add_if_negative(LVALUE *lval, int32_t toadd)
 {
     int label;
@@ -2808,9 +3185,246 @@ static void add_if_negative(LVALUE *lval, int32_t toadd)
     postlabel(label);
 }
 
+/*
+ * Unsigned division by a constant
+ *
+ * x / d is (x * m) >> (n + s) where m = ceil(2^(n + s) / d) and n is the
+ * width of x. Every x is tried to find the values of s where that holds
+ * with m no more than one bit wider than x, and the shortest is used. The
+ * multiply is worked from the bottom bit up, shifting the partial product
+ * right after each step so it never needs more than the carry. With
+ * --opt-code-speed=div this replaces l_div_u for unsigned char and int.
+ */
+static int chain_ol(int emit, int bytes, char *op)
+{
+    if ( emit ) {
+        ol(op);
+    }
+    return bytes;
+}
+
+/* a >>= 1, bringing in the carry or a zero */
+static int gen_rra(int emit, int carry)
+{
+    if ( carry ) {
+        return chain_ol(emit, 1, "rra");
+    } else if ( IS_808x() ) {
+        return chain_ol(emit, 1, "and\ta") + chain_ol(emit, 1, "rra");
+    }
+    return chain_ol(emit, 2, "srl\ta");
+}
+
+/* hl >>= 1, bringing in the carry or a zero */
+static int gen_rr_hl(int emit, int carry)
+{
+    int   bytes = 0;
+
+    if ( IS_808x() ) {
+        if ( !carry ) {
+            bytes += chain_ol(emit, 1, "and\ta");
+        }
+        bytes += chain_ol(emit, 1, "ld\ta,h");
+        bytes += chain_ol(emit, 1, "rra");
+        bytes += chain_ol(emit, 1, "ld\th,a");
+        bytes += chain_ol(emit, 1, "ld\ta,l");
+        bytes += chain_ol(emit, 1, "rra");
+        bytes += chain_ol(emit, 1, "ld\tl,a");
+        return bytes;
+    }
+    bytes += chain_ol(emit, 2, carry ? "rr\th" : "srl\th");
+    bytes += chain_ol(emit, 2, "rr\tl");
+    return bytes;
+}
+
+/* l = l / d for the magic m and s, leaves the dividend in c, quotient in a */
+static int gen_udiv8(uint32_t m, int s, int emit)
+{
+    int   bytes = 0;
+    int   carry = 0;
+    int   started = 0;
+    int   i;
+
+    bytes += chain_ol(emit, 1, "ld\tc,l");
+    for ( i = 0; i < 8; i++ ) {
+        if ( started == 0 ) {
+            if ( (m & (1 << i)) == 0 ) {
+                continue;
+            }
+            bytes += chain_ol(emit, 1, "ld\ta,c");
+            started = 1;
+            bytes += gen_rra(emit, 0);
+        } else if ( m & (1 << i) ) {
+            bytes += chain_ol(emit, 1, "add\tc");
+            bytes += gen_rra(emit, 1);
+        } else {
+            bytes += gen_rra(emit, 0);
+        }
+    }
+    if ( started == 0 ) {
+        bytes += chain_ol(emit, 1, "ld\ta,c");
+    } else if ( m & 0x100 ) {
+        bytes += chain_ol(emit, 1, "add\tc");
+        carry = 1;
+    }
+    for ( i = 0; i < s; i++ ) {
+        bytes += gen_rra(emit, carry);
+        carry = 0;
+    }
+    return bytes;
+}
+
+/* hl = hl / d for the magic m and s, leaves the dividend in bc */
+static int gen_udiv16(uint32_t m, int s, int emit)
+{
+    int   bytes = 0;
+    int   carry = 0;
+    int   started = 0;
+    int   i;
+
+    bytes += chain_ol(emit, 1, "ld\tb,h");
+    bytes += chain_ol(emit, 1, "ld\tc,l");
+    for ( i = 0; i < 16; i++ ) {
+        if ( started == 0 ) {
+            if ( (m & (1 << i)) == 0 ) {
+                continue;
+            }
+            started = 1;
+            bytes += gen_rr_hl(emit, 0);
+        } else if ( m & (1 << i) ) {
+            bytes += chain_ol(emit, 1, "add\thl,bc");
+            bytes += gen_rr_hl(emit, 1);
+        } else {
+            bytes += gen_rr_hl(emit, 0);
+        }
+    }
+    if ( started && (m & 0x10000) ) {
+        bytes += chain_ol(emit, 1, "add\thl,bc");
+        carry = 1;
+    }
+    if ( s >= 8 ) {
+        bytes += chain_ol(emit, 1, "ld\tl,h");
+        if ( carry && IS_808x() ) {
+            bytes += chain_ol(emit, 1, "sbc\ta");
+            bytes += chain_ol(emit, 2, "and\t1");
+            bytes += chain_ol(emit, 1, "ld\th,a");
+        } else {
+            bytes += chain_ol(emit, 2, "ld\th,0");
+            if ( carry ) {
+                bytes += chain_ol(emit, 2, "rl\th");
+            }
+        }
+        carry = 0;
+        s -= 8;
+    }
+    for ( i = 0; i < s; i++ ) {
+        bytes += gen_rr_hl(emit, carry);
+        carry = 0;
+    }
+    return bytes;
+}
+
+/* Find the shortest magic multiplier for an unsigned division of a bits wide value */
+static int udiv_magic(uint32_t d, int bits, uint32_t *mp, int *sp)
+{
+    int   best = -1;
+    int   s;
+
+    for ( s = 0; s <= bits; s++ ) {
+        uint64_t  m = ((UINT64_C(1) << (bits + s)) + d - 1) / d;
+        uint32_t  x;
+        int       bytes;
+
+        if ( m >= (UINT64_C(1) << (bits + 1)) ) {
+            break;
+        }
+        for ( x = 0; x < (UINT32_C(1) << bits); x++ ) {
+            if ( ((x * m) >> (bits + s)) != x / d ) {
+                break;
+            }
+        }
+        if ( x < (UINT32_C(1) << bits) ) {
+            continue;
+        }
+        bytes = bits == 8 ? gen_udiv8(m, s, 0) : gen_udiv16(m, s, 0);
+        if ( best == -1 || bytes < best ) {
+            best = bytes;
+            *mp = m;
+            *sp = s;
+        }
+    }
+    return best;
+}
+
+/* Divide (or take the remainder of) an unsigned char or int by a constant */
+static int udiv_chain(LVALUE *lval, uint32_t d, int modulus)
+{
+    uint32_t  m;
+    int       s, i;
+    char      ops[MULT_CHAIN_MAX];
+
+    if ( (c_speed_optimisation & OPT_DIV) == 0 || ulvalue(lval) == 0 ) {
+        return 0;
+    }
+    if ( lval->val_type == KIND_CHAR && d >= 2 && d <= 255 ) {
+        if ( udiv_magic(d, 8, &m, &s) == -1 ) {
+            return 0;
+        }
+        gen_udiv8(m, s, 1);
+        if ( modulus ) {
+            // a = c - a * d
+            mult_plan(d, 16, 0, ops);
+            ol("ld\tb,a");
+            for ( i = 1; ops[i]; i++ ) {
+                ol(ops[i] == 'A' ? "add\tb" : "add\ta");
+            }
+            ol("ld\tb,a");
+            ol("ld\ta,c");
+            ol("sub\tb");
+        }
+        ol("ld\tl,a");
+        ol("ld\th,0");
+        return 1;
+    } else if ( lval->val_type == KIND_INT && d >= 2 && d <= 65535 ) {
+        if ( udiv_magic(d, 16, &m, &s) == -1 ) {
+            return 0;
+        }
+        if ( modulus ) {
+            ol("push\thl");
+        }
+        gen_udiv16(m, s, 1);
+        if ( modulus ) {
+            // hl = x - q * d
+            mult_best_chain(d, 16, 1, ops);
+            gen_mult_chain(ops);
+            if ( IS_GBZ80() ) {
+                ol("ld\td,h");
+                ol("ld\te,l");
+            } else {
+                ol("ex\tde,hl");
+            }
+            ol("pop\thl");
+            if ( IS_808x() || IS_GBZ80() ) {
+                ol("ld\ta,l");
+                ol("sub\te");
+                ol("ld\tl,a");
+                ol("ld\ta,h");
+                ol("sbc\td");
+                ol("ld\th,a");
+            } else {
+                ol("and\ta");
+                ol("sbc\thl,de");
+            }
+        }
+        return 1;
+    }
+    return 0;
+}
+
 void zdiv_const(LVALUE *lval, int64_t value64)
 {
     int32_t value = (int32_t)value64;
+    int     shift;
+
     if ( lval->val_type == KIND_LONGLONG ) {
         llpush();
         vllongconst(value64);
@@ -2844,51 +3458,22 @@ void zdiv_const(LVALUE *lval, int64_t value64)
         }
     }
 
-    switch ( value ) {
-        case 1:
-            break;
-        case 2:
-            add_if_negative(lval, 1);
-            asr_const(lval,1);
-            break;
-        case 4:
-            add_if_negative(lval, 3);
-            asr_const(lval,2);
-            break;
-        case 8:
-            add_if_negative(lval, 7);
-            asr_const(lval,3);
-            break;
-        case 16:
-            add_if_negative(lval, 15);
-            asr_const(lval,4);
-            break;
-        case 32:
-            add_if_negative(lval, 31);
-            asr_const(lval,5);
-            break;
-        case 64:
-            add_if_negative(lval, 63);
-            asr_const(lval,6);
-            break;
-        case 128:
-            add_if_negative(lval, 127);
-            asr_const(lval,7);
-            break;
-        case 256:
-            /* Unsigned is dealt with above */
-            add_if_negative(lval, 255);
-            asr_const(lval,8);
-            break;
-        default:
-            if ( lval->val_type == KIND_LONG || lval->val_type == KIND_CPTR ) {
-                lpush();
-                vlongconst(value);
-            } else {
-                const2(value & 0xffff);
-                swap();
-            }
-            zdiv(lval);
+    shift = value > 0 ? exact_log2(value) : -1;
+    if ( value == 1 ) {
+        return;
+    } else if ( shift > 0 && (shift <= 8 || (lval->val_type == KIND_INT && shift <= 15) || lval->val_type == KIND_LONG) ) {
+        /* Unsigned 256 is dealt with above */
+        add_if_negative(lval, value - 1);
+        asr_const(lval, shift);
+    } else if ( udiv_chain(lval, value, 0) == 0 ) {
+        if ( lval->val_type == KIND_LONG || lval->val_type == KIND_CPTR ) {
+            lpush();
+            vlongconst(value);
+        } else {
+            const2(value & 0xffff);
+            swap();
+        }
+        zdiv(lval);
     }
 }
 
@@ -2911,10 +3496,9 @@ void zmod(LVALUE* lval)
 {
     if (c_notaltreg && (lval->val_type == KIND_LONG || lval->val_type == KIND_CPTR)) {
         if (ulvalue(lval))
-            callrts("l_long_mod_u");
+            callrts_stack("l_long_mod_u", 4);
         else
-            callrts("l_long_mod");
-        Zsp += 4;
+            callrts_stack("l_long_mod", 4);
     } else {
         if ( IS_GBZ80() ) {
             if (ulvalue(lval))
@@ -2923,65 +3507,82 @@ void zmod(LVALUE* lval)
                 callrts("l_mod");
         } else if ( lval->val_type == KIND_LONGLONG) {
             if (ulvalue(lval))
-                callrts("l_i64_mod_u");
+                callrts_stack("l_i64_mod_u", 8);
             else
-                callrts("l_i64_mod");
-            Zsp += 8;
+                callrts_stack("l_i64_mod", 8);
         } else if (lval->val_type == KIND_LONG || lval->val_type == KIND_CPTR ) {
             if (ulvalue(lval))
-                callrts("l_long_mod_u");
+                callrts_stack("l_long_mod_u", 4);
             else
-                callrts("l_long_mod");
-            Zsp += 4;
+                callrts_stack("l_long_mod", 4);
         } else {
             zdiv(lval);
             swap();
         }
     }
-}
-
-void negate_if_negative(LVALUE *lval, int64_t value)
-{
-    int label;
-    // Only need to consider int handling here
-    // We're called for parameters on the lowest byte, so only need to consider l
-    if ( ulvalue(lval) )
-        return;
-    label = getlabel();
-    if ( lval->val_type == KIND_LONG ) {
-        if ( IS_808x() ) {
-            ol("ld\ta,d");
-            ol("rla");
-            ot("jp\tnc,");
-        } else {
-            ol("bit\t7,d");
-            ot("jr\tz,");
-        }
-        printlabel(label);
-        nl();
+}
+
+/* Remainder of a signed int by 2^shift: x - ((x < 0 ? x + 2^shift - 1 : x) & -2^shift) */
+static void zmod_signed_pow2(LVALUE *lval, int shift)
+{
+    uint16_t mask = ~((1 << shift) - 1);
+
+    ol("ld\td,h");
+    ol("ld\te,l");
+    add_if_negative(lval, (1 << shift) - 1);
+    if ( shift < 8 ) {
+        ol("ld\ta,l");
+        outfmt("\tand\t%d\n", mask & 0xff);
+        ol("ld\tl,a");
     } else {
-        if ( IS_808x() ) {
+        ol("ld\tl,0");
+        if ( shift > 8 ) {
             ol("ld\ta,h");
-            ol("rla");
-            ot("jp\tnc,");
-        } else {
-            ol("bit\t7,h");
-            ot("jr\tz,");
+            outfmt("\tand\t%d\n", mask >> 8);
+            ol("ld\th,a");
         }
-        printlabel(label);
-        nl();
     }
-    ol("ld\ta,l");
-    ol("cpl");
-    ol("inc\ta");
+    if ( IS_808x() || IS_GBZ80() ) {
+        ol("ld\ta,e");
+        ol("sub\tl");
+        ol("ld\tl,a");
+        ol("ld\ta,d");
+        ol("sbc\th");
+        ol("ld\th,a");
+    } else {
+        ol("ex\tde,hl");
+        ol("and\ta");
+        ol("sbc\thl,de");
+    }
+}
+
+/* The same for a long and 2^shift no more than 128, the remainder fits
+   in l so it's worked out on the magnitude of the low byte: with s the
+   sign of x, ((((x ^ s) - s) & (2^shift - 1)) ^ s) - s */
+static void zmod_signed_pow2_long(int shift)
+{
+    ol("ld\ta,d");
+    ol("rla");
+    ol("sbc\ta,a");
+    ol("ld\te,a");
+    ol("xor\tl");
+    ol("sub\te");
+    outfmt("\tand\t%d\n", (1 << shift) - 1);
+    ol("xor\te");
+    ol("sub\te");
     ol("ld\tl,a");
-    postlabel(label);
+    ol("rla");
+    ol("sbc\ta,a");
+    ol("ld\th,a");
+    ol("ld\te,a");
+    ol("ld\td,a");
 }
 
 void zmod_const(LVALUE *lval, int64_t value64)
 {
     LVALUE  templval={0};
     int32_t value = (int32_t)value64;
+    int     shift = value > 0 ? exact_log2(value) : -1;
 
     templval.val_type = KIND_INT;
     if ( ulvalue(lval) )
@@ -2990,23 +3591,23 @@ void zmod_const(LVALUE *lval, int64_t value64)
         templval.ltype = type_int;
 
     if ( lval->val_type == KIND_LONG || lval->val_type == KIND_ACCUM32 ) {
-        if ( value <= 256 && value > 0 ) {
-            // Fall through to the logical and operation
-        } else if ( value == 65536 && ulvalue(lval) ) {
+        if ( value == 1 ) {
+            vlongconst(0);
+        } else if ( shift > 8 && shift < 16 && ulvalue(lval) ) {
+            ol("ld\ta,h");
+            outfmt("\tand\t%d\n", (value - 1) >> 8);
+            ol("ld\th,a");
             const2(0);
-            return;
-        } else if ( value == 65536 * 256 && ulvalue(lval)  ) {
-            ol("ld\td,0");
-            return;
-        } else if ( value == 8192 && ulvalue(lval) ) {
-            zand_const(lval, 8191);
-            return;
+        } else if ( shift > 0 && ulvalue(lval) ) {
+            zand_const(lval, value - 1);
+        } else if ( shift > 0 && shift <= 7 ) {
+            zmod_signed_pow2_long(shift);
         } else {
             lpush();
             vlongconst(value);
             zmod(lval);
-            return;
         }
+        return;
     } else if ( lval->val_type == KIND_LONGLONG) {
         llpush();
         vllongconst(value64);
@@ -3014,54 +3615,20 @@ void zmod_const(LVALUE *lval, int64_t value64)
         return;
     }
 
-    switch ( value ) {
-        case 1:
-            vconst(0);
-            break;
-        case 2:
-            negate_if_negative(lval, 1);
-            zand_const(&templval,1);
-            break;
-        case 4:
-            negate_if_negative(lval, 3);
-            zand_const(&templval, 3);
-            break;
-        case 8:
-            negate_if_negative(lval, 7);
-            zand_const(&templval,7);
-            break;
-        case 16:
-            negate_if_negative(lval, 15);
-            zand_const(&templval,15);
-            break;
-        case 32:
-            negate_if_negative(lval, 31);
-            zand_const(&templval, 31);
-            break;
-        case 64:
-            negate_if_negative(lval, 63);
-            zand_const(&templval,63);
-            break;
-        case 128:
-            negate_if_negative(lval, 127);
-            zand_const(&templval,127);
-            break;
-        case 256:
-            if ( ulvalue(lval) ) {
-                ol("ld\th,0");
-            } else {
-                negate_if_negative(lval, 255);
-                ol("ld\th,0");
-            }
-            break;
-        default:
-            const2(value & 0xffff);
-            swap();
-            zmod(&templval);
-    }
-
-    if ( lval->val_type == KIND_LONG ) {
-        const2(0);
+    if ( value == 1 ) {
+        vconst(0);
+    } else if ( shift > 8 && shift <= 15 && ulvalue(lval) ) {
+        ol("ld\ta,h");
+        outfmt("\tand\t%d\n", (value - 1) >> 8);
+        ol("ld\th,a");
+    } else if ( shift > 0 && shift <= 8 && ulvalue(lval) ) {
+        zand_const(&templval, value - 1);
+    } else if ( shift > 0 && shift <= 14 ) {
+        zmod_signed_pow2(lval, shift);
+    } else if ( udiv_chain(lval, value, 1) == 0 ) {
+        const2(value & 0xffff);
+        swap();
+        zmod(&templval);
     }
 }
 
@@ -3071,13 +3638,11 @@ void zor(LVALUE* lval )
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_or");
-        Zsp += 8;
+        callrts_stack("l_i64_or", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
-        callrts("l_long_or");
-        Zsp += 4;
+        callrts_stack("l_long_or", 4);
         break;
     default:
         callrts("l_or");
@@ -3227,13 +3792,11 @@ void zxor(LVALUE *lval)
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_xor");
-        Zsp += 8;
+        callrts_stack("l_i64_xor", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
-        callrts("l_long_xor");
-        Zsp += 4;
+        callrts_stack("l_long_xor", 4);
         break;
     default:
         callrts("l_xor");
@@ -3296,13 +3859,11 @@ void zand(LVALUE* lval)
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_and");
-        Zsp += 8;
+        callrts_stack("l_i64_and", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
-        callrts("l_long_and");
-        Zsp += 4;
+        callrts_stack("l_long_and", 4);
         break;
     default:
         callrts("l_and");
@@ -3407,18 +3968,16 @@ void asr(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_asr_u");
+            callrts_stack("l_i64_asr_u", 8);
         else
-            callrts("l_i64_asr");
-        Zsp += 8;
+            callrts_stack("l_i64_asr", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
         if (ulvalue(lval))
-            callrts("l_long_asr_u");
+            callrts_stack("l_long_asr_u", 4);
         else
-            callrts("l_long_asr");
-        Zsp += 4;
+            callrts_stack("l_long_asr", 4);
         break;
     default:
         if (ulvalue(lval))
@@ -3672,11 +4231,10 @@ void asr_const(LVALUE *lval, int64_t value64)
         llpush();
         loada(value & 63);
         if (ulvalue(lval)) {
-            callrts("l_i64_asr_uo");
+            callrts_stack("l_i64_asr_uo", 8);
         } else {
-            callrts("l_i64_asro");
+            callrts_stack("l_i64_asro", 8);
         }
-        Zsp += 8;
     } else {
         if ( value == 1 && IS_8085() && !ulvalue(lval) ) {
             ol("sra\thl");
@@ -3741,13 +4299,11 @@ void asl(LVALUE* lval)
 {
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_asl");
-        Zsp += 8;
+        callrts_stack("l_i64_asl", 8);
         break;
     case KIND_LONG:
     case KIND_CPTR:
-        callrts("l_long_asl");
-        Zsp += 4;
+        callrts_stack("l_long_asl", 4);
         break;
     default:
         callrts("l_asl");
@@ -3955,8 +4511,7 @@ void asl_const(LVALUE *lval, int64_t value64)
         if ( value >= 64 ) warningfmt("overflow","Left shifting by more than the size of the object");
         llpush();
         loada(value & 63);
-        callrts("l_i64_aslo");
-        Zsp += 8;
+        callrts_stack("l_i64_aslo", 8);
     } else {
         asl_16bit_const(lval, value);
     }
@@ -4087,14 +4642,12 @@ void inc(LVALUE* lval)
         default:
             gen_load_constant_as_float(1, KIND_DOUBLE, 1);
         }
-        dcallrts("fadd",KIND_DOUBLE);
-        Zsp += c_fp_size;
+        dcallrts_stack("fadd",KIND_DOUBLE, c_fp_size);
         break;
     case KIND_FLOAT16:
         gen_push_float(lval->val_type);
         vconst(0x3c00); // +1.0
-        dcallrts("fadd",KIND_FLOAT16);
-        Zsp += 2;
+        dcallrts_stack("fadd",KIND_FLOAT16, 2);
         break;
     case KIND_LONGLONG:
         callrts("l_i64_inc");
@@ -4137,14 +4690,12 @@ void dec(LVALUE* lval)
         default:
             gen_load_constant_as_float(-1,KIND_DOUBLE, 0);
         }
-        callrts("fadd");
-        Zsp += c_fp_size;
+        callrts_stack("fadd", c_fp_size);
         break;
     case KIND_FLOAT16:
         gen_push_float(lval->val_type);
         vconst(0xbc00); // -1.0
-        dcallrts("fadd",KIND_FLOAT16);
-        Zsp += 2;
+        dcallrts_stack("fadd",KIND_FLOAT16, 2);
         break;
     case KIND_LONGLONG:
         callrts("l_i64_dec");
@@ -4339,26 +4890,22 @@ void zeq(LVALUE* lval)
     lval->ptr_type = KIND_NONE;
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_eq");
-        Zsp += 8;
+        callrts_stack("l_i64_eq", 8);
         set_int(lval);
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         set_int(lval);
-        callrts("l_long_eq");
-        Zsp += 4;
+        callrts_stack("l_long_eq", 4);
         break;
     case KIND_FLOAT16:
-        dcallrts("feq",lval->val_type);
+        dcallrts_stack("feq",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
         set_int(lval);
-        dcallrts("feq",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("feq",lval->val_type, c_fp_size);
         break;
     case KIND_CHAR:
         if (c_speed_optimisation & OPT_CHAR_COMPARE ) {
@@ -4521,26 +5068,22 @@ void zne(LVALUE* lval)
     lval->ptr_type = KIND_NONE;
     switch (lval->val_type) {
     case KIND_LONGLONG:
-        callrts("l_i64_ne");
-        Zsp += 8;
+        callrts_stack("l_i64_ne", 8);
         set_int(lval);
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         set_int(lval);
-        callrts("l_long_ne");
-        Zsp += 4;
+        callrts_stack("l_long_ne", 4);
         break;
     case KIND_FLOAT16:
-        dcallrts("fne",lval->val_type);
+        dcallrts_stack("fne",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
-        dcallrts("fne",lval->val_type);
+        dcallrts_stack("fne",lval->val_type, c_fp_size);
         set_int(lval);
-        Zsp += c_fp_size;
         break;
     case KIND_CHAR:
         if (c_speed_optimisation & OPT_CHAR_COMPARE ) {
@@ -4605,9 +5148,8 @@ void zlt_const(LVALUE *lval, int64_t value64)
         } else {
             lpush();
             vlongconst(value);
-            callrts("l_long_lt");
+            callrts_stack("l_long_lt", 4);
             set_int(lval);
-            Zsp += 4;
         }
     } else if ( lval->val_type == KIND_CHAR && ulvalue(lval)) {
         if ( value == 0 ) {
@@ -4682,31 +5224,27 @@ void zlt(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_ult");
+            callrts_stack("l_i64_ult", 8);
         else
-            callrts("l_i64_lt");
+            callrts_stack("l_i64_lt", 8);
         set_int(lval);
-        Zsp += 8;
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         if (ulvalue(lval))
-            callrts("l_long_ult");
+            callrts_stack("l_long_ult", 4);
         else
-            callrts("l_long_lt");
-        Zsp += 4;
+            callrts_stack("l_long_lt", 4);
         set_int(lval);
         break;
     case KIND_FLOAT16:
-        dcallrts("flt",lval->val_type);
+        dcallrts_stack("flt",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
-        dcallrts("flt",lval->val_type);
+        dcallrts_stack("flt",lval->val_type, c_fp_size);
         set_int(lval);
-        Zsp += c_fp_size;
         break;
     case KIND_CHAR:
         if (c_speed_optimisation & OPT_CHAR_COMPARE ) {
@@ -4809,31 +5347,27 @@ void zle(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_ule");
+            callrts_stack("l_i64_ule", 8);
         else
-            callrts("l_i64_le");
+            callrts_stack("l_i64_le", 8);
         set_int(lval);
-        Zsp += 8;
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         if (ulvalue(lval))
-            callrts("l_long_ule");
+            callrts_stack("l_long_ule", 4);
         else
-            callrts("l_long_le");
+            callrts_stack("l_long_le", 4);
         set_int(lval);
-        Zsp += 4;
         break;
     case KIND_FLOAT16:
-        dcallrts("fle",lval->val_type);
+        dcallrts_stack("fle",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
-        dcallrts("fle",lval->val_type);
+        dcallrts_stack("fle",lval->val_type, c_fp_size);
         set_int(lval);
-        Zsp += c_fp_size;
         break;
     case KIND_CHAR:
         if (c_speed_optimisation & OPT_CHAR_COMPARE && !IS_808x()) {
@@ -4940,30 +5474,26 @@ void zgt(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_ugt");
+            callrts_stack("l_i64_ugt", 8);
         else
-            callrts("l_i64_gt");
+            callrts_stack("l_i64_gt", 8);
         set_int(lval);
-        Zsp += 8;
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         if (ulvalue(lval))
-            callrts("l_long_ugt");
+            callrts_stack("l_long_ugt", 4);
         else
-            callrts("l_long_gt");
+            callrts_stack("l_long_gt", 4);
         set_int(lval);
-        Zsp += 4;
         break;
     case KIND_FLOAT16:
-        dcallrts("fgt",lval->val_type);
+        dcallrts_stack("fgt",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
-        dcallrts("fgt",lval->val_type);
-        Zsp += c_fp_size;
+        dcallrts_stack("fgt",lval->val_type, c_fp_size);
         set_int(lval);
         break;
     case KIND_CHAR:
@@ -5077,31 +5607,27 @@ void zge(LVALUE* lval)
     switch (lval->val_type) {
     case KIND_LONGLONG:
         if (ulvalue(lval))
-            callrts("l_i64_uge");
+            callrts_stack("l_i64_uge", 8);
         else
-            callrts("l_i64_ge");
+            callrts_stack("l_i64_ge", 8);
         set_int(lval);
-        Zsp += 8;
         break;
     case KIND_LONG:
     case KIND_CPTR:
     case KIND_ACCUM32:
         if (ulvalue(lval))
-            callrts("l_long_uge");
+            callrts_stack("l_long_uge", 4);
         else
-            callrts("l_long_ge");
-        Zsp += 4;
+            callrts_stack("l_long_ge", 4);
         set_int(lval);
         break;
     case KIND_FLOAT16:
-        dcallrts("fge",lval->val_type);
+        dcallrts_stack("fge",lval->val_type, 2);
         set_int(lval);
-        Zsp += 2;
         break;
     case KIND_DOUBLE:
-        dcallrts("fge",lval->val_type);
+        dcallrts_stack("fge",lval->val_type, c_fp_size);
         set_int(lval);
-        Zsp += c_fp_size;
         break;
     case KIND_CHAR:
         if (c_speed_optimisation & OPT_CHAR_COMPARE && !IS_808x()) {
@@ -5497,78 +6023,208 @@ void gen_builtin_strchr(int32_t c)
     postlabel(endlabel);
 }
 
+/*
+ * memset() and memcpy() with a constant size
+ *
+ * By default the shortest sequence is used, with --opt-code-speed=memset or
+ * memcpy short blocks are unrolled and longer ones use an unrolled ldi loop
+ * where that beats ldir. ldi is 16T against 21T for ldir on a z80, but on
+ * the z180 and Rabbit ldir is almost as quick, so they unroll less. The
+ * 8080 and gbz80 have no block instructions and use a counted loop.
+ */
+#define BLOCK_UNROLL_SPEED  16      /* Bytes unrolled when optimising for speed */
+#define BLOCK_LDI_LOOP      8       /* ldi per iteration of the speed loop */
+
+static int has_block_instructions(void)
+{
+    return !IS_808x() && !IS_GBZ80();
+}
+
+/* Load b, or bc for more than 256, with the count for gen_counted_loop_end() */
+static int gen_counted_loop_start(int32_t n)
+{
+    int    label = getlabel();
+
+    if ( n > 256 ) {
+        /* c runs down first, then 256 for every b left */
+        outstr("\tld\tbc,"); outdec((((n + 255) / 256) << 8) + (n % 256)); nl();
+    } else {
+        outstr("\tld\tb,"); outdec(n % 256); nl();
+    }
+    postlabel(label);
+    return label;
+}
+
+static void gen_counted_loop_end(int32_t n, int label)
+{
+    if ( n > 256 ) {
+        ol("dec\tc");
+        outstr("\tjr\tnz,"); printlabel(label); nl();
+        ol("dec\tb");
+    } else if ( has_block_instructions() ) {
+        outstr("\tdjnz\t"); printlabel(label); nl();
+        return;
+    } else {
+        ol("dec\tb");
+    }
+    outstr("\tjr\tnz,"); printlabel(label); nl();
+}
+
+static void gen_copy_byte(void)
+{
+    if ( has_block_instructions() ) {
+        ol("ldi");
+    } else if ( IS_GBZ80() ) {
+        ol("ld\ta,(hl+)");
+        ol("ld\t(de),a");
+        ol("inc\tde");
+    } else {
+        ol("ld\ta,(hl)");
+        ol("ld\t(de),a");
+        ol("inc\thl");
+        ol("inc\tde");
+    }
+}
+
+/* Copy n bytes from hl to de, hl and de end up past the block */
+static void gen_block_copy(int32_t n, int speed)
+{
+    int32_t  unroll = 2;     /* Never longer than the loop */
+    int32_t  i;
+    int      label;
+
+    if ( speed ) {
+        unroll = BLOCK_UNROLL_SPEED;
+        if ( c_cpu == CPU_Z180 ) {
+            unroll = BLOCK_UNROLL_SPEED / 2;
+        } else if ( c_cpu & CPU_RABBIT ) {
+            unroll = 2;
+        }
+    }
+    if ( n <= unroll ) {
+        for ( i = 0; i < n; i++ ) {
+            gen_copy_byte();
+        }
+    } else if ( !has_block_instructions() ) {
+        label = gen_counted_loop_start(n);
+        gen_copy_byte();
+        gen_counted_loop_end(n, label);
+    } else if ( speed && (c_cpu == CPU_Z80 || c_cpu == CPU_Z80N) ) {
+        /* ldi clears p/v when bc reaches zero */
+        outstr("\tld\tbc,"); outdec(n); nl();
+        for ( i = 0; i < n % BLOCK_LDI_LOOP; i++ ) {
+            ol("ldi");
+        }
+        label = getlabel();
+        postlabel(label);
+        for ( i = 0; i < BLOCK_LDI_LOOP; i++ ) {
+            ol("ldi");
+        }
+        outstr("\tjp\tpe,"); printlabel(label); nl();
+    } else {
+        outstr("\tld\tbc,"); outdec(n); nl();
+        ol("ldir");
+    }
+}
+
 void gen_builtin_memset(int32_t c, int32_t s)
 {
+    int      speed = (c_speed_optimisation & OPT_MEMSET) != 0;
+    int32_t  unroll;
+    int32_t  i;
+    int      label;
+
+    s %= 65536;
     if ( c == -1 ) {
         /* Entry hl = c, on stack = buffer */
-        if ( IS_GBZ80() ) {
-            ol("ld\td,h");
-            ol("ld\te,l");
-        } else {
-            ol("ex\tde,hl");  /* c */
-        }
+        ol("ld\ta,l");
         ol("pop\thl");  /* buffer */
         Zsp += 2;
-    } else {
-        /* hl is buffer - data load happens a bit later*/
     }
     ol("push\thl");
 
-    /* Now decide what to do about the count */
-    if ( s < 4 ) {
-        int i;
-        for ( i = 0; i < s; i++ ) {
-            if ( i  != 0 ) {
-                ol("inc\thl");
-            }
-            if ( c != -1 ) {
-                outstr("\tld\t(hl),"); outdec(c % 256); nl();
-            } else {
-                ol("ld\t(hl),e");
-            }
-        }
-    } else if ( s <= 256 ) {
-        int looplabel = getlabel();
-        if ( c != -1 ) {
-            outstr("\tld\te,"); outdec(c % 256); nl();
-        }
-        outstr("\tld\tb,"); outdec(s % 256); nl();
-        postlabel(looplabel);
-        ol("ld\t(hl),e");
-        ol("inc\thl");
-        outstr("\tdjnz\t"); printlabel(looplabel); nl();
+    /* Unroll while it's no longer than the loop */
+    if ( speed ) {
+        unroll = BLOCK_UNROLL_SPEED;
+    } else if ( IS_GBZ80() ) {
+        unroll = 6;
+    } else if ( IS_808x() ) {
+        unroll = 4;
     } else {
+        unroll = 3;
+    }
+
+    if ( s > unroll && has_block_instructions() && (s > 256 || speed) ) {
+        /* Copy each byte to the next one */
         if ( c != -1 ) {
             outstr("\tld\t(hl),"); outdec(c % 256); nl();
         } else {
-            ol("ld\t(hl),e");
+            ol("ld\t(hl),a");
         }
         ol("ld\td,h");
         ol("ld\te,l");
         ol("inc\tde");
-        outstr("\tld\tbc,"); outdec((s % 65536) - 1); nl();
-        ol("ldir");
+        gen_block_copy(s - 1, speed);
+        ol("pop\thl");
+        return;
+    }
+    if ( c != -1 && s == 1 ) {
+        outstr("\tld\t(hl),"); outdec(c % 256); nl();
+        ol("pop\thl");
+        return;
+    }
+    if ( c != -1 ) {
+        if ( c % 256 == 0 ) {
+            ol("xor\ta");
+        } else {
+            outstr("\tld\ta,"); outdec(c % 256); nl();
+        }
+    }
+    if ( s <= unroll ) {
+        for ( i = 0; i < s; i++ ) {
+            if ( IS_GBZ80() ) {
+                ol("ld\t(hl+),a");
+                continue;
+            }
+            if ( i != 0 ) {
+                ol("inc\thl");
+            }
+            ol("ld\t(hl),a");
+        }
+    } else {
+        label = gen_counted_loop_start(s);
+        if ( IS_GBZ80() ) {
+            ol("ld\t(hl+),a");
+        } else {
+            ol("ld\t(hl),a");
+            ol("inc\thl");
+        }
+        gen_counted_loop_end(s, label);
     }
     ol("pop\thl");
 }
 
 void gen_builtin_memcpy(int32_t src, int32_t n)
 {
+    int      speed = (c_speed_optimisation & OPT_MEMCPY) != 0;
+
     if ( src == -1 ) {
         /* Entry hl = src, on stack = dst */
         ol("pop\tde");  /* dst */
         ol("push\tde");
         Zsp += 2;
-        outstr("\tld\tbc,"); outdec(n % 65536); nl();
-    ol("ldir");
     } else {
         /* hl is dst */
         ol("push\thl");
-        ol("ex\tde,hl");
+        if ( IS_GBZ80() ) {
+            ol("ld\td,h");
+            ol("ld\te,l");
+        } else {
+            ol("ex\tde,hl");
+        }
         outstr("\tld\thl,"); outdec(src % 65536); nl();
-        outstr("\tld\tbc,"); outdec(n % 65536); nl();
-    ol("ldir");
     }
+    gen_block_copy(n % 65536, speed);
     ol("pop\thl");
 }
 
@@ -5725,8 +6381,7 @@ void gen_critical_enter(void)
     if ( c_cpu & CPU_RABBIT ) {
         ol("ipset\t3");
     } else {
-        callrts("l_push_di");
-        Zsp -= 2;
+        callrts_stack("l_push_di", -2);
     }
 }
 
@@ -5735,8 +6390,7 @@ void gen_critical_leave(void)
     if ( c_cpu & CPU_RABBIT ) {
         ol("ipres");
     } else {
-        callrts("l_pop_ei");
-        Zsp += 2;
+        callrts_stack("l_pop_ei", 2);
     }
 }
 
@@ -5812,9 +6466,8 @@ void zconvert_stacked_to_decimal(Kind stacked_kind, Kind float_kind, unsigned ch
         } else if ( stacked_kind == KIND_LONGLONG) {
             /* Pop the longlong into the accumulator */
             ol("exx");
-            callrts("l_i64_pop");  // Preserves
+            callrts_stack("l_i64_pop", 8);  // Preserves
             ol("exx");
-            Zsp += 8;
             /* Push the float */
             push("hl");
             /* And convert */
@@ -5832,9 +6485,8 @@ void zconvert_stacked_to_decimal(Kind stacked_kind, Kind float_kind, unsigned ch
          * If bigger, then they are held in FA or in alt registers, so we can trash the main set
          */
         if ( c_fp_size < 6 ) ol("exx");
-        callrts("l_i64_pop");  // Preserves
+        callrts_stack("l_i64_pop", 8);  // Preserves
         if ( c_fp_size < 6 ) ol("exx");
-        Zsp += 8;
         /* Push the float */
         gen_push_float(float_kind);
         /* And convert the long */
@@ -5975,7 +6627,29 @@ void zwiden_stack_to_long(LVALUE *lval)
     }
 }
 
-void gen_switch_preamble(Kind kind)
+/*
+ * Switch lowering
+ *
+ * Small switches compare the cases in turn: a chain of cp for a char, a table
+ * walked by l_case for the others. Otherwise dense ranges of cases jump
+ * through a table indexed by the value, sparse ones are searched: with a
+ * compare tree for a char and l_case_bsearch for an int. Long switches are
+ * always compared in turn.
+ */
+#define SWITCH_TABLE_MIN            4    /* Fewest int cases for a jump table */
+#define SWITCH_CHAR_TABLE_MIN       16   /* Fewest char cases for a jump table... */
+#define SWITCH_CHAR_TABLE_MIN_SPEED 32   /* ...and when optimising for speed */
+#define SWITCH_TREE_MIN             16   /* Fewest char cases for a compare tree */
+#define SWITCH_TREE_MIN_SPEED       10
+#define SWITCH_BSEARCH_MIN          16   /* Fewest int cases for a binary search */
+#define SWITCH_LEAF_CASES           3    /* Cases compared in turn at the end of a tree */
+
+typedef struct {
+    int32_t value;      /* Value as seen by the switch type */
+    int     label;
+} switch_case;
+
+static void gen_switch_preamble(Kind kind)
 {
     if ( kind == KIND_CHAR ) {
         ol("ld\ta,l");
@@ -5988,7 +6662,7 @@ void gen_switch_preamble(Kind kind)
     }
 }
 
-void gen_switch_case(Kind kind, int64_t value, int label)
+static void gen_switch_case(Kind kind, int64_t value, int label)
 {
     if ( kind == KIND_CHAR ) {
         if ( value == 0 ) {
@@ -6021,7 +6695,7 @@ void gen_switch_case(Kind kind, int64_t value, int label)
     }
 }
 
-void gen_switch_postamble(Kind kind)
+static void gen_switch_postamble(Kind kind)
 {
     // Table terminator
 
@@ -6032,6 +6706,175 @@ void gen_switch_postamble(Kind kind)
     }
 }
 
+/* Order cases by their bit pattern, which is what the searches compare */
+static int switch_case_compare(const void *a, const void *b)
+{
+    uint16_t v1 = ((const switch_case *)a)->value;
+    uint16_t v2 = ((const switch_case *)b)->value;
+
+    return v1 < v2 ? -1 : v1 > v2;
+}
+
+static void gen_switch_jump_table(Kind kind, switch_case *cases, int count, int32_t lowest, int32_t highest, int default_label)
+{
+    int32_t value;
+    int     i;
+
+    if ( kind == KIND_CHAR ) {
+        ol("ld\ta,l");
+        callrts("l_case_char_table");
+        defbyte();
+        outdec(lowest & 255);
+        outbyte(',');
+        outdec(highest - lowest + 1);
+        nl();
+    } else {
+        callrts("l_case_table");
+        defword();
+        outdec(lowest);
+        nl();
+        defword();
+        outdec(highest - lowest + 1);
+        nl();
+    }
+    defword();
+    printlabel(default_label);
+    nl();
+    // The cases are sorted by their bit pattern, which isn't the order of signed values
+    for ( value = lowest; value <= highest; value++ ) {
+        int label = default_label;
+
+        for ( i = 0; i < count; i++ ) {
+            if ( cases[i].value == value ) {
+                label = cases[i].label;
+                break;
+            }
+        }
+        defword();
+        printlabel(label);
+        nl();
+    }
+}
+
+/* Compare tree on a, falls through when no case matches */
+static void gen_switch_char_tree(switch_case *cases, int count, int default_label)
+{
+    int middle, label;
+
+    if ( count <= SWITCH_LEAF_CASES ) {
+        while ( count-- ) {
+            gen_switch_case(KIND_CHAR, cases->value, cases->label);
+            cases++;
+        }
+        return;
+    }
+    middle = count / 2;
+    label = getlabel();
+    ot("cp\t");
+    outdec(cases[middle].value & 255);
+    nl();
+    opjump("z,", cases[middle].label, 0);
+    opjump("c,", label, 0);
+    gen_switch_char_tree(cases + middle + 1, count - middle - 1, default_label);
+    gen_jp_label(default_label, 0);
+    postlabel(label);
+    gen_switch_char_tree(cases, middle, default_label);
+}
+
+static void gen_switch_bsearch(switch_case *cases, int count, int default_label)
+{
+    int i;
+
+    callrts("l_case_bsearch");
+    defword();
+    outdec(count);
+    nl();
+    defword();
+    printlabel(default_label);
+    nl();
+    for ( i = 0; i < count; i++ ) {
+        defword();
+        outdec(cases[i].value);
+        nl();
+        defword();
+        printlabel(cases[i].label);
+        nl();
+    }
+}
+
+/* Emit the dispatch for a switch statement with the value in hl/dehl */
+void gen_switch(Type *type, SW_TAB *swtab, int count, int default_label)
+{
+    Kind        kind = type->kind;
+    switch_case cases[NUMCASE];
+    int         speed = (c_speed_optimisation & OPT_SWITCH) != 0;
+    int         ncases = 0;
+    int32_t     lowest, highest, range;
+    int         i, j;
+
+    if ( kind != KIND_LONG && kind != KIND_LONGLONG && kind != KIND_CPTR && count >= SWITCH_TABLE_MIN ) {
+        // Truncate the values to the switch type, the first of any duplicates wins
+        for ( i = 0; i < count; i++ ) {
+            int32_t value;
+
+            if ( kind == KIND_CHAR ) {
+                value = type->isunsigned ? (int32_t)(uint8_t)swtab[i].value : (int32_t)(int8_t)swtab[i].value;
+            } else {
+                value = type->isunsigned ? (int32_t)(uint16_t)swtab[i].value : (int32_t)(int16_t)swtab[i].value;
+            }
+            for ( j = 0; j < ncases; j++ ) {
+                if ( cases[j].value == value ) break;
+            }
+            if ( j == ncases ) {
+                cases[ncases].value = value;
+                cases[ncases].label = swtab[i].label;
+                ncases++;
+            }
+        }
+        qsort(cases, ncases, sizeof(cases[0]), switch_case_compare);
+
+        lowest = highest = cases[0].value;
+        for ( i = 1; i < ncases; i++ ) {
+            if ( cases[i].value < lowest ) lowest = cases[i].value;
+            if ( cases[i].value > highest ) highest = cases[i].value;
+        }
+        range = highest - lowest + 1;
+
+        if ( kind == KIND_CHAR ) {
+            // When not optimising for speed a table is only used when it's shorter than the cp chain
+            if ( range < 256 && (speed ? ncases >= SWITCH_CHAR_TABLE_MIN_SPEED && range <= 4 * ncases
+                                       : ncases >= SWITCH_CHAR_TABLE_MIN && 2 * range + 7 <= 5 * ncases) ) {
+                gen_switch_jump_table(kind, cases, ncases, lowest, highest, default_label);
+                return;
+            }
+            if ( ncases >= (speed ? SWITCH_TREE_MIN_SPEED : SWITCH_TREE_MIN) ) {
+                ol("ld\ta,l");
+                gen_switch_char_tree(cases, ncases, default_label);
+                gen_jp_label(default_label, 1);
+                return;
+            }
+        } else {
+            // When not optimising for speed a table is only used when it's no longer than the l_case one
+            if ( ncases >= SWITCH_TABLE_MIN && (speed ? range <= 4 * ncases : 2 * range + 4 <= 4 * ncases) ) {
+                gen_switch_jump_table(kind, cases, ncases, lowest, highest, default_label);
+                return;
+            }
+            // The search table is the same size as the l_case one
+            if ( ncases >= SWITCH_BSEARCH_MIN ) {
+                gen_switch_bsearch(cases, ncases, default_label);
+                return;
+            }
+        }
+    }
+
+    gen_switch_preamble(kind);
+    for ( i = 0; i < count; i++ ) {
+        gen_switch_case(kind, swtab[i].value, swtab[i].label);
+    }
+    gen_switch_postamble(kind);
+    gen_jp_label(default_label, 1);
+}
+
 /*
  * Local Variables:
  *  indent-tabs-mode:nil
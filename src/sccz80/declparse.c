@@ -498,9 +498,11 @@ static int chase_typedef(Type *type)
     for ( ptr = symtab; ptr != NULL; ptr = ptr->hh.next ) {
         if (ptr->storage == TYPDEF && amatch(ptr->name)) {
             char wasconst = type->isconst;
+            char wasregister = type->isregister;
             /* So we've identified it, we should copy it */
             *type = *ptr->ctype;
             type->isconst |= wasconst;
+            type->isregister = wasregister;
             if ( type->tag && type->size == -1) 
                 type->size = type->tag->size;
             return 0;
@@ -519,7 +521,9 @@ static Type *parse_type(void)
     // Determine namespace
     parse_namespace(type);
 
-    swallow("register");
+    if ( swallow("register") ) {
+        type->isregister = 1;
+    }
     swallow("auto");
 
     type->len = 1;
@@ -1016,11 +1020,18 @@ int declare_local(int local_static)
             }
         } else {
             int size = type->size;
+            int inregister = type->isregister && gen_register_variable_possible(type);
 
-            if  ( size < 0 ) size = 0;
+            if  ( size < 0 || inregister ) size = 0;
 
             declared += size;                        
             sym = addloc(type->name, type, ID_VARIABLE, type->kind, Zsp - declared);
+            if ( inregister ) {
+                /* The caller's ix is saved on top of the locals so far */
+                Zsp = modstk(Zsp - declared, KIND_NONE, NO, YES);
+                declared = 0;
+                gen_register_variable(sym, NO);
+            }
             if ( cmatch('=')) {
                 sym->isassigned = 1;
                 sym->initialised = 1;
@@ -1046,7 +1057,7 @@ int declare_local(int local_static)
                     int   vconst;
                     zdouble val;
 
-                    Zsp = modstk(Zsp - (declared - type->size), KIND_NONE, NO, YES);
+                    Zsp = modstk(Zsp - (declared - size), KIND_NONE, NO, YES);
                     declared = 0;
                     setstage(&before, &start);
                     expr = expression(&vconst, &val, &expr_type);
@@ -1070,7 +1081,11 @@ int declare_local(int local_static)
                         //conv type
                         force(type->kind, expr, type->isunsigned, expr_type->isunsigned, 0);
                     }
-                    gen_store_to_tos(type->kind);
+                    if ( inregister ) {
+                        gen_store_static(sym);
+                    } else {
+                        gen_store_to_tos(type->kind);
+                    }
                 }
             }
         }
@@ -1257,6 +1272,7 @@ Type *dodeclare2(Type **base_type, decl_mode mode)
     char namebuf[NAMESIZE];
     Type *type;
     int   flags = 0;
+    char  isregister;
 
     if ( base_type != NULL && *base_type != NULL ) {
         type = CALLOC(1,sizeof(*type));
@@ -1308,10 +1324,13 @@ Type *dodeclare2(Type **base_type, decl_mode mode)
         return type;
     }
 
+    isregister = type->isregister;
     type = parse_decl(namebuf, type);
 
     if ( type != NULL ) {
         strcpy(type->name, namebuf);
+        // Storage class belongs to the declared object, not the base type
+        type->isregister = isregister;
     }
 
     if ( type->kind == KIND_FUNC ) {
@@ -1785,6 +1804,7 @@ static int get_parameter_size(Type *functype, Type *type)
 static void declfunc(Type *functype, enum storage_type storage)
 {
     int where;
+    int i;
 
 
     currfn = findglb(functype->name);
@@ -1990,6 +2010,17 @@ static void declfunc(Type *functype, enum storage_type storage)
         }
     }
     
+    /* A register parameter is moved into ix now the frame is complete */
+    for ( i = 0; i < array_len(functype->parameters); i++ ) {
+        Type   *ptype = array_get_byindex(functype->parameters, i);
+        SYMBOL *ptr;
+
+        if ( ptype->isregister && gen_register_variable_possible(ptype) && (ptr = findloc(ptype->name)) != NULL ) {
+            gen_register_variable(ptr, YES);
+            break;
+        }
+    }
+
     stackargs = where;
     lastst = STEXP;
     if (statement() != STRETURN && (functype->flags & NAKED) == 0 ) {
@@ -2002,10 +2033,7 @@ static void declfunc(Type *functype, enum storage_type storage)
     }
     goto_cleanup();
     function_appendix(currfn);
-
-#ifdef INBUILT_OPTIMIZER
-    generate();
-#endif
+    insn_flush();
     Zsp = 0;
     infunc = 0; /* not in fn. any more */
 }
@@ -109,6 +109,7 @@ struct type_s {
     char      isconst;
     char      isfar;  // Valid for pointers/array
     char      isvolatile;
+    char      isregister; // Declared with the register storage class
     char      name[NAMESIZE]; 
     char     *namespace; // Which namespace is this object in
     
@@ -219,6 +220,7 @@ struct symbol_s {
         char isassigned;     /* Set if we have assigned to it once */
         char initialised;    /* Initialised at compile time */
         char func_defined;   /* The function has been defined */
+        char isregister;     /* Local variable held in ix rather than on the stack */
         enum symbol_flags flags ;         /* djm, various flags:
                                 bit 0 = unsigned
                                 bit 1 = far data/pointer
@@ -275,6 +277,7 @@ typedef struct gototab_s GOTO_TAB;
 
 struct gototab_s {
         int     sp;             /* Stack pointer to correct to */
+        int     ixslot;         /* Where ix is saved, see gen_register_variable_slot() */
         SYMBOL *sym;            /* Pointer to goto label       */
         int     lineno;         /* line where goto was         */
         int     next;           /* Link to next in goto chain  */
@@ -429,6 +432,11 @@ enum optimisation {
         OPT_UCHAR_MULT     = (1 << 7),
         OPT_DOUBLE_CONST   = (1 << 8),
         OPT_CHAR_COMPARE   = (1 << 9),
+        OPT_SWITCH         = (1 << 10),
+        OPT_MEMSET         = (1 << 11),
+        OPT_MEMCPY         = (1 << 12),
+        OPT_MULT           = (1 << 13),
+        OPT_DIV            = (1 << 14),
 };
 
 enum maths_mode {
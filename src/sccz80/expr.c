@@ -591,6 +591,9 @@ int heira(LVALUE *lval)
         }
         if (lval->indirect_kind)
             return 0;
+        if (lval->symbol->isregister) {
+            errorfmt("Cannot take the address of register variable '%s'", 0, lval->symbol->name);
+        }
         /* global & non-array */
         address(lval->symbol);
         lval->indirect_kind = lval->symbol->ctype->kind;
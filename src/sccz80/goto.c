@@ -140,6 +140,7 @@ int AddGoto(SYMBOL* ptr)
     gptr->next = gqptr; /* store next in chain */
     ptr->more = gotocnt; /* Make us first */
     gptr->sp = Zsp; /* Store current stack */
+    gptr->ixslot = gen_register_variable_slot();
     gptr->sym = ptr; /* What label do we reference */
     gptr->lineno = lineno;
     gptr->label = getlabel();
@@ -163,7 +164,7 @@ void ChaseGoto(SYMBOL* ptr)
     gptr = gotoq + 1;
     for (i = 0; i < gotocnt; i++) {
         debug(DBG_GOTO, "Chasing %s # %d\n", ptr->name, i);
-        if (gptr->sym == ptr && gptr->sp == Zsp) {
+        if (gptr->sym == ptr && gptr->sp == Zsp && gptr->ixslot == gen_register_variable_slot()) {
             debug(DBG_GOTO, "Matched #%d \n", i);
             postlabel(gptr->label);
             gptr->sym = NULL;
@@ -179,7 +180,7 @@ void ChaseGoto(SYMBOL* ptr)
 
 void goto_cleanup(void)
 {
-    int i;
+    int i, savesp;
     GOTO_TAB* gptr;
 
     if (gotocnt == 0)
@@ -193,7 +194,10 @@ void goto_cleanup(void)
                 errorfmt("Unknown label: %s", 1, gptr->sym->name);
             }
             postlabel(gptr->label);
-            modstk((gptr->sym->offset.i) - (gptr->sp), KIND_NONE, NO, YES);
+            savesp = Zsp;
+            Zsp = gptr->sp;
+            gen_unwind_register_variable(gptr->ixslot, gptr->sym->offset.i, KIND_NONE, NO, YES);
+            Zsp = savesp;
             gen_jp_label(gptr->sym->size,1); /* label label(!) */
         }
         gptr++;
@@ -218,7 +222,7 @@ GOTO_TAB* SearchGoto(SYMBOL* ptr)
 
     gptr = gotoq + 1;
     for (i = 0; i <  gotocnt; i++) {
-        if (gptr->sym == ptr && gptr->sp == Zsp)
+        if (gptr->sym == ptr && gptr->sp == Zsp && gptr->ixslot == gen_register_variable_slot())
             return (gptr);
         gptr++;
     }
@@ -0,0 +1,811 @@
+/*
+ *      Small C+ Compiler
+ *
+ *      Instruction list for the body of a function
+ *
+ *      Whilst inside a function the assembler isn't written straight out,
+ *      each line is parsed into an instruction and kept until the end of
+ *      the function. A few passes that need to see the whole function
+ *      (labels and who jumps to them) or what's in the registers are
+ *      run over it before it's written out for copt to carry on with.
+ *
+ *      Lines are only rewritten when a pass changes them, everything
+ *      else comes out exactly as codegen wrote it.
+ */
+
+#include "ccdefs.h"
+
+/* Registers, the alternate set isn't tracked */
+#define R_A         0x0001
+#define R_F         0x0002
+#define R_B         0x0004
+#define R_C         0x0008
+#define R_D         0x0010
+#define R_E         0x0020
+#define R_H         0x0040
+#define R_L         0x0080
+#define R_IXH       0x0100
+#define R_IXL       0x0200
+#define R_IYH       0x0400
+#define R_IYL       0x0800
+#define R_SP        0x1000
+#define R_ALL       0x1fff
+
+/* What a line is */
+#define INSN_COMMENT    0x0001  /* Comments, blank lines, C_LINE: no code */
+#define INSN_LABEL      0x0002  /* Defines a label */
+#define INSN_CODE       0x0004  /* An instruction we know about */
+#define INSN_DIRECTIVE  0x0008  /* Anything else: data, sections, unknown opcodes */
+#define INSN_JUMP       0x0010  /* jp/jr to a label */
+#define INSN_RETURN     0x0020  /* ret, reti, retn */
+#define INSN_COND       0x0040  /* Conditional jump or return */
+#define INSN_INDIRECT   0x0080  /* jp (hl) and friends */
+#define INSN_CALL       0x0100  /* call, rst, djnz: leaves the block */
+#define INSN_DELETED    0x0200
+#define INSN_RELATIVE   0x0400  /* Operand uses ASMPC or $ */
+#define INSN_USER       0x0800  /* From #asm or asm(), never touched */
+
+typedef struct {
+    char       *text;      /* The line as it's written out */
+    char       *opcode;    /* Lower case opcode */
+    char       *operands;  /* Operands without the comment */
+    const char *comment;   /* Points into text, whitespace before the ; */
+    int         label;     /* i_ label defined or jumped to, -1 for other labels */
+    int         flags;
+} t_insn;
+
+static t_insn  *insns;
+static int      insn_count;
+static int      insn_size;
+static int      insn_relative;     /* Lines using ASMPC or $ */
+static int      insn_user;         /* Lines being added are user assembler */
+
+static char    *line_buf;
+static size_t   line_len;
+static size_t   line_size;
+
+static int     *label_refs;
+static int     *label_at;
+static int      label_max;
+
+static const char *known_opcodes[] = {
+    "adc", "add", "and", "bit", "call", "ccf", "cp", "cpl", "dec", "djnz",
+    "ex", "inc", "jp", "jr", "ld", "neg", "nop", "or", "pop", "push", "res",
+    "ret", "reti", "retn", "rl", "rla", "rlc", "rlca", "rr", "rra", "rrc",
+    "rrca", "rst", "sbc", "scf", "set", "sla", "sll", "sra", "srl", "sub",
+    "xor", NULL
+};
+
+static void insn_add_line(void);
+static char *copy_string(const char *str, size_t len);
+static void insn_parse(t_insn *insn);
+static void insn_delete(t_insn *insn);
+static void insn_set_target(t_insn *insn, int label);
+static int  insn_label_number(const char *name);
+static int  insn_regs(t_insn *insn, int *use, int *def);
+static int  operand_regs(const char *operand, int *mem);
+static int  split_operands(const char *operands, char *first, char *second, size_t size);
+static int  next_code(int i);
+static int  is_pinned(int i);
+static void count_labels(void);
+static int  remove_unused_labels(void);
+static int  thread_jumps(void);
+static int  remove_unreachable(void);
+static int  remove_jumps_to_next(void);
+static int  remove_dead_loads(void);
+static int  is_plain_load(t_insn *insn, int *dest);
+static int  is_pair(int regs);
+static void insn_write(t_insn *insn);
+static void insn_free(void);
+
+
+
+/* Called by outbyte() for everything written within a function */
+void insn_outc(char c)
+{
+    if ( c == '\n' ) {
+        insn_add_line();
+        return;
+    }
+    if ( line_len + 1 >= line_size ) {
+        line_size = line_size ? line_size * 2 : 256;
+        line_buf = REALLOC(line_buf, line_size);
+    }
+    line_buf[line_len++] = c;
+}
+
+/* Mark the lines that follow as user assembler (or not) */
+void insn_user_asm(int on)
+{
+    insn_user = on;
+}
+
+/* Optimise the function and write it out */
+void insn_flush(void)
+{
+    int    i, changed;
+
+    if ( insn_count == 0 && line_len == 0 ) {
+        return;
+    }
+    if ( c_insn_optimise ) {
+        label_max = nxtlab + 1;
+        label_refs = CALLOC(label_max, sizeof(int));
+        label_at = CALLOC(label_max, sizeof(int));
+        do {
+            changed = 0;
+            count_labels();
+            changed |= remove_unused_labels();
+            changed |= thread_jumps();
+            changed |= remove_unreachable();
+            changed |= remove_jumps_to_next();
+        } while ( changed );
+        remove_dead_loads();
+        FREENULL(label_refs);
+        FREENULL(label_at);
+    }
+    for ( i = 0; i < insn_count; i++ ) {
+        insn_write(&insns[i]);
+    }
+    if ( line_len ) {
+        /* A line without a newline, can only be an error */
+        line_buf[line_len] = 0;
+        if ( fputs(line_buf, output) == EOF ) {
+            fabort();
+        }
+        line_len = 0;
+    }
+    insn_free();
+}
+
+
+static void insn_add_line(void)
+{
+    t_insn  *insn;
+
+    if ( insn_count == insn_size ) {
+        insn_size = insn_size ? insn_size * 2 : 512;
+        insns = REALLOC(insns, insn_size * sizeof(t_insn));
+    }
+    insn = &insns[insn_count++];
+    insn->text = MALLOC(line_len + 1);
+    memcpy(insn->text, line_buf ? line_buf : "", line_len);
+    insn->text[line_len] = 0;
+    line_len = 0;
+    insn_parse(insn);
+    if ( insn_user ) {
+        insn->flags |= INSN_USER;
+    }
+}
+
+/*
+ * Split a line into label, opcode, operands and comment
+ *
+ * sccz80 writes code as <tab>opcode<tab>operands and labels as .label at
+ * the start of the line, user supplied assembler may look like anything
+ * so whatever isn't recognised is left where it is.
+ */
+static void insn_parse(t_insn *insn)
+{
+    char   *ptr = insn->text;
+    char   *start;
+    int     i, quote = 0;
+
+    insn->opcode = NULL;
+    insn->operands = NULL;
+    insn->comment = "";
+    insn->label = -1;
+    insn->flags = 0;
+
+    if ( *ptr == 0 || *ptr == ';' ) {
+        insn->flags = INSN_COMMENT;
+        return;
+    }
+    if ( !isspace(*ptr) ) {
+        /* A label, either .name or name: */
+        if ( *ptr == '.' ) {
+            ptr++;
+        }
+        start = ptr;
+        while ( *ptr && !isspace(*ptr) && *ptr != ':' && *ptr != ';' ) {
+            ptr++;
+        }
+        insn->flags = INSN_LABEL;
+        start = copy_string(start, ptr - start);
+        insn->label = insn_label_number(start);
+        FREENULL(start);
+        while ( *ptr == ':' || isspace(*ptr) ) {
+            ptr++;
+        }
+        if ( *ptr && *ptr != ';' ) {
+            /* Something follows, don't try and understand it */
+            insn->flags |= INSN_DIRECTIVE;
+            insn->label = -1;
+        }
+        return;
+    }
+    while ( isspace(*ptr) ) {
+        ptr++;
+    }
+    if ( *ptr == 0 || *ptr == ';' ) {
+        insn->flags = INSN_COMMENT;
+        return;
+    }
+    start = ptr;
+    while ( *ptr && !isspace(*ptr) && *ptr != ';' ) {
+        ptr++;
+    }
+    insn->opcode = copy_string(start, ptr - start);
+    for ( start = insn->opcode; *start; start++ ) {
+        *start = tolower(*start);
+    }
+    while ( *ptr == ' ' || *ptr == '\t' ) {
+        ptr++;
+    }
+    start = ptr;
+    while ( *ptr && (quote || *ptr != ';') ) {
+        if ( *ptr == '"' ) {
+            quote = !quote;
+        }
+        ptr++;
+    }
+    while ( ptr > start && isspace(ptr[-1]) ) {
+        ptr--;
+    }
+    insn->operands = copy_string(start, ptr - start);
+    insn->comment = ptr;
+
+    if ( strcmp(insn->opcode, "c_line") == 0 ) {
+        insn->flags = INSN_COMMENT;
+        return;
+    }
+    if ( strstr(insn->operands, "ASMPC") || strchr(insn->operands, '$') ) {
+        insn->flags |= INSN_RELATIVE;
+        insn_relative++;
+    }
+    for ( i = 0; known_opcodes[i] != NULL; i++ ) {
+        if ( strcmp(insn->opcode, known_opcodes[i]) == 0 ) {
+            break;
+        }
+    }
+    if ( known_opcodes[i] == NULL ) {
+        insn->flags |= INSN_DIRECTIVE;
+        return;
+    }
+    insn->flags |= INSN_CODE;
+    if ( strcmp(insn->opcode, "jp") == 0 || strcmp(insn->opcode, "jr") == 0 ) {
+        char *target = strchr(insn->operands, ',');
+
+        if ( target ) {
+            insn->flags |= INSN_COND;
+            target++;
+        } else {
+            target = insn->operands;
+        }
+        if ( *target == '(' ) {
+            insn->flags |= INSN_INDIRECT;
+        } else {
+            insn->flags |= INSN_JUMP;
+            insn->label = insn_label_number(target);
+        }
+    } else if ( strncmp(insn->opcode, "ret", 3) == 0 ) {
+        insn->flags |= INSN_RETURN;
+        if ( *insn->operands ) {
+            insn->flags |= INSN_COND;
+        }
+    } else if ( strcmp(insn->opcode, "call") == 0 || strcmp(insn->opcode, "rst") == 0 || strcmp(insn->opcode, "djnz") == 0 ) {
+        insn->flags |= INSN_CALL;
+    }
+}
+
+/* Returns the number of an i_ label, or -1 */
+static int insn_label_number(const char *name)
+{
+    char   *end;
+    long    num;
+
+    if ( strncmp(name, "i_", 2) != 0 || !isdigit(name[2]) ) {
+        return -1;
+    }
+    num = strtol(name + 2, &end, 10);
+    if ( *end != 0 || num > nxtlab ) {
+        return -1;
+    }
+    return num;
+}
+
+static void insn_delete(t_insn *insn)
+{
+    insn->flags = INSN_DELETED;
+}
+
+/* Point a jump somewhere else, keeping the condition and comment */
+static void insn_set_target(t_insn *insn, int label)
+{
+    char   *comma = strchr(insn->operands, ',');
+    char   *operands;
+    char   *text;
+    size_t  len;
+
+    len = strlen(insn->operands) + 16;
+    operands = MALLOC(len);
+    snprintf(operands, len, "%.*si_%d", comma ? (int)(comma - insn->operands + 1) : 0, insn->operands, label);
+    len = strlen(insn->opcode) + strlen(operands) + strlen(insn->comment) + 3;
+    text = MALLOC(len);
+    snprintf(text, len, "\t%s\t%s", insn->opcode, operands);
+    insn->comment = strcat(text, insn->comment) + strlen(insn->opcode) + strlen(operands) + 2;
+    FREENULL(insn->operands);
+    FREENULL(insn->text);
+    insn->operands = operands;
+    insn->text = text;
+    insn->label = label;
+}
+
+static char *copy_string(const char *str, size_t len)
+{
+    char   *copy = MALLOC(len + 1);
+
+    memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+/* Next line holding an instruction or directive, skipping labels and comments */
+static int next_code(int i)
+{
+    for ( i++; i < insn_count; i++ ) {
+        if ( (insns[i].flags & (INSN_CODE|INSN_DIRECTIVE)) ) {
+            break;
+        }
+    }
+    return i;
+}
+
+/*
+ * Code near a jump to ASMPC+n (or $+n in user code) can't be removed or
+ * change size without moving where it lands. The furthest any of them
+ * reach is a dozen bytes, so that's how many lines either way are left
+ * alone. User assembler is always left alone, there's no telling how it
+ * is reached.
+ */
+static int is_pinned(int i)
+{
+    int    j, n;
+
+    if ( insns[i].flags & INSN_USER ) {
+        return YES;
+    }
+    if ( insn_relative == 0 ) {
+        return NO;
+    }
+    for ( j = i, n = 0; j >= 0 && n <= 12; j-- ) {
+        if ( insns[j].flags & (INSN_CODE|INSN_DIRECTIVE) ) {
+            if ( insns[j].flags & INSN_RELATIVE ) {
+                return YES;
+            }
+            n++;
+        }
+    }
+    for ( j = i + 1, n = 0; j < insn_count && n <= 12; j++ ) {
+        if ( insns[j].flags & (INSN_CODE|INSN_DIRECTIVE) ) {
+            if ( insns[j].flags & INSN_RELATIVE ) {
+                return YES;
+            }
+            n++;
+        }
+    }
+    return NO;
+}
+
+/* Find where the i_ labels are defined and count the references to them */
+static void count_labels(void)
+{
+    t_insn *insn;
+    char   *ptr, *end;
+    long    num;
+    int     i;
+
+    memset(label_refs, 0, label_max * sizeof(int));
+    memset(label_at, 0, label_max * sizeof(int));
+    for ( i = 0; i < insn_count; i++ ) {
+        insn = &insns[i];
+        if ( insn->flags & (INSN_DELETED|INSN_COMMENT) ) {
+            continue;
+        }
+        if ( insn->flags == INSN_LABEL ) {
+            if ( insn->label >= 0 ) {
+                label_at[insn->label] = i + 1;
+            }
+            continue;
+        }
+        ptr = insn->operands ? insn->operands : insn->text;
+        while ( (ptr = strstr(ptr, "i_")) != NULL ) {
+            if ( (ptr == insn->operands || ptr == insn->text || (!isalnum(ptr[-1]) && ptr[-1] != '_')) && isdigit(ptr[2]) ) {
+                num = strtol(ptr + 2, &end, 10);
+                if ( num < label_max && !isalnum(*end) && *end != '_' ) {
+                    label_refs[num]++;
+                }
+            }
+            ptr += 2;
+        }
+    }
+}
+
+/*
+ * Drop labels in the code that nothing jumps to, so the code either side
+ * can be treated as one run. Labels in front of data (or in another
+ * section) may be used from elsewhere in the file so they stay.
+ */
+static int remove_unused_labels(void)
+{
+    int    i, j, incode = YES, changed = NO;
+
+    for ( i = 0; i < insn_count; i++ ) {
+        t_insn *insn = &insns[i];
+
+        if ( (insn->flags & INSN_DIRECTIVE) && insn->opcode && strcmp(insn->opcode, "section") == 0 ) {
+            incode = strcmp(insn->operands, c_code_section) == 0;
+        }
+        if ( insn->flags != INSN_LABEL || insn->label < 0 || label_refs[insn->label] || !incode ) {
+            continue;
+        }
+        j = next_code(i);
+        if ( j < insn_count && (insns[j].flags & INSN_CODE) ) {
+            insn_delete(insn);
+            label_at[insn->label] = 0;
+            changed = YES;
+        }
+    }
+    return changed;
+}
+
+/*
+ * A jump to a jump goes straight to the final destination. Only jp is
+ * touched, jr may not reach. Jumps to a ret are left for copt, it has
+ * better things to do with most of them.
+ */
+static int thread_jumps(void)
+{
+    int    i, j, label, hops, changed = NO;
+
+    for ( i = 0; i < insn_count; i++ ) {
+        t_insn *insn = &insns[i];
+        t_insn *dest;
+
+        if ( (insn->flags & (INSN_JUMP|INSN_USER)) != INSN_JUMP || insn->label < 0 || strcmp(insn->opcode, "jp") ) {
+            continue;
+        }
+        label = insn->label;
+        for ( hops = 0; hops < 16 && label_at[label]; hops++ ) {
+            j = next_code(label_at[label] - 1);
+            if ( j >= insn_count ) {
+                break;
+            }
+            dest = &insns[j];
+            if ( (dest->flags & (INSN_JUMP|INSN_COND)) != INSN_JUMP || dest->label < 0 || dest->label == insn->label ) {
+                break;
+            }
+            label = dest->label;
+        }
+        if ( label != insn->label ) {
+            insn_set_target(insn, label);
+            changed = YES;
+        }
+    }
+    return changed;
+}
+
+/*
+ * Code after an unconditional jump or return that no label leads to.
+ * jp (hl) is left out, it's how jump tables are entered and the table
+ * itself follows it. So are jumps in user assembler, we can't see where
+ * it expects to come back to.
+ */
+static int remove_unreachable(void)
+{
+    int    i, j, changed = NO;
+
+    for ( i = 0; i < insn_count; i++ ) {
+        t_insn *insn = &insns[i];
+
+        if ( (insn->flags & INSN_CODE) == 0 || (insn->flags & (INSN_COND|INSN_USER)) ||
+             (insn->flags & (INSN_JUMP|INSN_RETURN)) == 0 ) {
+            continue;
+        }
+        for ( j = i + 1; j < insn_count; j++ ) {
+            if ( insns[j].flags & (INSN_DELETED|INSN_COMMENT) ) {
+                continue;
+            }
+            if ( (insns[j].flags & INSN_CODE) == 0 || (insns[j].flags & INSN_LABEL) || is_pinned(j) ) {
+                break;
+            }
+            insn_delete(&insns[j]);
+            changed = YES;
+        }
+        i = j - 1;
+    }
+    return changed;
+}
+
+/* A jump to the label that follows it */
+static int remove_jumps_to_next(void)
+{
+    int    i, j, changed = NO;
+
+    for ( i = 0; i < insn_count; i++ ) {
+        t_insn *insn = &insns[i];
+
+        if ( (insn->flags & INSN_JUMP) == 0 || insn->label < 0 ) {
+            continue;
+        }
+        for ( j = i + 1; j < insn_count; j++ ) {
+            if ( insns[j].flags & (INSN_DELETED|INSN_COMMENT) ) {
+                continue;
+            }
+            if ( insns[j].flags != INSN_LABEL || insns[j].label == insn->label ) {
+                break;
+            }
+        }
+        if ( j < insn_count && insns[j].flags == INSN_LABEL && insns[j].label == insn->label && !is_pinned(i) ) {
+            insn_delete(insn);
+            changed = YES;
+        }
+    }
+    return changed;
+}
+
+/*
+ * Registers used by an operand: for (hl), (ix+n) etc the registers in the
+ * address with *mem set. Constants use nothing, -1 if we don't know what
+ * it is (i, r, (c), af', (hl+) and user labels we can't tell from
+ * registers).
+ */
+static int operand_regs(const char *operand, int *mem)
+{
+    static const struct {
+        const char  *name;
+        int          regs;
+    } names[] = {
+        { "a", R_A }, { "b", R_B }, { "c", R_C }, { "d", R_D }, { "e", R_E },
+        { "h", R_H }, { "l", R_L }, { "ixh", R_IXH }, { "ixl", R_IXL },
+        { "iyh", R_IYH }, { "iyl", R_IYL }, { "af", R_A|R_F },
+        { "bc", R_B|R_C }, { "de", R_D|R_E }, { "hl", R_H|R_L },
+        { "ix", R_IXH|R_IXL }, { "iy", R_IYH|R_IYL }, { "sp", R_SP },
+        { NULL, 0 }
+    };
+    int    i;
+
+    *mem = NO;
+    if ( *operand == '(' ) {
+        *mem = YES;
+        operand++;
+        for ( i = 0; names[i].name != NULL; i++ ) {
+            const char *end = operand + 2;
+
+            if ( strlen(names[i].name) != 2 || strncmp(operand, names[i].name, 2) ) {
+                continue;
+            }
+            if ( *end == ')' ) {
+                return names[i].regs;
+            }
+            if ( (*end == '+' || *end == '-') && end[1] != ')' && (names[i].regs & (R_H|R_IXH|R_IYH|R_SP)) ) {
+                /* (ix+n) and Rabbit (hl+n), (sp+n) */
+                return names[i].regs;
+            }
+            return -1;
+        }
+        if ( *operand == '_' || isdigit(*operand) || strncmp(operand, "i_", 2) == 0 ) {
+            return 0;
+        }
+        return -1;
+    }
+    for ( i = 0; names[i].name != NULL; i++ ) {
+        if ( strcmp(operand, names[i].name) == 0 ) {
+            return names[i].regs;
+        }
+    }
+    if ( strcmp(operand, "i") == 0 || strcmp(operand, "r") == 0 || strchr(operand, '\'') ) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Lower case copies of the first and second operands, returns how many there are or -1 */
+static int split_operands(const char *operands, char *first, char *second, size_t size)
+{
+    char   *dest[2];
+    int     n;
+
+    dest[0] = first;
+    dest[1] = second;
+    *first = *second = 0;
+    for ( n = 0; *operands && n < 2; n++ ) {
+        size_t  len = 0;
+
+        while ( isspace(*operands) ) {
+            operands++;
+        }
+        while ( *operands && *operands != ',' ) {
+            if ( len + 1 >= size ) {
+                return -1;
+            }
+            dest[n][len++] = tolower(*operands++);
+        }
+        while ( len && isspace(dest[n][len - 1]) ) {
+            len--;
+        }
+        dest[n][len] = 0;
+        if ( *operands == ',' ) {
+            operands++;
+            if ( n == 1 ) {
+                return -1;
+            }
+        }
+    }
+    return n;
+}
+
+/* What an instruction reads and writes, NO if it's not understood */
+static int insn_regs(t_insn *insn, int *use, int *def)
+{
+    char   *op = insn->opcode;
+    char    first[32], second[32];
+    int     r1 = 0, r2 = 0, mem1 = NO, mem2 = NO, nargs;
+
+    *use = *def = 0;
+    if ( (insn->flags & INSN_CODE) == 0 || (insn->flags & (INSN_JUMP|INSN_INDIRECT|INSN_RETURN|INSN_CALL)) ) {
+        return NO;
+    }
+    if ( (nargs = split_operands(insn->operands, first, second, sizeof(first))) < 0 ) {
+        return NO;
+    }
+    if ( nargs >= 1 && (r1 = operand_regs(first, &mem1)) < 0 ) {
+        return NO;
+    }
+    if ( nargs == 2 && (r2 = operand_regs(second, &mem2)) < 0 ) {
+        return NO;
+    }
+
+    if ( strcmp(op, "ld") == 0 && nargs == 2 ) {
+        *use = r2;
+        if ( mem1 ) {
+            *use |= r1;
+        } else {
+            *def = r1;
+        }
+    } else if ( strcmp(op, "push") == 0 && nargs == 1 ) {
+        *use = r1 | R_SP;
+        *def = R_SP;
+    } else if ( strcmp(op, "pop") == 0 && nargs == 1 ) {
+        *use = R_SP;
+        *def = r1 | R_SP;
+    } else if ( strcmp(op, "ex") == 0 && nargs == 2 ) {
+        *use = *def = r1 | r2;
+    } else if ( (strcmp(op, "inc") == 0 || strcmp(op, "dec") == 0) && nargs == 1 ) {
+        *use = *def = r1;
+        if ( mem1 || (r1 & (r1 - 1)) == 0 ) {
+            /* Only the 8 bit forms set the flags */
+            *def |= R_F;
+        }
+    } else if ( strcmp(op, "add") == 0 || strcmp(op, "adc") == 0 || strcmp(op, "sub") == 0 ||
+                strcmp(op, "sbc") == 0 || strcmp(op, "and") == 0 || strcmp(op, "or") == 0 ||
+                strcmp(op, "xor") == 0 || strcmp(op, "cp") == 0 ) {
+        if ( nargs == 1 ) {
+            /* Accumulator implied */
+            r2 = r1;
+            r1 = R_A;
+        } else if ( nargs != 2 || mem1 ) {
+            return NO;
+        }
+        *use = r1 | r2;
+        *def = (strcmp(op, "cp") == 0 ? 0 : r1) | R_F;
+        if ( strcmp(op, "adc") == 0 || strcmp(op, "sbc") == 0 ) {
+            *use |= R_F;
+        }
+    } else if ( nargs == 0 && (strcmp(op, "rla") == 0 || strcmp(op, "rra") == 0) ) {
+        *use = *def = R_A | R_F;
+    } else if ( nargs == 0 && (strcmp(op, "rlca") == 0 || strcmp(op, "rrca") == 0 ||
+                               strcmp(op, "cpl") == 0 || strcmp(op, "neg") == 0) ) {
+        *use = R_A;
+        *def = R_A | R_F;
+    } else if ( nargs == 0 && strcmp(op, "scf") == 0 ) {
+        *def = R_F;
+    } else if ( nargs == 0 && strcmp(op, "ccf") == 0 ) {
+        *use = *def = R_F;
+    } else if ( nargs == 0 && strcmp(op, "nop") == 0 ) {
+        /* Nothing */
+    } else if ( nargs == 1 && (strcmp(op, "rl") == 0 || strcmp(op, "rr") == 0) ) {
+        *use = *def = r1 | R_F;
+    } else if ( nargs == 1 && (strcmp(op, "rlc") == 0 || strcmp(op, "rrc") == 0 || strcmp(op, "sla") == 0 ||
+                               strcmp(op, "sra") == 0 || strcmp(op, "srl") == 0 || strcmp(op, "sll") == 0) ) {
+        *use = r1;
+        *def = r1 | R_F;
+    } else if ( nargs == 2 && strcmp(op, "bit") == 0 ) {
+        *use = r2;
+        *def = R_F;
+    } else if ( nargs == 2 && (strcmp(op, "set") == 0 || strcmp(op, "res") == 0) ) {
+        *use = *def = r2;
+    } else {
+        return NO;
+    }
+    return YES;
+}
+
+/* A load of a register from a register or a constant, nothing else happens */
+static int is_plain_load(t_insn *insn, int *dest)
+{
+    char   first[32], second[32];
+    int    mem1, mem2, src;
+
+    if ( (insn->flags & INSN_CODE) == 0 || strcmp(insn->opcode, "ld") ||
+         split_operands(insn->operands, first, second, sizeof(first)) != 2 ) {
+        return NO;
+    }
+    *dest = operand_regs(first, &mem1);
+    src = operand_regs(second, &mem2);
+    return *dest > 0 && !mem1 && (*dest & R_SP) == 0 && src >= 0 && !mem2;
+}
+
+/* bc, de, hl, ix or iy as a whole */
+static int is_pair(int regs)
+{
+    return regs == (R_B|R_C) || regs == (R_D|R_E) || regs == (R_H|R_L) ||
+           regs == (R_IXH|R_IXL) || regs == (R_IYH|R_IYL);
+}
+
+/*
+ * Backwards through each run of code keeping track of which registers
+ * will be read, a load into a register pair that's written again before
+ * it's read is dropped. Everything is live where a run ends. Loads into
+ * a single register are left for copt, its rules are written around the
+ * ld h,0 and friends and stop matching once they've gone.
+ */
+static int remove_dead_loads(void)
+{
+    int    i, dest, use, def, live = R_ALL, changed = NO;
+
+    for ( i = insn_count - 1; i >= 0; i-- ) {
+        t_insn *insn = &insns[i];
+
+        if ( insn->flags & (INSN_DELETED|INSN_COMMENT) ) {
+            continue;
+        }
+        if ( insn_regs(insn, &use, &def) == NO ) {
+            live = R_ALL;
+            continue;
+        }
+        if ( is_plain_load(insn, &dest) && is_pair(dest) && (dest & live) == 0 && !is_pinned(i) ) {
+            insn_delete(insn);
+            changed = YES;
+            continue;
+        }
+        live = (live & ~def) | use;
+    }
+    return changed;
+}
+
+static void insn_write(t_insn *insn)
+{
+    if ( insn->flags & INSN_DELETED ) {
+        return;
+    }
+    if ( insn->opcode && strcmp(insn->opcode, "ld") == 0 && strncmp(insn->operands, "hl,i_", 5) == 0 ) {
+        indicate_constant_written(atoi(insn->operands + 5));
+    }
+    if ( fputs(insn->text, output) == EOF || putc('\n', output) == EOF ) {
+        fabort();
+    }
+}
+
+static void insn_free(void)
+{
+    int    i;
+
+    for ( i = 0; i < insn_count; i++ ) {
+        FREENULL(insns[i].text);
+        FREENULL(insns[i].opcode);
+        FREENULL(insns[i].operands);
+    }
+    insn_count = 0;
+    insn_relative = 0;
+}
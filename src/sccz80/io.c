@@ -9,10 +9,6 @@
 #include "ccdefs.h"
 #include <stdarg.h>
 
-#ifdef INBUILT_OPTIMIZER
-int opt_outc(char c);
-#endif
-
 /*
  * get integer of length len bytes from address addr
  */
@@ -194,12 +190,7 @@ void clearstage_info(const char *file, int line, char* before, char* start)
     }
     if (start) {
         if (output != NULL) {
-#ifdef INBUILT_OPTIMIZER
-            if (infunc)
-                AddBuffer(start);
-            else
-#endif
-                outstr(start);
+            outstr(start);
         } else {
             puts(start);
         }
@@ -233,16 +224,13 @@ int outbyte(char c)
         if (output != NULL) {
             if (stagenext) {
                 return (outstage(c));
-            } else {
-#ifdef INBUILT_OPTIMIZER
-                if (infunc)
-                    opt_outc(c);
-                else
-#endif
-                    if (currentbuffer) {
-                    return outbuffer(c);
-                } else if ((putc(c, output)) == EOF)
-                    fabort();
+            } else if (currentbuffer) {
+                return outbuffer(c);
+            } else if (infunc) {
+                /* Function bodies are optimised before being written */
+                insn_outc(c);
+            } else if ((putc(c, output)) == EOF) {
+                fabort();
             }
         } else
             putchar(c);
@@ -265,7 +253,7 @@ int outstage(char c)
 void outstr(const char *ptr)
 {
     const char *loc;
-    if ( stagenext == NULL && currentbuffer == NULL) {
+    if ( stagenext == NULL && currentbuffer == NULL && !infunc ) {
         loc = ptr;
         while (   (loc = strstr(loc,"ld\thl,i_")) != NULL ) {
             int lab;
@@ -353,8 +341,3 @@ void outd2(long n)
     outbyte('0' + n);
 }
 
-/* convert lower case to upper */
-
-#ifdef INBUILT_OPTIMIZER
-#include "opt.c"
-#endif
@@ -38,6 +38,7 @@ int c_notaltreg; /* No alternate registers */
 int c_standard_escapecodes = 0; /* \n = 10, \r = 13 */
 int c_disable_builtins = 0;
 int c_cline_directive = 0;
+int c_insn_optimise = 1;
 int c_cpu = CPU_Z80;
 int c_params_offset = 2;
 int c_old_diagnostic_fmt = 0;
@@ -121,6 +122,7 @@ static option  sccz80_opts[] = {
     { 0, "dataseg", OPT_STRING|OPT_DOUBLE_DASH, "=<name> Set the data section name", &c_data_section, NULL, 0 },
     { 0, "initseg", OPT_STRING|OPT_DOUBLE_DASH, "=<name> Set the initialisation section name", &c_init_section, NULL, 0 },
     { 0, "gcline", OPT_BOOL, "Generate C_LINE directives", &c_cline_directive, NULL, 0 },
+    { 0, "no-insn-opt", OPT_BOOL_FALSE|OPT_DOUBLE_DASH, "Write the code of each function without the built-in optimisation passes", &c_insn_optimise, NULL, 0 },
     { 0, "opt-code-speed", OPT_FUNCTION|OPT_STRING|OPT_DOUBLE_DASH, "Optimise for speed not size", NULL, opt_code_speed, 0},
     { 0, "", OPT_HEADER, "Framepointer configuration (for debugging):", NULL, NULL, 0 },
     { 0, "frameix", OPT_ASSIGN|OPT_INT, "Use ix as the frame pointer", &c_framepointer_is_ix, NULL, 1},
@@ -882,6 +884,7 @@ void closeout()
 {
     tofile(); /* if diverted, return to file */
     if (output) {
+        insn_flush();
         /* if open, close it */
         fclose(output);
     }
@@ -922,6 +925,16 @@ static void opt_code_speed(option *arg, char* val)
             c_speed_optimisation |= OPT_UCHAR_MULT;
         } else if ( strncmp(ptr, "floatconst", 10) == 0 ) {
             c_speed_optimisation |= OPT_DOUBLE_CONST;
+        } else if ( strncmp(ptr, "switch", 6) == 0 ) {
+            c_speed_optimisation |= OPT_SWITCH;
+        } else if ( strncmp(ptr, "memset", 6) == 0 ) {
+            c_speed_optimisation |= OPT_MEMSET;
+        } else if ( strncmp(ptr, "memcpy", 6) == 0 ) {
+            c_speed_optimisation |= OPT_MEMCPY;
+        } else if ( strncmp(ptr, "mult", 4) == 0 ) {
+            c_speed_optimisation |= OPT_MULT;
+        } else if ( strncmp(ptr, "div", 3) == 0 ) {
+            c_speed_optimisation |= OPT_DIV;
         }
     } while ( (ptr = strchr(ptr, ',')) != NULL );
 }
@@ -52,7 +52,18 @@ int primary(LVALUE* lval)
             immedlit(litlab,lval->const_val);
             nl();
             return 0;
-        } else if ((ptr = findloc(sname))) {
+        } else if ((ptr = findloc(sname)) && ptr->isregister ) {
+            /* Held in ix, so it's accessed like a static */
+            lval->symbol = ptr;
+            lval->ltype = ptr->ctype;
+            lval->indirect_kind = KIND_NONE;
+            lval->val_type = ptr->ctype->kind;
+            lval->flags = ptr->flags;
+            if ( ispointer(lval->ltype) ) {
+                lval->ptr_type = ptr->ctype->ptr->kind;
+            }
+            return (1);
+        } else if (ptr) {
             lval->base_offset = getloc(ptr, 0);
             lval->offset = 0;
             lval->symbol = ptr;
@@ -688,7 +699,7 @@ void smartpush(LVALUE* lval, char* before)
  */
 void smartstore(LVALUE* lval)
 {
-    if (lval->ltype->size != 2 || lval->symbol == NULL || lval->symbol->storage != STKLOC ) {
+    if (lval->ltype->size != 2 || lval->symbol == NULL || lval->symbol->storage != STKLOC || lval->symbol->isregister ) {
         store(lval);
     } else {
         switch ((lval->symbol->offset.i) - Zsp) {
@@ -70,8 +70,7 @@ int statement()
             dodeclare(EXTERNAL);
             return lastst;
         }
-        /* Ignore the register and auto keywords! */
-        swallow("register");
+        /* Ignore the auto keyword, register is picked up by the declaration */
         swallow("auto");
 
         /* Check to see if specified as static, and also for far and near */
@@ -502,16 +501,7 @@ void doswitch()
     suspendbuffer();
 
     postlabel(endlab);
-    gen_switch_preamble(switch_type->kind);
-    while (swptr < swnext ) {
-        gen_switch_case(switch_type->kind, swptr->value, swptr->label);
-        ++swptr;
-    }
-    gen_switch_postamble(switch_type->kind);
-    if (swdefault)
-        gen_jp_label(swdefault,1);
-    else
-        gen_jp_label(wq.exit,1);
+    gen_switch(switch_type, swptr, swnext - swptr, swdefault ? swdefault : wq.exit);
 
     clearbuffer(buf);
 
@@ -665,6 +655,7 @@ void doasmfunc(char wantbr)
     if (wantbr)
         needchar('(');
 
+    insn_user_asm(YES);
     outbyte('\t');
     needchar('"');
     do {
@@ -688,6 +679,7 @@ void doasmfunc(char wantbr)
     if ( !lastwasLF ) {
         outbyte('\n');
     }
+    insn_user_asm(NO);
 }
 
 /*
@@ -699,10 +691,7 @@ void doasmfunc(char wantbr)
 void doasm()
 {
     cmode = 0; /* mark mode as "asm" */
-
-#ifdef INBUILT_OPTIMIZER
-    generate(); /* Dump queued stuff to be opt'd */
-#endif
+    insn_user_asm(YES);
     while (1) {
         preprocess(); /* get and print lines */
         if (match("#endasm") || eof) {
@@ -710,6 +699,7 @@ void doasm()
         }
         outfmt("%s\n",line);
     }
+    insn_user_asm(NO);
     clear(); /* invalidate line */
     if (eof)
         errorfmt("Unterminated assembler code",1);
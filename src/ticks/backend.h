@@ -7,6 +7,7 @@
 struct debugger_regs_t;
 
 typedef uint8_t (*get_get_memory_cb)(uint16_t at);
+typedef int (*get_bank_cb)(uint16_t at);
 typedef uint16_t (*get_uint16_cb)();
 typedef long long (*get_longlong_cb)();
 typedef int (*get_int_cb)();
@@ -41,6 +42,7 @@ typedef struct {
     get_uint16_cb pc;
     get_uint16_cb sp;
     get_get_memory_cb get_memory;
+    get_bank_cb bank;               /* bank paged in at an address, -1 if not banked, may be NULL */
     get_regs_cb get_regs;
     get_regs_cb set_regs;
     get_int_cb f;
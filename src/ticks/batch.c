@@ -0,0 +1,390 @@
+/*
+ * Batch mode: runs the tests listed in a manifest from one z88dk-ticks
+ * process
+ *
+ * Every run is a forked child of the process once the hooks, the backend
+ * and the tape buffer are set up, so it starts from the same state as a
+ * new z88dk-ticks. The child still parses its own arguments and loads its
+ * map file and binary, as those differ from test to test and set the
+ * global emulator state. It ends by exiting as usual, either from the exit
+ * hook or when the cycle limit is reached. Up to -j children run at the
+ * same time, the results are reported in manifest order.
+ */
+
+#include "ticks.h"
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define BATCH_LINE_MAX  4096
+
+typedef struct {
+    int         line;           /* in the manifest */
+    int         expected;       /* exit code */
+    int         argc;
+    char      **argv;
+    const char *name;           /* the last argument, usually the binary */
+    int         status;         /* exit code, -1 if it didn't exit */
+    int         signal;         /* that killed it */
+    long long   cycles;         /* -1 if unknown */
+    double      seconds;
+    char       *output;         /* stdout and stderr */
+    int         done;
+#ifndef _WIN32
+    pid_t       pid;
+    FILE       *out;
+    FILE       *res;
+    struct timeval started;
+#endif
+} batch_test;
+
+static const char *program_name = "z88dk-ticks";
+
+
+static void batch_die(const char *fmt, const char *arg)
+{
+    fprintf(stderr, fmt, arg);
+    exit(1);
+}
+
+// Split a manifest line into arguments, double quotes group words
+static char **split_args(char *line, int *argc)
+{
+    char  **argv = calloc(strlen(line) / 2 + 3, sizeof(char *));
+    char   *in = line, *out = line;
+
+    *argc = 0;
+    argv[(*argc)++] = (char *)program_name;
+    while ( 1 ) {
+        int quoted = 0;
+
+        while ( isspace((unsigned char)*in) )
+            in++;
+        if ( *in == 0 || *in == '#' )
+            break;
+        argv[(*argc)++] = out;
+        while ( *in && (quoted || !isspace((unsigned char)*in)) ) {
+            if ( *in == '"' )
+                quoted = !quoted;
+            else
+                *out++ = *in;
+            in++;
+        }
+        if ( *in )
+            in++;
+        *out++ = 0;
+    }
+    argv[*argc] = NULL;
+    return argv;
+}
+
+static batch_test *read_manifest(const char *filename, int *num_tests)
+{
+    FILE       *fp = fopen(filename, "r");
+    batch_test *tests = NULL;
+    char        buf[BATCH_LINE_MAX];
+    int         line = 0, size = 0;
+
+    if ( fp == NULL )
+        batch_die("Cannot open manifest %s\n", filename);
+
+    *num_tests = 0;
+    while ( fgets(buf, sizeof(buf), fp) != NULL ) {
+        batch_test *test;
+        char       *end;
+        long        expected;
+
+        line++;
+        if ( strchr(buf, '\n') == NULL && !feof(fp) )
+            batch_die("Line too long in manifest %s\n", filename);
+        expected = strtol(buf, &end, 10);
+        if ( end == buf ) {
+            // Blank and comment lines
+            while ( isspace((unsigned char)*end) )
+                end++;
+            if ( *end == 0 || *end == '#' )
+                continue;
+            batch_die("Expected exit code missing in manifest %s\n", filename);
+        }
+        if ( *num_tests == size ) {
+            size = size ? size * 2 : 64;
+            tests = realloc(tests, size * sizeof(batch_test));
+        }
+        test = &tests[(*num_tests)++];
+        memset(test, 0, sizeof(*test));
+        test->line = line;
+        test->expected = (int)expected;
+        test->argv = split_args(strdup(end), &test->argc);
+        if ( test->argc < 2 )
+            batch_die("Binary missing in manifest %s\n", filename);
+        test->name = test->argv[test->argc - 1];
+        test->status = -1;
+        test->cycles = -1;
+    }
+    fclose(fp);
+    return tests;
+}
+
+static int batch_passed(batch_test *test)
+{
+    return test->status == test->expected;
+}
+
+static void report_tap(batch_test *test, int number)
+{
+    printf("%s %d - %s", batch_passed(test) ? "ok" : "not ok", number, test->name);
+    if ( test->cycles >= 0 )
+        printf(" # cycles %lld", test->cycles);
+    printf("\n");
+    if ( !batch_passed(test) ) {
+        char *line = test->output;
+
+        printf("# manifest line %d: ", test->line);
+        if ( test->signal )
+            printf("killed by signal %d", test->signal);
+        else if ( test->status < 0 )
+            printf("did not run");
+        else
+            printf("exit code %d, expected %d", test->status, test->expected);
+        printf("\n");
+        while ( line && *line ) {
+            char *next = strchr(line, '\n');
+            int   len = next ? (int)(next - line) : (int)strlen(line);
+
+            printf("#   %.*s\n", len, line);
+            line = next ? next + 1 : line + len;
+        }
+    }
+    fflush(stdout);
+}
+
+static void xml_escaped(FILE *fp, const char *text)
+{
+    for ( ; text && *text; text++ ) {
+        switch ( *text ) {
+        case '<':  fputs("&lt;", fp);   break;
+        case '>':  fputs("&gt;", fp);   break;
+        case '&':  fputs("&amp;", fp);  break;
+        case '"':  fputs("&quot;", fp); break;
+        default:
+            // Control characters are not allowed in XML 1.0
+            if ( (unsigned char)*text >= ' ' || *text == '\n' || *text == '\t' )
+                fputc(*text, fp);
+            break;
+        }
+    }
+}
+
+static void write_junit(const char *filename, batch_test *tests, int num_tests)
+{
+    FILE   *fp = fopen(filename, "w");
+    double  seconds = 0;
+    int     failures = 0;
+    int     i;
+
+    if ( fp == NULL )
+        batch_die("Cannot write JUnit report %s\n", filename);
+
+    for ( i = 0; i < num_tests; i++ ) {
+        seconds += tests[i].seconds;
+        failures += !batch_passed(&tests[i]);
+    }
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(fp, "<testsuite name=\"z88dk-ticks\" tests=\"%d\" failures=\"%d\" time=\"%.3f\">\n",
+            num_tests, failures, seconds);
+    for ( i = 0; i < num_tests; i++ ) {
+        batch_test *test = &tests[i];
+
+        fprintf(fp, "  <testcase classname=\"z88dk-ticks\" name=\"");
+        xml_escaped(fp, test->name);
+        fprintf(fp, "\" time=\"%.3f\">\n", test->seconds);
+        if ( test->cycles >= 0 )
+            fprintf(fp, "    <properties><property name=\"cycles\" value=\"%lld\"/></properties>\n", test->cycles);
+        if ( !batch_passed(test) ) {
+            if ( test->signal )
+                fprintf(fp, "    <failure message=\"killed by signal %d\"/>\n", test->signal);
+            else
+                fprintf(fp, "    <failure message=\"exit code %d, expected %d\"/>\n", test->status, test->expected);
+        }
+        if ( test->output && *test->output ) {
+            fprintf(fp, "    <system-out>");
+            xml_escaped(fp, test->output);
+            fprintf(fp, "</system-out>\n");
+        }
+        fprintf(fp, "  </testcase>\n");
+    }
+    fprintf(fp, "</testsuite>\n");
+    fclose(fp);
+}
+
+static char *read_all(FILE *fp)
+{
+    long  size;
+    char *text;
+
+    // The child wrote through its own descriptor
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    text = malloc(size + 1);
+    rewind(fp);
+    size = (long)fread(text, 1, size, fp);
+    text[size] = 0;
+    return text;
+}
+
+#ifdef _WIN32
+// No fork(): each test is a new z88dk-ticks, cycles are not reported
+static void run_tests(batch_test *tests, int num_tests, int jobs, batch_run_cb run)
+{
+    int i, j;
+
+    (void)jobs;
+    (void)run;
+    for ( i = 0; i < num_tests; i++ ) {
+        batch_test *test = &tests[i];
+        char        cmd[BATCH_LINE_MAX * 2];
+        time_t      started = time(NULL);
+        size_t      len;
+
+        len = snprintf(cmd, sizeof(cmd), "\"\"%s\"", program_name);
+        for ( j = 1; j < test->argc && len < sizeof(cmd); j++ )
+            len += snprintf(cmd + len, sizeof(cmd) - len, " \"%s\"", test->argv[j]);
+        if ( len < sizeof(cmd) )
+            snprintf(cmd + len, sizeof(cmd) - len, "\"");
+        fflush(stdout);
+        test->status = system(cmd);
+        test->seconds = difftime(time(NULL), started);
+        test->done = 1;
+        report_tap(test, i + 1);
+    }
+}
+#else
+static FILE *batch_result = NULL;
+
+// In the child: pass the cycle count to the parent however the run ends
+static void write_result(void)
+{
+    fprintf(batch_result, "%lld\n", st);
+    fflush(batch_result);
+}
+
+static void start_test(batch_test *test, batch_run_cb run)
+{
+    test->out = tmpfile();
+    test->res = tmpfile();
+    if ( test->out == NULL || test->res == NULL )
+        batch_die("Cannot create temporary files%s\n", "");
+
+    fflush(stdout);
+    fflush(stderr);
+    gettimeofday(&test->started, NULL);
+    test->pid = fork();
+    if ( test->pid == 0 ) {
+        dup2(fileno(test->out), STDOUT_FILENO);
+        dup2(fileno(test->out), STDERR_FILENO);
+        batch_result = test->res;
+        atexit(write_result);
+        exit(run(test->argc, test->argv));
+    } else if ( test->pid < 0 ) {
+        batch_die("Cannot start %s\n", test->name);
+    }
+}
+
+static void finish_test(batch_test *test, int status)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    test->seconds = (now.tv_sec - test->started.tv_sec) + (now.tv_usec - test->started.tv_usec) / 1e6;
+    if ( WIFEXITED(status) ) {
+        test->status = WEXITSTATUS(status);
+        // Exit codes are 8 bits, exit(-1) is seen as 255
+        if ( (signed char)test->status == test->expected )
+            test->status = test->expected;
+    } else if ( WIFSIGNALED(status) ) {
+        test->signal = WTERMSIG(status);
+    }
+    test->output = read_all(test->out);
+    rewind(test->res);
+    if ( fscanf(test->res, "%lld", &test->cycles) != 1 )
+        test->cycles = -1;
+    fclose(test->out);
+    fclose(test->res);
+    test->out = test->res = NULL;
+    test->pid = 0;
+    test->done = 1;
+}
+
+static void run_tests(batch_test *tests, int num_tests, int jobs, batch_run_cb run)
+{
+    int next = 0;           /* next test to start */
+    int reported = 0;       /* tests reported so far, in manifest order */
+    int running = 0;
+
+    while ( reported < num_tests ) {
+        pid_t pid;
+        int   status, i;
+
+        for ( ; next < num_tests && running < jobs; next++, running++ )
+            start_test(&tests[next], run);
+
+        pid = wait(&status);
+        if ( pid < 0 )
+            batch_die("Lost track of the tests%s\n", "");
+        for ( i = reported; i < next; i++ ) {
+            if ( tests[i].pid == pid ) {
+                finish_test(&tests[i], status);
+                running--;
+                break;
+            }
+        }
+        while ( reported < next && tests[reported].done ) {
+            report_tap(&tests[reported], reported + 1);
+            reported++;
+        }
+    }
+}
+#endif
+
+int batch_main(int argc, char **argv, batch_run_cb run)
+{
+    const char *manifest = NULL;
+    const char *junit = NULL;
+    batch_test *tests;
+    int         num_tests, jobs = 1, failures = 0, i;
+
+    program_name = argv[0];
+    for ( i = 1; i < argc; i++ ) {
+        if ( strcmp(argv[i], "-batch") == 0 && i + 1 < argc ) {
+            manifest = argv[++i];
+        } else if ( strcmp(argv[i], "-j") == 0 && i + 1 < argc ) {
+            jobs = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "-junit") == 0 && i + 1 < argc ) {
+            junit = argv[++i];
+        } else {
+            batch_die("Wrong Argument for -batch: %s\n", argv[i]);
+        }
+    }
+    if ( manifest == NULL )
+        batch_die("Manifest missing for -batch%s\n", "");
+    if ( jobs < 1 )
+        jobs = 1;
+
+    tests = read_manifest(manifest, &num_tests);
+    printf("1..%d\n", num_tests);
+    run_tests(tests, num_tests, jobs, run);
+    for ( i = 0; i < num_tests; i++ )
+        failures += !batch_passed(&tests[i]);
+    printf("# %d of %d tests passed\n", num_tests - failures, num_tests);
+    if ( junit != NULL )
+        write_junit(junit, tests, num_tests);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Runs one emulation with the command line arguments of z88dk-ticks, returns the exit code */
+typedef int (*batch_run_cb)(int argc, char **argv);
+
+/*
+ * z88dk-ticks -batch <manifest> [-j N] [-junit <file>]
+ *
+ * Each line of the manifest is the expected exit code followed by the
+ * arguments of one run, eg. "0 -w 30 -mz180 test.bin". The runs start from
+ * the state left by the initialisation of ticks, the results are written as
+ * TAP to stdout and optionally as a JUnit report. Returns the exit code of
+ * z88dk-ticks: 0 if all runs exited with the expected code.
+ */
+extern int batch_main(int argc, char **argv, batch_run_cb run);
+
+#endif
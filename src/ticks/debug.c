@@ -20,7 +20,19 @@ static debug_sym_symbol* cdb_global_symbols = NULL;
 static debug_sym_file* cdb_files = NULL;
 
 static debug_sym_type* cdb_ctypes = NULL;
-static cline *clines[65536] = {0};
+
+// C lines ordered by address, the last one added for an address wins.
+// Sorted on the first lookup after lines were added.
+typedef struct {
+    int            address;
+    int            order;
+    cline         *cl;
+} cline_entry;
+
+static cline_entry *clines = NULL;
+static int          clines_count = 0;
+static int          clines_size = 0;
+static int          clines_sorted = 1;
 
 
 // Crude dehexer....
@@ -745,7 +757,45 @@ void debug_add_cline(const char *filename, const char *function, int lineno, int
     cl->scope_block = scope_block;
     HASH_ADD_INT(cf->lines, line, cl);
 
-    clines[cl->address] = cl;  // TODO Banking
+    if ( clines_count == clines_size ) {
+        clines_size = clines_size ? clines_size * 2 : 1024;
+        clines = realloc(clines, clines_size * sizeof(cline_entry));
+    }
+    clines[clines_count].address = cl->address;
+    clines[clines_count].order = clines_count;
+    clines[clines_count].cl = cl;
+    clines_count++;
+    clines_sorted = 0;
+}
+
+static int cline_compare(const void *a, const void *b)
+{
+    const cline_entry *c1 = a;
+    const cline_entry *c2 = b;
+
+    if ( c1->address != c2->address ) {
+        return c1->address < c2->address ? -1 : 1;
+    }
+    return c1->order - c2->order;
+}
+
+static void clines_sort(void)
+{
+    int i, count = 0;
+
+    qsort(clines, clines_count, sizeof(cline_entry), cline_compare);
+    for ( i = 0; i < clines_count; i++ ) {
+        if ( count && clines[count - 1].address == clines[i].address ) {
+            count--;
+        }
+        clines[count++] = clines[i];
+    }
+    // Lines added later are ordered after these ones
+    for ( i = 0; i < count; i++ ) {
+        clines[i].order = i;
+    }
+    clines_count = count;
+    clines_sorted = 1;
 }
 
 int debug_find_source_location(int address, const char **filename, int *lineno)
@@ -756,17 +806,28 @@ int debug_find_source_location(int address, const char **filename, int *lineno)
         // no symbol - no address!
         return -1;
     }
-    int topmost_address = original_sym->address;
+    // Where the address is in the bank of the symbol
+    int banked_address = original_sym->address + offset;
+    int lo = 0, hi;
 
-    while ( clines[address] == NULL && address > 0 ) {
-        if (address < topmost_address) {
-            return -1;
+    if ( !clines_sorted ) {
+        clines_sort();
+    }
+    hi = clines_count;
+    while ( lo < hi ) {
+        int mid = lo + (hi - lo) / 2;
+
+        if ( clines[mid].address <= banked_address ) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        address--;
     }
-    if ( clines[address] == NULL) return -1;
-    *filename = clines[address]->file->file;
-    *lineno = clines[address]->line;
+    if ( lo == 0 || clines[lo - 1].address < (int)original_sym->address ) {
+        return -1;
+    }
+    *filename = clines[lo - 1].cl->file->file;
+    *lineno = clines[lo - 1].cl->line;
 
     return 0;
 }
@@ -21,6 +21,7 @@
 #include "debug.h"
 #include "backend.h"
 #include "profiler.h"
+#include "recorder.h"
 #include "syms.h"
 #include "linenoise.h"
 #include "srcfile.h"
@@ -175,7 +176,7 @@ static command commands[] = {
     { "out",       cmd_out,         "<address> <value>",    "Send to IO bus"},
     { "trace",     cmd_trace,       "<on/off>",             "Disassemble every instruction"},
     { "hotspot",   cmd_hotspot,     "<on/off>",             "Track address counts and write to hotspots file"},
-    { "profiler",  cmd_profiler,    "[-f fun][-i iter]",    "start/stop profiling (-f function limit, -i iteration limit)"},
+    { "profiler",  cmd_profiler,    "[-f fun][-i iter][-c file]", "start/stop profiling (-f function limit, -i iteration limit, -c cycle profile, folded stacks to file)"},
     { "list",      cmd_list,        "[<address>]",          "List the source code at location given or pc"},
     { "help",      cmd_help,        "",                     "Display this help text" },
     { "whatis/rmt",cmd_typeof,      "",                     NULL },
@@ -440,6 +441,28 @@ int debugger_evaluate(char* line)
     return return_to_execution;
 }
 
+/* Prints the registers and the instruction at pc, as -trace does */
+void debugger_print_trace()
+{
+    char buf[2048];
+
+    cmd_registers(0, NULL);
+    disassemble2(bk.pc(), buf, sizeof(buf), 0);
+
+    if (interact_with_tty)
+        bk.console( "\n%s\n\n",buf);    // In case of active tty, double LF to improve layout in case of 'cont'
+    else
+        bk.console("%s\n",buf);         // Unchanged in case of non-active tty
+}
+
+/* Returns non-zero if debugger() has to run before every instruction */
+int debugger_instrumented()
+{
+    return debugger_active || debugger_break_requested || trace || hotspot ||
+           breakpoints != NULL || watchpoints != NULL || temporary_breakpoints != NULL ||
+           profiler_enabled || profiler_cycles_enabled || recorder_enabled;
+}
+
 void debugger()
 {
     static char *last_line = NULL;
@@ -452,13 +475,7 @@ void debugger()
     }
 
     if ( trace ) {
-        cmd_registers(0, NULL);
-        disassemble2(bk.pc(), buf, sizeof(buf), 0);
-
-        if (interact_with_tty)
-            bk.console( "\n%s\n\n",buf);    // In case of active tty, double LF to improve layout in case of 'cont'
-        else
-            bk.console("%s\n",buf);         // Unchanged in case of non-active tty
+        debugger_print_trace();
     }
 
     if ( hotspot ) {
@@ -476,6 +493,14 @@ void debugger()
         last_hotspot_st = st;
     }
 
+    if ( profiler_cycles_enabled ) {
+        profiler_cycles_step();
+    }
+
+    if ( recorder_enabled ) {
+        recorder_step();
+    }
+
     int dodebug = process_temp_breakpoints();
 
     if (dodebug) {
@@ -1306,7 +1331,7 @@ static int cmd_registers(int argc, char **argv)
     const unsigned short pc = bk.pc();
     const unsigned short sp = bk.sp();
 
-    struct debugger_regs_t regs;
+    struct debugger_regs_t regs = {0};
     bk.get_regs(&regs);
 
     if (interact_with_tty) {
@@ -1739,6 +1764,10 @@ static int cmd_profiler(int argc, char **argv)
         profiler_stop();
         return 0;
     }
+    if (profiler_cycles_enabled) {
+        profiler_cycles_stop();
+        return 0;
+    }
 
     const char* function_only = NULL;
     int limit = 0;
@@ -1749,6 +1778,9 @@ static int cmd_profiler(int argc, char **argv)
             limit = atoi(argv[++i]);
         } else if (strcmp(arg, "-f") == 0) {
             function_only = argv[++i];
+        } else if (strcmp(arg, "-c") == 0) {
+            profiler_cycles_start(argv[++i]);
+            return 0;
         }
     }
 
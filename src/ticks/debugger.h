@@ -15,6 +15,8 @@ extern size_t current_frame;
 
 extern void debugger_init();
 extern void debugger();
+extern int debugger_instrumented();
+extern void debugger_print_trace();
 extern uint8_t debugger_read_symbol_file(char* symbol_file);
 extern void debugger_restore_pending_binary_file();
 int debugger_evaluate(char* line);
@@ -207,6 +207,7 @@ backend_t ticks_debugger_backend = {
     .pc = &get_pc,
     .sp = &get_sp,
     .get_memory = &get_ticks_memory,
+    .bank = &memory_bank,
     .get_regs = &get_regs,
     .set_regs = &set_regs,
     .f = &f,
@@ -5,25 +5,39 @@
 #include "ticks.h"
 #include "backend.h"
 #include "debugger.h"
+#include "recorder.h"
 #include <stdio.h>
 
 
 
-typedef uint8_t *(*memory_func)(int pc);
+/* The 64k address space is mapped through a table of 4k pages, rebuilt
+   by the memory model whenever the paging changes */
+#define PAGE_SHIFT      12
+#define PAGE_SIZE       (1 << PAGE_SHIFT)
+#define PAGE_MASK       (PAGE_SIZE - 1)
+#define NUM_PAGES       (65536 / PAGE_SIZE)
+
+#define PAGE_WRITABLE   0
+#define PAGE_READONLY   1
+#define PAGE_PARTIAL    2       /* Read only below rom_size */
 
 
 static void     standard_init(void);
-static uint8_t *standard_get_memory_addr(int pc);
+static void     standard_map_pages(void);
 static void     zxn_init(void);
-static uint8_t *zxn_get_memory_addr(int pc);
+static void     zxn_map_pages(void);
 static void     zxn_handle_out(int port, int value);
 static void     zx_init(char *config);
-static uint8_t *zx_get_memory_addr(int pc);
+static void     zx_map_pages(void);
 static void     zx_handle_out(int port, int value);
 static void     z180_init(void);
-static uint8_t *z180_get_memory_addr(int pc);
+static void     z180_map_pages(void);
 static void     z180_handle_out(int port, int value);
 
+static uint8_t *pages[NUM_PAGES];
+static uint8_t  page_protect[NUM_PAGES];
+static int      page_bank[NUM_PAGES];       /* Bank of each page, -1 for unbanked memory */
+
 static unsigned char *mem;
 static unsigned char  zxnext_mmu[8] = {0xff};
 static unsigned char *zxn_banks[256];
@@ -32,7 +46,7 @@ static unsigned char  zx_pages[4] = { 0x11, 0x05, 0x02, 0x00 };
 static unsigned char *zx_banks[8];
 static unsigned char *zx_rom[2];
 
-static memory_func   get_mem_addr;
+static void        (*map_pages)(void);
 static void        (*handle_out)(int port, int value);
 
 void memory_init(char *model) {
@@ -50,26 +64,59 @@ void memory_init(char *model) {
         fprintf(stderr, "Unknown memory model %s\n",model);
         exit(1);
     }
+    map_pages();
+}
+
+void memory_set_rom_size(int size)
+{
+    int  i;
+
+    rom_size = size;
+    for ( i = 0; i < NUM_PAGES; i++ ) {
+        if ( rom_size >= (i + 1) * PAGE_SIZE ) {
+            page_protect[i] = PAGE_READONLY;
+        } else if ( rom_size > i * PAGE_SIZE ) {
+            page_protect[i] = PAGE_PARTIAL;
+        } else {
+            page_protect[i] = PAGE_WRITABLE;
+        }
+    }
 }
 
 uint8_t get_memory(uint16_t pc)
 {
-  bk.debugger_read_memory(pc);
-  return  *get_memory_addr(pc);
+  if ( watchpoints != NULL )
+    bk.debugger_read_memory(pc);
+  return pages[pc >> PAGE_SHIFT][pc & PAGE_MASK];
 }
 
 uint8_t put_memory(uint16_t pc, uint8_t b)
 {
-  bk.debugger_write_memory(pc, b);
-  if (pc < rom_size)
-    return *get_memory_addr(pc);
-  else
-    return *get_memory_addr(pc) = b;
+  uint8_t *addr = &pages[pc >> PAGE_SHIFT][pc & PAGE_MASK];
+
+  if ( watchpoints != NULL )
+    bk.debugger_write_memory(pc, b);
+  switch ( page_protect[pc >> PAGE_SHIFT] ) {
+  case PAGE_READONLY:
+    return *addr;
+  case PAGE_PARTIAL:
+    if ( pc < rom_size )
+      return *addr;
+  }
+  if ( recorder_enabled )
+    recorder_write(pc, b);
+  return *addr = b;
+}
+
+int memory_bank(uint16_t pc)
+{
+    return page_bank[pc >> PAGE_SHIFT];
 }
 
 uint8_t *get_memory_addr(int pc)
 {
-    return get_mem_addr(pc);
+    pc &= 0xffff;
+    return &pages[pc >> PAGE_SHIFT][pc & PAGE_MASK];
 }
 
 void memory_handle_paging(int port, int value)
@@ -85,6 +132,9 @@ void memory_reset_paging()
     for ( i = 0; i < 8; i++ )  {
         zxnext_mmu[i] = 0xff;
     }
+    if ( map_pages ) {
+        map_pages();
+    }
 }
 
 // Z180 MMU support
@@ -97,26 +147,36 @@ static uint8_t z180_BBR = 0x00;
 #define Z180_IO_BBR 57
 #define Z180_IO_CBAR 58
 
-static uint8_t *z180_get_memory_addr(int pc)
+static void z180_map_pages(void)
 {
     /*
     CBAR is an 8 bit I/O port that can be accessed by the processor's OUT and IN instructions. 
     The lower 4 bits specify the starting address of the bank area, and the upper 4 give the start of common 1. 
    */
-    // Are we in bank area?
     int bank_start = ((z180_CBAR) & 0x0f) << 12;
     int common1_start =  ((z180_CBAR) & 0xf0) << 8;
-    if ( pc >= bank_start && pc < common1_start ) {
-        // Bank area
-        // Physical = Logical + (BBR * 4096)
-        return &z180_mem[ (pc & 0x0fff) + (z180_BBR * 4096)];
-    } else if ( pc >= common1_start ) {
-        // Common 1
-        // Physical = Logical + (CBR * 4096)
-        return &z180_mem[ (pc & 0x0fff) + (z180_CBR * 4096)];
+    int i;
+
+    for ( i = 0; i < NUM_PAGES; i++ ) {
+        int pc = i * PAGE_SIZE;
+
+        // Are we in bank area?
+        if ( pc >= bank_start && pc < common1_start ) {
+            // Bank area
+            // Physical = Logical + (BBR * 4096)
+            pages[i] = &z180_mem[z180_BBR * 4096];
+            page_bank[i] = z180_BBR;
+        } else if ( pc >= common1_start ) {
+            // Common 1
+            // Physical = Logical + (CBR * 4096)
+            pages[i] = &z180_mem[z180_CBR * 4096];
+            page_bank[i] = z180_CBR;
+        } else {
+            // Otherwise, it's common 0
+            pages[i] = &z180_mem[pc];
+            page_bank[i] = -1;
+        }
     }
-    // Otherwise, it's common 0
-    return &z180_mem[pc & 0xffff];
 }
 
 static void z180_handle_out(int port, int value)
@@ -131,13 +191,16 @@ static void z180_handle_out(int port, int value)
     case Z180_IO_CBAR:
         z180_CBAR = value;
         break;
+    default:
+        return;
     }
+    z180_map_pages();
 }
 
 static void z180_init(void) 
 {
     z180_mem = calloc(1024*1024, sizeof(char));
-    get_mem_addr = z180_get_memory_addr;
+    map_pages = z180_map_pages;
     handle_out = z180_handle_out;
 }
 
@@ -147,16 +210,18 @@ static void z180_init(void)
 static void standard_init(void) 
 {
     mem = calloc(65536, 1);
-    get_mem_addr = standard_get_memory_addr;
+    map_pages = standard_map_pages;
 }
 
 
-static uint8_t *standard_get_memory_addr(int pc)
+static void standard_map_pages(void)
 {
-  int segment = pc / 8192;
-  pc &= 0xffff;
+    int i;
 
-  return &mem[pc & 65535];
+    for ( i = 0; i < NUM_PAGES; i++ ) {
+        pages[i] = &mem[i * PAGE_SIZE];
+        page_bank[i] = -1;
+    }
 }
 
 
@@ -171,19 +236,26 @@ static void zxn_init(void)
 
 
     standard_init();
-    get_mem_addr = zxn_get_memory_addr;
+    map_pages = zxn_map_pages;
     handle_out = zxn_handle_out;
 }
 
-static uint8_t *zxn_get_memory_addr(int pc)
+static void zxn_map_pages(void)
 {
-  int segment = pc / 8192;
-  pc &= 0xffff;
+    int i;
 
-  if ( zxnext_mmu[segment] != 0xff ) {
-    return &zxn_banks[zxnext_mmu[segment]][pc % 8192];
-  }
-  return &mem[pc & 65535];
+    for ( i = 0; i < NUM_PAGES; i++ ) {
+        int pc = i * PAGE_SIZE;
+        int segment = pc / 8192;
+
+        if ( zxnext_mmu[segment] != 0xff ) {
+            pages[i] = &zxn_banks[zxnext_mmu[segment]][pc % 8192];
+            page_bank[i] = zxnext_mmu[segment];
+        } else {
+            pages[i] = &mem[pc];
+            page_bank[i] = -1;
+        }
+    }
 }
 
 
@@ -197,6 +269,7 @@ static void zxn_handle_out(int port, int value)
   }
   if ( nextport >= 0x50 && nextport <= 0x57 ) {
     zxnext_mmu[nextport - 0x50] = value;
+    zxn_map_pages();
   }
   nextport = 0;
   return;
@@ -232,7 +305,7 @@ static void zx_init(char *config)
         zx_rom[i] = calloc(16384,1);
     }
 
-    get_mem_addr = zx_get_memory_addr;
+    map_pages = zx_map_pages;
     handle_out = zx_handle_out;
 
     if ( *config == ',') {
@@ -249,18 +322,21 @@ static void zx_init(char *config)
     }
 }
 
-static uint8_t *zx_get_memory_addr(int pc)
+static void zx_map_pages(void)
 {
-    int segment = pc / 16384;
-    int bank = zx_pages[segment];
+    int i;
 
-    pc &= 0xffff;
+    for ( i = 0; i < NUM_PAGES; i++ ) {
+        int pc = i * PAGE_SIZE;
+        int bank = zx_pages[pc / 16384];
 
-    if ( bank >= 0x10 ) {
-        return &zx_rom[bank - 0x10][pc % 16384];
+        if ( bank >= 0x10 ) {
+            pages[i] = &zx_rom[bank - 0x10][pc % 16384];
+        } else {
+            pages[i] = &zx_banks[bank][pc % 16384];
+        }
+        page_bank[i] = bank;
     }
-
-    return &zx_banks[bank][pc % 16384];
 }
 
 
@@ -280,6 +356,7 @@ static void zx_handle_out(int port, int value)
       } else {
           zx_pages[0] = 0x11; // 48k ROM
       }
+      zx_map_pages();
   }
   return;
 }
@@ -302,4 +302,398 @@ void profiler_stop() {
                "------------------------------------------------------------\n", total_total_time);
 
     profiler_enabled = 0;
-}
\ No newline at end of file
+}
+
+/*
+ * Cycle profiler: attributes the cycles of every instruction to its
+ * (bank, pc) and to a calling context tree rebuilt from the execution
+ * itself, so it works on code built without frame instrumentation.
+ *
+ * A call (CALL, RST or an interrupt) is seen when SP went down by 2 and
+ * the pushed word is the address of the previous instruction or just
+ * after it, while execution continued elsewhere. A frame is left when
+ * execution reaches its return address with SP not below the frame, which
+ * also covers the callee functions that pop their return address and the
+ * library helpers that return with "ex (sp),hl; jp (hl)".
+ *
+ * Frames left some other way (longjmp, or popping the return address and
+ * jumping elsewhere) are dropped once their return address can no longer
+ * be on the stack: when SP rises above the frame under the innermost one,
+ * or a later call pushes its return address at or above theirs. The
+ * innermost frame alone may have SP above it while it's still running, as
+ * that's how the callee functions and helpers end.
+ */
+
+#define CYCLES_MAX_DEPTH    1024
+#define CYCLES_BANK_SLOTS   257         /* unbanked + banks 0..255 */
+#define CYCLES_HOT_ADDRS    10
+
+struct cycles_node_t {
+    uint32_t              key;          /* bank << 16 | entry address */
+    struct cycles_node_t *parent;
+    struct cycles_node_t *children;
+    uint64_t              self;
+    uint64_t              count;
+    uint64_t              calls;
+    UT_hash_handle        hh;
+};
+
+struct cycles_frame_t {
+    struct cycles_node_t *node;
+    uint16_t              ret;
+    uint16_t              sp;
+};
+
+struct cycles_counter_t {
+    uint64_t              cycles;
+    uint64_t              count;
+};
+
+struct cycles_summary_t {
+    char                  name[128];
+    uint64_t              self;
+    uint64_t              total;
+    uint64_t              calls;
+    uint64_t              count;
+    UT_hash_handle        hh;
+};
+
+int profiler_cycles_enabled = 0;
+static char* cycles_folded_file = NULL;
+static struct cycles_node_t* cycles_root = NULL;
+static struct cycles_frame_t cycles_stack[CYCLES_MAX_DEPTH];
+static int cycles_depth = 0;
+static struct cycles_counter_t* cycles_counters[CYCLES_BANK_SLOTS];
+static int cycles_last_valid = 0;
+static uint16_t cycles_last_pc;
+static uint16_t cycles_last_sp;
+static int cycles_last_bank;
+static long long cycles_last_st;
+static uint64_t cycles_total = 0;
+
+static int cycles_bank(uint16_t pc)
+{
+    int bank = bk.bank ? bk.bank(pc) : -1;
+
+    return (bank < -1 || bank >= CYCLES_BANK_SLOTS - 1) ? -1 : bank;
+}
+
+static struct cycles_node_t* cycles_new_node(uint32_t key, struct cycles_node_t* parent)
+{
+    struct cycles_node_t* n = calloc(1, sizeof(struct cycles_node_t));
+
+    n->key = key;
+    n->parent = parent;
+    if (parent) {
+        HASH_ADD(hh, parent->children, key, sizeof(uint32_t), n);
+    }
+    return n;
+}
+
+static void cycles_free_node(struct cycles_node_t* n)
+{
+    struct cycles_node_t *child, *tmp;
+
+    HASH_ITER(hh, n->children, child, tmp) {
+        HASH_DEL(n->children, child);
+        cycles_free_node(child);
+    }
+    free(n);
+}
+
+static uint32_t cycles_key(int bank, uint16_t addr)
+{
+    return ((uint32_t)(bank & 0xffff) << 16) | addr;
+}
+
+static struct cycles_node_t* cycles_current(void)
+{
+    return cycles_depth ? cycles_stack[cycles_depth - 1].node : cycles_root;
+}
+
+void profiler_cycles_start(const char* folded_file)
+{
+    static int atexit_done = 0;
+
+    if (profiler_cycles_enabled) {
+        bk.console("Warning: cycle profiler is already enabled.\n");
+        return;
+    }
+    cycles_folded_file = folded_file ? strdup(folded_file) : NULL;
+    cycles_root = NULL;
+    cycles_depth = 0;
+    cycles_last_valid = 0;
+    cycles_total = 0;
+    memset(cycles_counters, 0, sizeof(cycles_counters));
+    if (atexit_done == 0) {
+        // Programs usually finish through an exit() from a hook
+        atexit(profiler_cycles_stop);
+        atexit_done = 1;
+    }
+    profiler_cycles_enabled = 1;
+}
+
+void profiler_cycles_step(void)
+{
+    uint16_t pc = bk.pc();
+    uint16_t sp = bk.sp();
+    long long st = bk.st();
+    int bank = cycles_bank(pc);
+
+    if (cycles_root == NULL) {
+        // The program starts in the root context
+        cycles_root = cycles_new_node(cycles_key(bank, pc), NULL);
+    }
+    if (cycles_last_valid) {
+        struct cycles_counter_t** slot = &cycles_counters[cycles_last_bank + 1];
+        uint64_t delta = st > cycles_last_st ? st - cycles_last_st : 0;
+
+        if (*slot == NULL) {
+            *slot = calloc(65536, sizeof(struct cycles_counter_t));
+        }
+        (*slot)[cycles_last_pc].cycles += delta;
+        (*slot)[cycles_last_pc].count++;
+        cycles_current()->self += delta;
+        cycles_current()->count++;
+        cycles_total += delta;
+
+        while (sp > cycles_last_sp && cycles_depth >= 2 && sp > cycles_stack[cycles_depth - 2].sp) {
+            cycles_depth--;
+        }
+        if (sp == (uint16_t)(cycles_last_sp - 2)) {
+            uint16_t ret = bk.get_memory(sp) | (bk.get_memory(sp + 1) << 8);
+
+            if ((uint16_t)(ret - cycles_last_pc) <= 4 && pc != ret) {
+                while (cycles_depth && cycles_stack[cycles_depth - 1].sp <= sp) {
+                    cycles_depth--;
+                }
+            }
+            if ((uint16_t)(ret - cycles_last_pc) <= 4 && pc != ret && cycles_depth < CYCLES_MAX_DEPTH) {
+                struct cycles_node_t* parent = cycles_current();
+                struct cycles_node_t* n;
+                uint32_t key = cycles_key(bank, pc);
+
+                HASH_FIND(hh, parent->children, &key, sizeof(uint32_t), n);
+                if (n == NULL) {
+                    n = cycles_new_node(key, parent);
+                }
+                n->calls++;
+                cycles_stack[cycles_depth].node = n;
+                cycles_stack[cycles_depth].ret = ret;
+                cycles_stack[cycles_depth].sp = sp;
+                cycles_depth++;
+            }
+        }
+    }
+    while (cycles_depth && pc == cycles_stack[cycles_depth - 1].ret && sp >= cycles_stack[cycles_depth - 1].sp) {
+        cycles_depth--;
+    }
+    cycles_last_valid = 1;
+    cycles_last_pc = pc;
+    cycles_last_sp = sp;
+    cycles_last_bank = bank;
+    cycles_last_st = st;
+}
+
+// Name of the code at (bank, addr): the symbol it's in, with a bank suffix for banked code
+static void cycles_label(char* buf, size_t len, int bank, uint16_t addr, int with_offset)
+{
+    uint16_t offset = 0;
+    symbol* sym = symbol_find_lower(addr, SYM_ADDRESS, &offset);
+    char bank_text[8] = "";
+
+    if (bank != -1) {
+        snprintf(bank_text, sizeof(bank_text), "@%02x", bank);
+    }
+    if (sym == NULL) {
+        snprintf(buf, len, "$%04x%s", addr, bank_text);
+    } else if (offset && with_offset) {
+        snprintf(buf, len, "%s+%d%s", sym->name, offset, bank_text);
+    } else {
+        snprintf(buf, len, "%s%s", sym->name, bank_text);
+    }
+}
+
+static int cycles_node_bank(struct cycles_node_t* n)
+{
+    int bank = n->key >> 16;
+
+    return bank == 0xffff ? -1 : bank;
+}
+
+static void cycles_write_folded(FILE* fp, struct cycles_node_t* n, UT_string* path)
+{
+    struct cycles_node_t *child, *tmp;
+    size_t len = utstring_len(path);
+    char name[128];
+
+    cycles_label(name, sizeof(name), cycles_node_bank(n), n->key & 0xffff, 1);
+    utstring_printf(path, "%s%s", len ? ";" : "", name);
+    if (n->self) {
+        fprintf(fp, "%s %" PRIu64 "\n", utstring_body(path), n->self);
+    }
+    HASH_ITER(hh, n->children, child, tmp) {
+        cycles_write_folded(fp, child, path);
+    }
+    // Cut the path back for the next sibling
+    utstring_body(path)[len] = 0;
+    path->i = len;
+}
+
+static struct cycles_summary_t* cycles_summary_entry(struct cycles_summary_t** summary, const char* name)
+{
+    struct cycles_summary_t* s;
+
+    HASH_FIND_STR(*summary, name, s);
+    if (s == NULL) {
+        s = calloc(1, sizeof(struct cycles_summary_t));
+        snprintf(s->name, sizeof(s->name), "%s", name);
+        HASH_ADD_STR(*summary, name, s);
+    }
+    return s;
+}
+
+// Total time of a node, given to its function unless the function is already on the path (recursion)
+static uint64_t cycles_summarise_node(struct cycles_summary_t** summary, struct cycles_node_t* n)
+{
+    struct cycles_node_t *child, *tmp, *up;
+    struct cycles_summary_t* s;
+    uint64_t total = n->self;
+    char name[128];
+
+    HASH_ITER(hh, n->children, child, tmp) {
+        total += cycles_summarise_node(summary, child);
+    }
+    for (up = n->parent; up != NULL; up = up->parent) {
+        if (up->key == n->key) {
+            break;
+        }
+    }
+    cycles_label(name, sizeof(name), cycles_node_bank(n), n->key & 0xffff, 0);
+    s = cycles_summary_entry(summary, name);
+    s->self += n->self;
+    s->count += n->count;
+    s->calls += n->calls;
+    if (up == NULL) {
+        s->total += total;
+    }
+    return total;
+}
+
+static int cycles_sort_self(struct cycles_summary_t* a, struct cycles_summary_t* b)
+{
+    if (a->self < b->self) {
+        return 1;
+    }
+    if (a->self > b->self) {
+        return -1;
+    }
+    return 0;
+}
+
+void profiler_cycles_stop(void)
+{
+    struct cycles_summary_t *summary = NULL, *s, *tmp;
+    struct cycles_counter_t hot[CYCLES_HOT_ADDRS];
+    int hot_slot[CYCLES_HOT_ADDRS];
+    uint16_t hot_addr[CYCLES_HOT_ADDRS];
+    int hot_count = 0;
+    char name[128];
+    int slot, addr, i;
+
+    if (profiler_cycles_enabled == 0) {
+        return;
+    }
+    profiler_cycles_enabled = 0;
+    if (cycles_root == NULL) {
+        free(cycles_folded_file);
+        cycles_folded_file = NULL;
+        return;
+    }
+    // The last instruction hasn't been accounted yet, it has no successor
+    profiler_cycles_step();
+
+    if (cycles_folded_file) {
+        FILE* fp = fopen(cycles_folded_file, "w");
+
+        if (fp != NULL) {
+            UT_string* path;
+
+            utstring_new(path);
+            cycles_write_folded(fp, cycles_root, path);
+            utstring_free(path);
+            fclose(fp);
+        } else {
+            bk.console("Warning: cannot write the folded stacks to %s\n", cycles_folded_file);
+        }
+    }
+
+    cycles_summarise_node(&summary, cycles_root);
+    HASH_SORT(summary, cycles_sort_self);
+
+    bk.console("------------------------------------------------------------------------------\n");
+    bk.console("                   Cycle profile, sorted by Own Time:\n");
+    bk.console("------------------------------------------------------------------------------\n");
+    bk.console("     Calls        Time    Own Time   Share OwnShare  Instrs  Function\n");
+    bk.console("------------------------------------------------------------------------------\n");
+    HASH_ITER(hh, summary, s, tmp) {
+        if (s->self || s->total) {
+            bk.console("%10" PRIu64 " %11" PRIu64 " %11" PRIu64 " %6d%% %6d%% %9" PRIu64 "  %s\n",
+                       s->calls, s->total, s->self,
+                       cycles_total ? (int)(s->total * 100 / cycles_total) : 0,
+                       cycles_total ? (int)(s->self * 100 / cycles_total) : 0,
+                       s->count, s->name);
+        }
+        HASH_DEL(summary, s);
+        free(s);
+    }
+    bk.console("------------------------------------------------------------------------------\n"
+               "Total time: %" PRIu64 "\n"
+               "------------------------------------------------------------------------------\n", cycles_total);
+
+    // The instructions that took the most time, from the (bank, pc) counters
+    for (slot = 0; slot < CYCLES_BANK_SLOTS; slot++) {
+        if (cycles_counters[slot] == NULL) {
+            continue;
+        }
+        for (addr = 0; addr < 65536; addr++) {
+            uint64_t cycles = cycles_counters[slot][addr].cycles;
+
+            if (cycles == 0) {
+                continue;
+            }
+            for (i = hot_count; i > 0 && hot[i - 1].cycles < cycles; i--) {
+                if (i < CYCLES_HOT_ADDRS) {
+                    hot[i] = hot[i - 1];
+                    hot_slot[i] = hot_slot[i - 1];
+                    hot_addr[i] = hot_addr[i - 1];
+                }
+            }
+            if (i < CYCLES_HOT_ADDRS) {
+                hot[i] = cycles_counters[slot][addr];
+                hot_slot[i] = slot;
+                hot_addr[i] = addr;
+                if (hot_count < CYCLES_HOT_ADDRS) {
+                    hot_count++;
+                }
+            }
+        }
+        free(cycles_counters[slot]);
+        cycles_counters[slot] = NULL;
+    }
+    bk.console("     Count        Time   Share  Address\n");
+    bk.console("------------------------------------------------------------------------------\n");
+    for (i = 0; i < hot_count; i++) {
+        cycles_label(name, sizeof(name), hot_slot[i] - 1, hot_addr[i], 1);
+        bk.console("%10" PRIu64 " %11" PRIu64 " %6d%%  $%04x %s\n",
+                   hot[i].count, hot[i].cycles,
+                   cycles_total ? (int)(hot[i].cycles * 100 / cycles_total) : 0,
+                   hot_addr[i], name);
+    }
+    bk.console("------------------------------------------------------------------------------\n");
+
+    cycles_free_node(cycles_root);
+    cycles_root = NULL;
+    free(cycles_folded_file);
+    cycles_folded_file = NULL;
+}
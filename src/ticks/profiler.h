@@ -8,4 +8,9 @@ extern void profiler_start(const char* function, int iterations_limit);
 extern uint8_t profiler_check(uint16_t pc);
 extern void profiler_stop();
 
+extern int profiler_cycles_enabled;
+extern void profiler_cycles_start(const char* folded_file);
+extern void profiler_cycles_step(void);
+extern void profiler_cycles_stop(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Binary execution trace
+ *
+ * Instead of formatting the registers and disassembly of every instruction
+ * like -trace, each step only records what changed since the last one, so
+ * a whole program run can be traced and looked at later with -replay.
+ */
+
+#include "recorder.h"
+#include "backend.h"
+#include "debug.h"
+#include "cpu.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#define RECORD_BUFFER_SIZE  65536
+#define RECORD_STEP_MAX     64          /* longest step record */
+
+int recorder_enabled = 0;
+
+static FILE       *record_fp;
+static char       *record_filename;
+static uint8_t     record_buffer[RECORD_BUFFER_SIZE];
+static size_t      record_buffered;
+
+// What the reader knows at this point, to only write the differences
+static int         record_started;
+static long long   record_last_st;
+static int         record_last_bank;
+static uint16_t    record_last_pairs[RECORD_NUM_PAIRS];
+static uint8_t     record_memory[65536];
+
+
+FILE *recorder_open(const char *filename, int for_writing)
+{
+    size_t len = strlen(filename);
+    char   cmd[FILENAME_MAX + 32];
+
+    if ( len > 3 && strcmp(filename + len - 3, ".gz") == 0 ) {
+        if ( for_writing ) {
+            snprintf(cmd, sizeof(cmd), "gzip -c > \"%s\"", filename);
+        } else {
+            snprintf(cmd, sizeof(cmd), "gzip -dc \"%s\"", filename);
+        }
+#ifdef _WIN32
+        return popen(cmd, for_writing ? "wb" : "rb");
+#else
+        return popen(cmd, for_writing ? "w" : "r");
+#endif
+    }
+    return fopen(filename, for_writing ? "wb" : "rb");
+}
+
+void recorder_close(FILE *fp, const char *filename)
+{
+    size_t len = strlen(filename);
+
+    if ( len > 3 && strcmp(filename + len - 3, ".gz") == 0 ) {
+        pclose(fp);
+    } else {
+        fclose(fp);
+    }
+}
+
+static void record_flush(void)
+{
+    if ( record_buffered && fwrite(record_buffer, 1, record_buffered, record_fp) != record_buffered ) {
+        bk.console("Warning: cannot write the trace to %s\n", record_filename);
+    }
+    record_buffered = 0;
+}
+
+static void record_byte(uint8_t value)
+{
+    record_buffer[record_buffered++] = value;
+}
+
+static void record_word(uint16_t value)
+{
+    record_buffer[record_buffered++] = value & 0xff;
+    record_buffer[record_buffered++] = value >> 8;
+}
+
+static void record_cycles(unsigned long long value)
+{
+    do {
+        uint8_t b = value & 0x7f;
+
+        value >>= 7;
+        record_buffer[record_buffered++] = value ? b | 0x80 : b;
+    } while ( value );
+}
+
+void recorder_start(const char *filename)
+{
+    static int atexit_done = 0;
+
+    if ( recorder_enabled ) {
+        bk.console("Warning: the trace is already being recorded.\n");
+        return;
+    }
+    record_fp = recorder_open(filename, 1);
+    if ( record_fp == NULL ) {
+        bk.console("Warning: cannot create trace file %s\n", filename);
+        return;
+    }
+    record_filename = strdup(filename);
+    fwrite(RECORD_MAGIC, 1, strlen(RECORD_MAGIC), record_fp);
+    record_buffered = 0;
+    record_byte(RECORD_VERSION);
+    record_word(c_cpu);
+    record_started = 0;
+    record_last_bank = -1;
+    memset(record_last_pairs, 0, sizeof(record_last_pairs));
+    if ( atexit_done == 0 ) {
+        // Programs usually finish through an exit() from a hook
+        atexit(recorder_stop);
+        atexit_done = 1;
+    }
+    recorder_enabled = 1;
+}
+
+void recorder_write(uint16_t addr, uint8_t value)
+{
+    if ( record_buffered > RECORD_BUFFER_SIZE - 4 ) {
+        record_flush();
+    }
+    record_byte(RECORD_WRITE);
+    record_word(addr);
+    record_byte(value);
+    record_memory[addr] = value;
+}
+
+void recorder_step(void)
+{
+    struct debugger_regs_t regs;
+    uint16_t               pairs[RECORD_NUM_PAIRS];
+    uint16_t               changed = 0;
+    uint16_t               pc = bk.pc();
+    int                    bank = bk.bank ? bk.bank(pc) : -1;
+    long long              st = bk.st();
+    uint8_t                tag = 0;
+    int                    i;
+
+    if ( record_started == 0 ) {
+        // Start from the memory as it is now
+        for ( i = 0; i < 65536; i++ ) {
+            record_memory[i] = bk.get_memory(i);
+        }
+        record_flush();
+        fputc(RECORD_MEMORY, record_fp);
+        fwrite(record_memory, 1, sizeof(record_memory), record_fp);
+        record_last_st = st;
+        record_started = 1;
+    }
+    if ( record_buffered > RECORD_BUFFER_SIZE - RECORD_STEP_MAX ) {
+        record_flush();
+    }
+
+    bk.get_regs(&regs);
+    pairs[RECORD_AF] = bk.f() | regs.a << 8;
+    pairs[RECORD_BC] = regs.c | regs.b << 8;
+    pairs[RECORD_DE] = regs.e | regs.d << 8;
+    pairs[RECORD_HL] = regs.l | regs.h << 8;
+    pairs[RECORD_AF_] = bk.f_() | regs.a_ << 8;
+    pairs[RECORD_BC_] = regs.c_ | regs.b_ << 8;
+    pairs[RECORD_DE_] = regs.e_ | regs.d_ << 8;
+    pairs[RECORD_HL_] = regs.l_ | regs.h_ << 8;
+    pairs[RECORD_IX] = regs.xl | regs.xh << 8;
+    pairs[RECORD_IY] = regs.yl | regs.yh << 8;
+    pairs[RECORD_SP] = bk.sp();
+    for ( i = 0; i < RECORD_NUM_PAIRS; i++ ) {
+        if ( pairs[i] != record_last_pairs[i] ) {
+            changed |= 1 << i;
+        }
+    }
+    if ( changed ) {
+        tag |= RECORD_STEP_REGS;
+    }
+    if ( bank != record_last_bank ) {
+        tag |= RECORD_STEP_BANK;
+    }
+    // Code the reader doesn't know about: paged in or loaded by a hook
+    for ( i = 0; i < RECORD_OPCODE_BYTES; i++ ) {
+        uint16_t at = pc + i;
+        uint8_t  b = bk.get_memory(at);
+
+        if ( record_memory[at] != b ) {
+            tag |= RECORD_STEP_OPCODES;
+        }
+    }
+
+    record_byte(tag);
+    record_cycles(st - record_last_st);
+    record_word(pc);
+    if ( tag & RECORD_STEP_BANK ) {
+        record_word(bank);
+        record_last_bank = bank;
+    }
+    if ( tag & RECORD_STEP_REGS ) {
+        record_word(changed);
+        for ( i = 0; i < RECORD_NUM_PAIRS; i++ ) {
+            if ( changed & (1 << i) ) {
+                record_word(pairs[i]);
+                record_last_pairs[i] = pairs[i];
+            }
+        }
+    }
+    if ( tag & RECORD_STEP_OPCODES ) {
+        for ( i = 0; i < RECORD_OPCODE_BYTES; i++ ) {
+            uint16_t at = pc + i;
+
+            record_memory[at] = bk.get_memory(at);
+            record_byte(record_memory[at]);
+        }
+    }
+    record_last_st = st;
+}
+
+void recorder_stop(void)
+{
+    if ( recorder_enabled == 0 ) {
+        return;
+    }
+    recorder_enabled = 0;
+    if ( record_buffered > RECORD_BUFFER_SIZE - 16 ) {
+        record_flush();
+    }
+    record_byte(RECORD_END);
+    record_cycles(record_started ? bk.st() - record_last_st : 0);
+    record_flush();
+    recorder_close(record_fp, record_filename);
+    record_fp = NULL;
+    free(record_filename);
+    record_filename = NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Binary execution trace, written by -record and read by -replay
+ *
+ * The file starts with RECORD_MAGIC, a version byte and the cpu as a 16 bit
+ * value, followed by records that start with a tag byte. Words are little
+ * endian, cycle counts are unsigned LEB128.
+ *
+ * RECORD_MEMORY  the 64k address space as it was when recording started
+ * RECORD_WRITE   address, value: a byte written by the last instruction
+ * step (tag < RECORD_WRITE)
+ *                cycles of the previous instruction, pc, then depending on
+ *                the tag bits: the bank at pc, a mask of the register pairs
+ *                that changed since the last step and their values, the
+ *                opcode bytes at pc. Registers are the ones before the
+ *                instruction runs. Opcode bytes are only recorded when they
+ *                differ from what the memory seen so far says.
+ * RECORD_END     cycles of the last instruction
+ */
+
+#define RECORD_MAGIC            "Z88DKREC"
+#define RECORD_VERSION          1
+
+#define RECORD_STEP_BANK        0x01
+#define RECORD_STEP_REGS        0x02
+#define RECORD_STEP_OPCODES     0x04
+#define RECORD_WRITE            0x40
+#define RECORD_MEMORY           0x41
+#define RECORD_END              0xff
+
+#define RECORD_OPCODE_BYTES     6
+
+enum record_pair {
+    RECORD_AF = 0,
+    RECORD_BC,
+    RECORD_DE,
+    RECORD_HL,
+    RECORD_AF_,
+    RECORD_BC_,
+    RECORD_DE_,
+    RECORD_HL_,
+    RECORD_IX,
+    RECORD_IY,
+    RECORD_SP,
+    RECORD_NUM_PAIRS
+};
+
+extern int recorder_enabled;
+extern void recorder_start(const char *filename);
+extern void recorder_step(void);
+extern void recorder_write(uint16_t addr, uint8_t value);
+extern void recorder_stop(void);
+
+/* Opens a trace for reading or writing, files ending in .gz go through gzip */
+extern FILE *recorder_open(const char *filename, int for_writing);
+extern void recorder_close(FILE *fp, const char *filename);
+
+#endif
@@ -0,0 +1,520 @@
+/*
+ * Offline analysis of a trace written by -record
+ *
+ * The trace is read through a backend that answers with the registers and
+ * memory of the step being replayed, so the listing is printed by the same
+ * code as -trace and symbols are looked up as when running.
+ */
+
+#include "ticks.h"
+#include "replay.h"
+#include "recorder.h"
+#include "backend.h"
+#include "debug.h"
+#include "debugger.h"
+#include "disassembler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_BANK_SLOTS   257         /* unbanked + banks 0..255 */
+
+/* A straight run of instructions, ended by a jump, call or return */
+typedef struct {
+    uint64_t        key;                /* bank << 32 | start << 16 | last instruction */
+    long long       cycles;
+    long long       count;
+    UT_hash_handle  hh;
+} replay_block;
+
+static FILE        *replay_fp;
+static const char  *replay_filename;
+
+// State before the instruction being replayed
+static uint16_t     replay_pc;
+static int          replay_bank = -1;
+static long long    replay_st;
+static uint16_t     replay_pairs[RECORD_NUM_PAIRS];
+static uint8_t      replay_memory[65536];
+static uint8_t      replay_length[65536];      /* of the instruction at an address, 0 if not known */
+
+// Analysis
+static long long    replay_from = 0;
+static long long    replay_to = -1;
+static uint8_t     *replay_covered[REPLAY_BANK_SLOTS];     /* 1: first byte of an instruction, 2: other bytes */
+static replay_block *replay_blocks = NULL;
+
+
+static void replay_die(const char *fmt, const char *arg)
+{
+    fprintf(stderr, fmt, arg);
+    exit(1);
+}
+
+static uint16_t replay_get_pc()
+{
+    return replay_pc;
+}
+
+static uint16_t replay_get_sp()
+{
+    return replay_pairs[RECORD_SP];
+}
+
+static long long replay_get_st()
+{
+    return replay_st;
+}
+
+static uint8_t replay_get_memory(uint16_t at)
+{
+    return replay_memory[at];
+}
+
+// Only the bank of the code being run is known
+static int replay_get_bank(uint16_t at)
+{
+    return (at >> 12) == (replay_pc >> 12) ? replay_bank : -1;
+}
+
+static int replay_f()
+{
+    return replay_pairs[RECORD_AF] & 0xff;
+}
+
+static int replay_f_()
+{
+    return replay_pairs[RECORD_AF_] & 0xff;
+}
+
+static void replay_get_regs(struct debugger_regs_t *regs)
+{
+    memset(regs, 0, sizeof(*regs));
+    regs->pc = replay_pc;
+    regs->sp = replay_pairs[RECORD_SP];
+    unwrap_reg(replay_pairs[RECORD_AF], &regs->a, &regs->f);
+    unwrap_reg(replay_pairs[RECORD_BC], &regs->b, &regs->c);
+    unwrap_reg(replay_pairs[RECORD_DE], &regs->d, &regs->e);
+    unwrap_reg(replay_pairs[RECORD_HL], &regs->h, &regs->l);
+    unwrap_reg(replay_pairs[RECORD_AF_], &regs->a_, &regs->f_);
+    unwrap_reg(replay_pairs[RECORD_BC_], &regs->b_, &regs->c_);
+    unwrap_reg(replay_pairs[RECORD_DE_], &regs->d_, &regs->e_);
+    unwrap_reg(replay_pairs[RECORD_HL_], &regs->h_, &regs->l_);
+    unwrap_reg(replay_pairs[RECORD_IX], &regs->xh, &regs->xl);
+    unwrap_reg(replay_pairs[RECORD_IY], &regs->yh, &regs->yl);
+}
+
+static void replay_invalidate()
+{
+}
+
+static uint8_t replay_is_verbose()
+{
+    return 0;
+}
+
+static backend_t replay_backend = {
+    .st = &replay_get_st,
+    .pc = &replay_get_pc,
+    .sp = &replay_get_sp,
+    .get_memory = &replay_get_memory,
+    .bank = &replay_get_bank,
+    .get_regs = &replay_get_regs,
+    .f = &replay_f,
+    .f_ = &replay_f_,
+    .invalidate = &replay_invalidate,
+    .breakable = 0,
+    .is_verbose = &replay_is_verbose,
+    .console = stdout_log,
+    .debug = stdout_log,
+};
+
+static int replay_byte(void)
+{
+    int c = getc(replay_fp);
+
+    if ( c == EOF ) {
+        replay_die("Truncated trace %s\n", replay_filename);
+    }
+    return c;
+}
+
+static uint16_t replay_word(void)
+{
+    uint16_t value = replay_byte();
+
+    return value | replay_byte() << 8;
+}
+
+static long long replay_cycles(void)
+{
+    unsigned long long value = 0;
+    int                shift = 0;
+    int                b;
+
+    do {
+        b = replay_byte();
+        value |= (unsigned long long)(b & 0x7f) << shift;
+        shift += 7;
+    } while ( b & 0x80 );
+    return (long long)value;
+}
+
+// Address with the bank in the upper bits, as banked symbols have it
+static long long replay_address(int bank, uint16_t addr)
+{
+    return bank > 0 ? (long long)bank << 16 | addr : addr;
+}
+
+static int replay_in_range(int bank, uint16_t addr)
+{
+    long long at = replay_from > 0xffff || replay_to > 0xffff ? replay_address(bank, addr) : addr;
+
+    return at >= replay_from && (replay_to < 0 || at < replay_to);
+}
+
+static void replay_label(char *buf, size_t len, int bank, uint16_t addr)
+{
+    uint16_t  offset = 0;
+    symbol   *sym = symbol_find_lower_banked(bank, addr, SYM_ADDRESS, &offset);
+
+    if ( sym == NULL ) {
+        snprintf(buf, len, "$%04x", addr);
+    } else if ( offset ) {
+        snprintf(buf, len, "%s+%d", sym->name, offset);
+    } else {
+        snprintf(buf, len, "%s", sym->name);
+    }
+}
+
+// Instructions are disassembled again when their bytes might have changed
+static void replay_forget_lengths(uint16_t addr, int len)
+{
+    int i;
+
+    for ( i = 1 - RECORD_OPCODE_BYTES; i < len; i++ ) {
+        replay_length[(uint16_t)(addr + i)] = 0;
+    }
+}
+
+static int replay_instruction_length(uint16_t pc)
+{
+    char buf[2048];
+
+    if ( replay_length[pc] == 0 ) {
+        replay_length[pc] = disassemble2(pc, buf, sizeof(buf), 2);
+    }
+    return replay_length[pc];
+}
+
+static void replay_cover(int bank, uint16_t pc, int len)
+{
+    uint8_t **slot = &replay_covered[bank + 1];
+    int       i;
+
+    if ( *slot == NULL ) {
+        *slot = calloc(65536, 1);
+    }
+    for ( i = 0; i < len; i++ ) {
+        uint8_t *at = &(*slot)[(uint16_t)(pc + i)];
+
+        if ( *at == 0 ) {
+            *at = i ? 2 : 1;
+        }
+    }
+}
+
+static void replay_add_block(int bank, uint16_t start, uint16_t last, long long cycles)
+{
+    uint64_t      key = (uint64_t)(bank & 0xffff) << 32 | (uint64_t)start << 16 | last;
+    replay_block *block;
+
+    HASH_FIND(hh, replay_blocks, &key, sizeof(key), block);
+    if ( block == NULL ) {
+        block = calloc(1, sizeof(*block));
+        block->key = key;
+        HASH_ADD(hh, replay_blocks, key, sizeof(key), block);
+    }
+    block->cycles += cycles;
+    block->count++;
+}
+
+static int replay_block_compare(const void *a, const void *b)
+{
+    const replay_block *b1 = *(const replay_block **)a;
+    const replay_block *b2 = *(const replay_block **)b;
+
+    if ( b1->cycles != b2->cycles ) {
+        return b1->cycles > b2->cycles ? -1 : 1;
+    }
+    return b1->key < b2->key ? -1 : b1->key > b2->key;
+}
+
+static void replay_print_coverage(void)
+{
+    int slot;
+    int total_bytes = 0, total_instrs = 0;
+
+    printf("------------------------------------------------------------------------------\n");
+    printf("                   Code coverage\n");
+    printf("------------------------------------------------------------------------------\n");
+    printf("  Address  Symbol                            Bytes    Size  Cover   Instrs\n");
+    printf("------------------------------------------------------------------------------\n");
+    for ( slot = 0; slot < REPLAY_BANK_SLOTS; slot++ ) {
+        uint8_t *covered = replay_covered[slot];
+        int      bank = slot - 1;
+        int      addr = 0;
+
+        while ( covered != NULL && addr < 65536 ) {
+            symbol   *sym, *next;
+            uint16_t  offset = 0;
+            char      name[64];
+            char      cover[8] = "-";
+            char      size_text[12] = "-";
+            int       start = addr, bytes = 0, instrs = 0, size = 0;
+
+            if ( covered[addr] == 0 ) {
+                addr++;
+                continue;
+            }
+            // All the covered bytes of the symbol
+            sym = symbol_find_lower_banked(bank, addr, SYM_ADDRESS, &offset);
+            do {
+                bytes += covered[addr] != 0;
+                instrs += covered[addr] == 1;
+                addr++;
+            } while ( addr < 65536 &&
+                      (covered[addr] == 0 || symbol_find_lower_banked(bank, addr, SYM_ADDRESS, &offset) == sym) );
+
+            if ( sym != NULL ) {
+                snprintf(name, sizeof(name), "%s", sym->name);
+                next = symbol_find_higher(sym->address, SYM_ADDRESS);
+                if ( next != NULL && next->address > sym->address ) {
+                    size = next->address - sym->address;
+                    snprintf(size_text, sizeof(size_text), "%d", size);
+                    snprintf(cover, sizeof(cover), "%d%%", bytes * 100 / size);
+                }
+                start = sym->address & 0xffff;
+            } else {
+                snprintf(name, sizeof(name), "(no symbol)");
+            }
+            if ( bank != -1 ) {
+                snprintf(name + strlen(name), sizeof(name) - strlen(name), "@%02x", bank);
+            }
+            printf("  $%04x    %-32s %6d  %6s  %5s  %7d\n", start, name, bytes, size_text, cover, instrs);
+            total_bytes += bytes;
+            total_instrs += instrs;
+        }
+    }
+    printf("------------------------------------------------------------------------------\n");
+    printf("  Total                                      %6d                 %7d\n", total_bytes, total_instrs);
+}
+
+static void replay_print_hot(int count, long long total_cycles)
+{
+    replay_block  *block, *tmp;
+    replay_block **sorted;
+    int            num = HASH_COUNT(replay_blocks), i = 0;
+
+    sorted = calloc(num + 1, sizeof(*sorted));
+    HASH_ITER(hh, replay_blocks, block, tmp) {
+        sorted[i++] = block;
+    }
+    qsort(sorted, num, sizeof(*sorted), replay_block_compare);
+
+    printf("------------------------------------------------------------------------------\n");
+    printf("                   Hottest straight runs of code, sorted by cycles\n");
+    printf("------------------------------------------------------------------------------\n");
+    printf("       Cycles   Share        Count  Run          From\n");
+    printf("------------------------------------------------------------------------------\n");
+    for ( i = 0; i < num && i < count; i++ ) {
+        int      bank = (int16_t)(sorted[i]->key >> 32);
+        uint16_t start = (sorted[i]->key >> 16) & 0xffff;
+        uint16_t last = sorted[i]->key & 0xffff;
+        char     label[128];
+
+        replay_label(label, sizeof(label), bank, start);
+        if ( bank != -1 ) {
+            snprintf(label + strlen(label), sizeof(label) - strlen(label), "@%02x", bank);
+        }
+        printf(" %12lld  %5.1f%% %12lld  $%04x-$%04x  %s\n", sorted[i]->cycles,
+               total_cycles ? 100.0 * sorted[i]->cycles / total_cycles : 0.0,
+               sorted[i]->count, start, last, label);
+    }
+    free(sorted);
+}
+
+int replay_main(int argc, char **argv)
+{
+    const char *function = NULL;
+    char       *from = NULL, *to = NULL;
+    int         list = 0, coverage = 0, hot = 0;
+    char        magic[sizeof(RECORD_MAGIC) - 1];
+    long long   instructions = 0, total_cycles = 0;
+    int         tag, i;
+
+    // The previous instruction, it ends with the next step
+    int         last_valid = 0, last_bank = -1, last_len = 0;
+    uint16_t    last_pc = 0;
+
+    // The run of instructions it belongs to
+    int         run_bank = -1;
+    uint16_t    run_start = 0;
+    long long   run_cycles = 0;
+
+    set_backend(replay_backend);
+    for ( i = 1; i < argc; i++ ) {
+        if ( strcmp(argv[i], "-replay") == 0 && i + 1 < argc ) {
+            replay_filename = argv[++i];
+        } else if ( strcmp(argv[i], "-x") == 0 && i + 1 < argc ) {
+            read_symbol_file(argv[++i]);
+        } else if ( strcmp(argv[i], "-from") == 0 && i + 1 < argc ) {
+            from = argv[++i];
+        } else if ( strcmp(argv[i], "-to") == 0 && i + 1 < argc ) {
+            to = argv[++i];
+        } else if ( strcmp(argv[i], "-function") == 0 && i + 1 < argc ) {
+            function = argv[++i];
+        } else if ( strcmp(argv[i], "-hot") == 0 && i + 1 < argc ) {
+            hot = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "-list") == 0 ) {
+            list = 1;
+        } else if ( strcmp(argv[i], "-coverage") == 0 ) {
+            coverage = 1;
+        } else {
+            replay_die("Wrong Argument for -replay: %s\n", argv[i]);
+        }
+    }
+    if ( replay_filename == NULL ) {
+        replay_die("Trace missing for -replay%s\n", "");
+    }
+    if ( list == 0 && coverage == 0 && hot == 0 ) {
+        list = 1;
+    }
+
+    // Symbols are resolved once they have all been read
+    if ( from != NULL && (replay_from = parse_address(from, NULL)) < 0 ) {
+        replay_die("Unknown address %s\n", from);
+    }
+    if ( to != NULL && (replay_to = parse_address(to, NULL)) < 0 ) {
+        replay_die("Unknown address %s\n", to);
+    }
+    if ( function != NULL ) {
+        uint16_t  offset;
+        int       addr = parse_address((char *)function, NULL);
+        symbol   *sym = addr < 0 ? NULL : symbol_find_lower(addr, SYM_ADDRESS, &offset);
+        symbol   *next;
+
+        if ( sym == NULL ) {
+            replay_die("Unknown function %s\n", function);
+        }
+        next = symbol_find_higher(sym->address, SYM_ADDRESS);
+        replay_from = sym->address;
+        replay_to = next != NULL ? next->address : -1;
+    }
+
+    replay_fp = recorder_open(replay_filename, 0);
+    if ( replay_fp == NULL ) {
+        replay_die("Cannot open trace %s\n", replay_filename);
+    }
+    if ( fread(magic, 1, sizeof(magic), replay_fp) != sizeof(magic) ||
+         memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0 ) {
+        replay_die("%s is not a trace written by -record\n", replay_filename);
+    }
+    if ( replay_byte() != RECORD_VERSION ) {
+        replay_die("Unsupported version of trace %s\n", replay_filename);
+    }
+    c_cpu = replay_word();
+
+    while ( (tag = replay_byte()) != RECORD_END ) {
+        long long cycles;
+        int       in_range;
+
+        if ( tag == RECORD_WRITE ) {
+            uint16_t addr = replay_word();
+
+            replay_memory[addr] = replay_byte();
+            replay_forget_lengths(addr, 1);
+            continue;
+        } else if ( tag == RECORD_MEMORY ) {
+            if ( fread(replay_memory, 1, sizeof(replay_memory), replay_fp) != sizeof(replay_memory) ) {
+                replay_die("Truncated trace %s\n", replay_filename);
+            }
+            memset(replay_length, 0, sizeof(replay_length));
+            continue;
+        } else if ( tag >= RECORD_WRITE ) {
+            replay_die("Corrupted trace %s\n", replay_filename);
+        }
+
+        // The next instruction starts, the previous one is complete
+        cycles = replay_cycles();
+        replay_pc = replay_word();
+        if ( tag & RECORD_STEP_BANK ) {
+            replay_bank = (int16_t)replay_word();
+        }
+        if ( tag & RECORD_STEP_REGS ) {
+            uint16_t changed = replay_word();
+
+            for ( i = 0; i < RECORD_NUM_PAIRS; i++ ) {
+                if ( changed & (1 << i) ) {
+                    replay_pairs[i] = replay_word();
+                }
+            }
+        }
+        if ( tag & RECORD_STEP_OPCODES ) {
+            for ( i = 0; i < RECORD_OPCODE_BYTES; i++ ) {
+                replay_memory[(uint16_t)(replay_pc + i)] = replay_byte();
+            }
+            replay_forget_lengths(replay_pc, RECORD_OPCODE_BYTES);
+        }
+
+        if ( last_valid ) {
+            total_cycles += cycles;
+            run_cycles += cycles;
+            if ( replay_pc != (uint16_t)(last_pc + last_len) || replay_bank != last_bank ) {
+                if ( hot && replay_in_range(run_bank, run_start) ) {
+                    replay_add_block(run_bank, run_start, last_pc, run_cycles);
+                }
+                run_cycles = 0;
+                last_valid = 0;
+            }
+        }
+        replay_st += cycles;
+
+        in_range = replay_in_range(replay_bank, replay_pc);
+        if ( list && in_range ) {
+            debugger_print_trace();
+        }
+        if ( last_valid == 0 ) {
+            run_bank = replay_bank;
+            run_start = replay_pc;
+        }
+        last_pc = replay_pc;
+        last_bank = replay_bank;
+        last_len = replay_instruction_length(replay_pc);
+        last_valid = 1;
+        if ( coverage && in_range ) {
+            replay_cover(replay_bank, replay_pc, last_len);
+        }
+        instructions++;
+    }
+    if ( last_valid ) {
+        long long cycles = replay_cycles();
+
+        total_cycles += cycles;
+        if ( hot && replay_in_range(run_bank, run_start) ) {
+            replay_add_block(run_bank, run_start, last_pc, run_cycles + cycles);
+        }
+    }
+    recorder_close(replay_fp, replay_filename);
+
+    if ( coverage ) {
+        replay_print_coverage();
+    }
+    if ( hot ) {
+        replay_print_hot(hot, total_cycles);
+    }
+    if ( coverage || hot ) {
+        printf("%lld instructions, %lld cycles\n", instructions, total_cycles);
+    }
+    return 0;
+}
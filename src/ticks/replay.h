@@ -0,0 +1,14 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/*
+ * z88dk-ticks -replay <trace> [-x <file>] [-from X] [-to X] [-function <symbol>]
+ *             [-list] [-coverage] [-hot N]
+ *
+ * Reads a trace written by -record: lists the instructions like -trace,
+ * reports the code executed in each symbol and the straight runs of code
+ * that took the most cycles. Returns the exit code of z88dk-ticks.
+ */
+extern int replay_main(int argc, char **argv);
+
+#endif
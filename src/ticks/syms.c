@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <utstring.h>
 #include "ticks.h"
+#include "backend.h"
 #include "debug.h"
 
 static symbol*          symbols[SYM_TAB_SIZE] = {0};
@@ -23,6 +24,26 @@ struct section_s {
 static section *sections_byname = NULL;
 static section *sections;
 
+// Address ordered index of the symbols that symbol_find_lower() can return
+// for a preferred type: only the first match at each address is kept, in
+// the order of the hash chains. Built on the first lookup after symbols
+// were added.
+typedef struct {
+    unsigned int   address;
+    int            order;
+    symbol        *sym;
+} symbol_index_entry;
+
+typedef struct {
+    symbol_index_entry *entries;
+    int                 count;
+    int                 valid;
+} symbol_index;
+
+static symbol_index     lower_index[SYM_ADDRESS + 1];
+
+static void symbol_index_invalidate(void);
+
 
 static char *duplen(const char *str, size_t len)
 {
@@ -156,6 +177,7 @@ void read_symbol_file(char *filename)
 
                     if (sym->symtype == SYM_ADDRESS) {
                         LL_APPEND(symbols[sym->address % SYM_TAB_SIZE], sym);
+                        symbol_index_invalidate();
                     }
 
                     symbol *oldsym = NULL;
@@ -208,6 +230,7 @@ void read_symbol_file(char *filename)
                 }
 
                 LL_APPEND(symbols[sym->address % SYM_TAB_SIZE], sym);
+                symbol_index_invalidate();
 
                 symbol *oldsym = NULL;
                 HASH_FIND_STR(global_symbols, sym->name, oldsym);
@@ -292,40 +315,141 @@ int symbol_resolve(char *name, const char *filename)
 }
 
 
-// Find a symbol lower than where we were
-symbol* symbol_find_lower(int addr, symboltype preferred_type, uint16_t* offset)
+static void symbol_index_invalidate(void)
 {
-    symbol *sym;
-    int     original_address = addr;
+    int i;
 
-    while ( 1 ) {
-        if ( addr < 0 ) {
-            return NULL;
-        }
-    
-        while ( (sym = symbols[addr % SYM_TAB_SIZE]) == NULL && addr > 0 ) {
-            addr--;
-        }
+    for ( i = 0; i <= SYM_ADDRESS; i++ ) {
+        lower_index[i].valid = 0;
+    }
+}
 
-        while ( sym != NULL ) {
-            if ( preferred_type == SYM_ANY ) {
-                break;
+static int symbol_matches(symbol *sym, symboltype preferred_type)
+{
+    if ( preferred_type == SYM_ANY ) {
+        return 1;
+    }
+    // Skip over internal labels
+    return preferred_type == sym->symtype && strncmp(sym->name,"i_",2);
+}
+
+static int symbol_index_compare(const void *a, const void *b)
+{
+    const symbol_index_entry *e1 = a;
+    const symbol_index_entry *e2 = b;
+
+    if ( e1->address != e2->address ) {
+        return e1->address < e2->address ? -1 : 1;
+    }
+    return e1->order - e2->order;
+}
+
+static symbol_index *symbol_index_get(symboltype preferred_type)
+{
+    symbol_index *idx = &lower_index[preferred_type];
+    symbol       *sym;
+    int           size = 0, count = 0, i;
+
+    if ( idx->valid ) {
+        return idx;
+    }
+    free(idx->entries);
+    idx->entries = NULL;
+    for ( i = 0; i < SYM_TAB_SIZE; i++ ) {
+        for ( sym = symbols[i]; sym != NULL; sym = sym->next ) {
+            if ( !symbol_matches(sym, preferred_type) ) {
+                continue;
             }
-            // Skip over internal labels?
-            if ( preferred_type == sym->symtype && strncmp(sym->name,"i_",2)) {
-                break;
+            if ( count == size ) {
+                size = size ? size * 2 : 1024;
+                idx->entries = realloc(idx->entries, size * sizeof(symbol_index_entry));
             }
-            sym = sym->next;
+            idx->entries[count].address = sym->address;
+            idx->entries[count].order = count;
+            idx->entries[count].sym = sym;
+            count++;
+        }
+    }
+    if ( count ) {
+        qsort(idx->entries, count, sizeof(symbol_index_entry), symbol_index_compare);
+    }
+    // Keep the first symbol of each address
+    idx->count = 0;
+    for ( i = 0; i < count; i++ ) {
+        if ( idx->count == 0 || idx->entries[idx->count - 1].address != idx->entries[i].address ) {
+            idx->entries[idx->count++] = idx->entries[i];
         }
+    }
+    idx->valid = 1;
+    return idx;
+}
+
+// Index of the last entry at or below an address, -1 if there's none
+static int symbol_index_lower(symbol_index *idx, unsigned int addr)
+{
+    int lo = 0, hi = idx->count;
 
-        if ( sym != NULL ) {
-            *offset = original_address - addr;
-            return sym;
-        } 
-        addr--;
+    while ( lo < hi ) {
+        int mid = lo + (hi - lo) / 2;
+
+        if ( idx->entries[mid].address <= addr ) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    return lo - 1;
+}
 
-    return NULL;
+// Find a symbol lower than where we were. Banked symbols have the bank in
+// the upper bits of their address, they are used for an address in the
+// bank while it's paged in.
+symbol* symbol_find_lower_banked(int bank, int addr, symboltype preferred_type, uint16_t* offset)
+{
+    symbol_index *idx;
+    int           i;
+
+    if ( addr < 0 ) {
+        return NULL;
+    }
+    idx = symbol_index_get(preferred_type);
+
+    if ( bank > 0 && addr < 65536 ) {
+        unsigned int banked = ((unsigned int)bank << 16) | addr;
+
+        i = symbol_index_lower(idx, banked);
+        if ( i >= 0 && (idx->entries[i].address >> 16) == (unsigned int)bank ) {
+            *offset = banked - idx->entries[i].address;
+            return idx->entries[i].sym;
+        }
+    }
+
+    i = symbol_index_lower(idx, addr);
+    if ( i < 0 ) {
+        return NULL;
+    }
+    *offset = addr - idx->entries[i].address;
+    return idx->entries[i].sym;
+}
+
+// The first symbol above an address (with the bank in the upper bits), where
+// the code of the symbol at or below it ends
+symbol* symbol_find_higher(unsigned int addr, symboltype preferred_type)
+{
+    symbol_index *idx = symbol_index_get(preferred_type);
+    int           i = symbol_index_lower(idx, addr) + 1;
+
+    return i < idx->count ? idx->entries[i].sym : NULL;
+}
+
+symbol* symbol_find_lower(int addr, symboltype preferred_type, uint16_t* offset)
+{
+    int bank = -1;
+
+    if ( addr >= 0 && addr < 65536 && bk.bank != NULL ) {
+        bank = bk.bank(addr);
+    }
+    return symbol_find_lower_banked(bank, addr, preferred_type, offset);
 }
 
 const char *find_symbol(int addr, symboltype preferred_type)
@@ -460,6 +584,7 @@ void symbol_add_autolabel(int address, char *label)
     sym->address = address;
     sym->symtype = SYM_ADDRESS;
     LL_APPEND(symbols[sym->address % SYM_TAB_SIZE], sym);
+    symbol_index_invalidate();
     HASH_ADD_KEYPTR(hh, global_symbols, sym->name, strlen(sym->name), sym);
 
 }
@@ -34,6 +34,8 @@ struct symbol_file_s {
 };
 
 extern symbol* symbol_find_lower(int addr, symboltype preferred_type, uint16_t* offset);
+extern symbol* symbol_find_lower_banked(int bank, int addr, symboltype preferred_type, uint16_t* offset);
+extern symbol* symbol_find_higher(unsigned int addr, symboltype preferred_type);
 extern void      read_symbol_file(char *filename);
 extern const char     *find_symbol(int addr, symboltype preferred_symtype);
 extern symbol   *find_symbol_byname(const char *name, const char *filename);
@@ -89,6 +89,8 @@ extern void      hook_console_init(hook_command *cmds);
 extern void memory_init(char *model);
 extern void memory_handle_paging(int port, int value);
 extern void memory_reset_paging();
+extern int memory_bank(uint16_t pc);
+extern void memory_set_rom_size(int size);
 
 
 extern void        out(int port, int value);
@@ -99,6 +99,7 @@ void ucpp_error(long line, char *fmt, ...)
 {
 	va_list ap;
 
+	snapshot_cancel();
 	va_start(ap, fmt);
 	if (line > 0)
 		fprintf(stderr, "%s:%ld: ", current_filename, line);
@@ -125,6 +126,7 @@ void ucpp_warning(long line, char *fmt, ...)
 {
 	va_list ap;
 
+	snapshot_cancel();
 	va_start(ap, fmt);
 	if (line > 0)
 		fprintf(stderr, "%s:%ld: warning: ",
@@ -321,6 +323,81 @@ static void init_found_files(void)
 	found_files_sys_init_done = 1;
 }
 
+/*
+ * Snapshot support (see snapshot.c): the found files are saved with
+ * their size and date, so that a snapshot is not used once one of them
+ * has changed. The main file of the recording run is left out.
+ */
+static char *snapshot_main;
+
+static void save_found_file(void *x)
+{
+	struct found_file *ff = x;
+	char *key = HASH_ITEM_NAME(ff);
+
+	if (!strcmp(key, snapshot_main)) return;
+	snap_put_str(key);
+	snap_put_str(ff->name);
+	snap_put_str(ff->protect);
+	snap_put_stamp(key);
+}
+
+static void save_found_file_sys(void *x)
+{
+	struct found_file_sys *ffs = x;
+
+	if (!strcmp(HASH_ITEM_NAME(ffs->rff), snapshot_main)) return;
+	snap_put_str(HASH_ITEM_NAME(ffs));
+	snap_put_str(HASH_ITEM_NAME(ffs->rff));
+	snap_put_u32((unsigned long)ffs->incdir);
+}
+
+void save_found_files(char *main_name)
+{
+	snapshot_main = main_name;
+	HTT_scan(&found_files, save_found_file);
+	snap_put_str(0);
+	HTT_scan(&found_files_sys, save_found_file_sys);
+	snap_put_str(0);
+}
+
+/*
+ * Read the found files of a snapshot; they are only checked if apply is
+ * zero. Returns 0 if the snapshot is damaged or out of date.
+ */
+int load_found_files(int apply)
+{
+	char *key;
+
+	while ((key = snap_get_str()) != 0) {
+		char *name = snap_get_str(), *protect = snap_get_str();
+
+		if (!snap_check_stamp(key) && !apply) return 0;
+		if (apply && !HTT_get(&found_files, key)) {
+			struct found_file *ff = new_found_file();
+
+			ff->name = name ? sdup(name) : 0;
+			ff->protect = protect ? sdup(protect) : 0;
+			HTT_put(&found_files, ff, key);
+		}
+	}
+	while ((key = snap_get_str()) != 0) {
+		char *rff = snap_get_str();
+		int incdir = (int)snap_get_u32();
+		struct found_file_sys *ffs;
+
+		if (!rff) return 0;
+		if (apply && !HTT_get(&found_files_sys, key)) {
+			ffs = new_found_file_sys();
+			ffs->rff = HTT_get(&found_files, rff);
+			ffs->incdir = incdir;
+			if (ffs->rff) HTT_put(&found_files_sys, ffs, key);
+			else freemem(ffs);
+		}
+	}
+	return 1;
+}
+
 /*
  * Set the lexer state at the beginning of a file.
  */
@@ -742,6 +819,7 @@ static FILE *find_file(char *name, int localdir)
 		lf = 1;
 		goto found_file;
 	}
+	if (localdir) snapshot_missed(s ? s : name);
 	/*
 	 * If s contains a name, that name is now irrelevant: it was a
 	 * filename for a search in the current directory, and the file
@@ -806,6 +884,7 @@ static FILE *find_file(char *name, int localdir)
 		f = fopen(s, "r");
 #endif
 		if (f) goto found_file;
+		snapshot_missed(s);
 		freemem(s);
 		s = 0;
 	}
@@ -976,6 +1055,7 @@ static FILE *find_file_next(char *name)
 			current_incdir = i;
 			return f;
 		}
+		snapshot_missed(s);
 		freemem(s);
 	}
 	return 0;
@@ -1916,10 +1996,12 @@ static int handle_cpp(struct lexer_state *ls, int sharp_type)
 				goto handle_exit;
 			} else if ((ls->flags & HANDLE_ASSERTIONS)
 				&& !strcmp(ls->ctok->name, "assert")) {
+				snapshot_cancel();
 				ret = handle_assert(ls);
 				goto handle_exit;
 			} else if ((ls->flags & HANDLE_ASSERTIONS)
 				&& !strcmp(ls->ctok->name, "unassert")) {
+				snapshot_cancel();
 				ret = handle_unassert(ls);
 				goto handle_exit;
 			}
@@ -2034,6 +2116,7 @@ int cpp(struct lexer_state *ls)
 {
 	int r = 0;
 
+	if (snapshot_recording && ls_depth == 0) snapshot_point(ls);
 	while (next_token(ls)) {
 		if (protect_detect.state == 3) {
 			/*
@@ -2069,6 +2152,7 @@ int cpp(struct lexer_state *ls)
 			ls->ltwnl = 1;
 			break;
 		}
+		if (snapshot_recording && ls_depth == 0) snapshot_point(ls);
 	}
 	if (!(ls->ltwnl && (ls->ctok->type == SHARP
 		|| ls->ctok->type == DIG_SHARP))
@@ -2358,6 +2442,9 @@ static void usage(char *command_name)
 			"output\n"
 	"  -Ma             emit also dependancies for system files\n"
 	"  -o file         store output in file\n"
+	"  -snapshot dir   save and reuse the state after the leading "
+			"#include lines\n"
+	"                  of the input in 'dir'\n"
 	"macro and assertion options:\n"
 	"  -Dmacro         predefine 'macro'\n"
 	"  -Dmacro=def     predefine 'macro' with 'def' content\n"
@@ -2387,6 +2474,8 @@ static void version(void)
 		fprintf(stderr, "  %s\n", include_path[i]);
 }
 
+static int snapshot_restored = 0;
+
 /*
  * parse_opt() initializes many things according to the command-line
  * options.
@@ -2407,6 +2496,22 @@ static int parse_opt(int argc, char *argv[], struct lexer_state *ls)
 	ls->flags = DEFAULT_CPP_FLAGS;
 	emit_output = ls->output = stdout;
 	for (i = 1; i < argc; i ++) if (argv[i][0] == '-') {
+		if (!strcmp(argv[i], "-snapshot")) {
+			if ((++ i) >= argc) {
+				error(-1, "missing directory after -snapshot");
+				return 2;
+			}
+			snapshot_dir = argv[i];
+			continue;
+		}
+		if (strcmp(argv[i], "-o")) {
+			snapshot_add_option(argv[i]);
+			if (i + 1 < argc && (!strcmp(argv[i], "-I")
+				|| !strcmp(argv[i], "-J")
+				|| !strcmp(argv[i], "-iquote")
+				|| !strcmp(argv[i], "-isystem")))
+				snapshot_add_option(argv[i + 1]);
+		}
 		if (!strcmp(argv[i], "-h")) {
 			return 2;
 		} else if (!strcmp(argv[i], "-C")) {
@@ -2579,6 +2684,8 @@ static int parse_opt(int argc, char *argv[], struct lexer_state *ls)
 
         }
 
+	if (filename && !print_version)
+		snapshot_restored = snapshot_restore(ls, filename);
 	if (print_version) {
 		version();
 		return 1;
@@ -2604,7 +2711,7 @@ int main(int argc, char *argv[])
 		if (r == 2) usage(argv[0]);
 		return EXIT_FAILURE;
 	}
-	enter_file(&ls, ls.flags);
+	if (!snapshot_restored) enter_file(&ls, ls.flags);
 	while ((r = cpp(&ls)) < CPPERR_EOF) fr = fr || (r > 0);
 	fr = fr || check_cpp_errors(&ls);
 	free_lexer_state(&ls);
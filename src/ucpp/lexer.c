@@ -437,6 +437,7 @@ void flush_output(struct lexer_state *ls)
 	size_t x = ls->sbuf, y = 0, z;
 
 	if (ls->sbuf == 0) return;
+	if (snapshot_recording) snapshot_output(ls->output_buf, ls->sbuf);
 	do {
 		z = fwrite(ls->output_buf + y, 1, x, ls->output);
 		x -= z;
@@ -460,6 +461,7 @@ static inline void write_char(struct lexer_state *ls, unsigned char c)
 	ls->output_buf[ls->sbuf ++] = c;
 	if (ls->sbuf == OUTPUT_BUF_MEMG) flush_output(ls);
 #else
+	if (snapshot_recording) snapshot_output(&c, 1);
 	if (putc((int)c, ls->output) == EOF) {
 		error(ls->line, "output write error (disk full ?)");
 		die();
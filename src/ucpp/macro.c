@@ -1100,6 +1100,7 @@ int substitute_macro(struct lexer_state *ls, struct macro *m,
 			freemem(bbuf);
 			break;
 		case MAC_DATE:
+			snapshot_cancel();
 			t.type = STRING;
 			t.line = l;
 			t.name = compile_date;
@@ -1107,6 +1108,7 @@ int substitute_macro(struct lexer_state *ls, struct macro *m,
 			print_token(ls, &t, 0);
 			break;
 		case MAC_TIME:
+			snapshot_cancel();
 			t.type = STRING;
 			t.line = l;
 			t.name = compile_time;
@@ -1917,6 +1919,80 @@ void init_macros(void)
 	if (!no_special_macros) add_special_macros();
 }
 
+/*
+ * Snapshot support (see snapshot.c): the special macros are left out,
+ * they are set up again by init_macros().
+ */
+static void save_macro(void *vm)
+{
+	struct macro *m = vm;
+	char *mname = HASH_ITEM_NAME(m);
+	int i;
+
+	if (check_special_macro(mname) != MAC_NONE) return;
+	snap_put_str(mname);
+	snap_put_u32((unsigned long)m->narg);
+	for (i = 0; i < m->narg; i ++) snap_put_str(m->arg[i]);
+	snap_put_u32(m->vaarg);
+#ifdef LOW_MEM
+	snap_put_bytes(m->cval.t, m->cval.length);
+#endif
+}
+
+void save_macros(void)
+{
+	HTT_scan(&macros, save_macro);
+	snap_put_str(0);
+}
+
+/*
+ * Read the macros of a snapshot, replacing the macro table if apply is
+ * non-zero; returns 0 if the snapshot is damaged.
+ */
+int load_macros(int apply)
+{
+#ifdef LOW_MEM
+	char *mname;
+
+	if (apply) init_macros();
+	while ((mname = snap_get_str()) != 0) {
+		int narg = (int)snap_get_u32(), i;
+		struct macro *m = 0;
+		unsigned char *t;
+		size_t len;
+
+		if (narg < -1 || narg > 255) return 0;
+		if (apply) {
+			m = new_macro();
+			m->narg = narg;
+			if (narg > 0) m->arg = getmem(narg * sizeof(char *));
+		}
+		for (i = 0; i < narg; i ++) {
+			char *a = snap_get_str();
+
+			if (!a) a = "";
+			if (m) m->arg[i] = sdup(a);
+		}
+		i = (int)snap_get_u32();
+		t = snap_get_bytes(&len);
+		if (m) {
+			m->vaarg = i;
+			if (len) {
+				m->cval.t = getmem(len);
+				mmv(m->cval.t, t, len);
+			}
+			m->cval.length = len;
+			m->cval.rp = 0;
+			if (HTT_get(&macros, mname)) HTT_del(&macros, mname);
+			HTT_put(&macros, m, mname);
+		}
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /*
  * find a macro from its name
  */
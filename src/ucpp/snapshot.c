@@ -0,0 +1,557 @@
+/*
+ * Header snapshots for the stand-alone preprocessor (z88dk)
+ *
+ * Most C files start with the same run of #include lines for the target
+ * headers. With "-snapshot dir", the state reached at the end of that run
+ * (macro table, known files with their include guards, and the output
+ * produced so far) is saved to a file in "dir" and reloaded by later runs
+ * that have the same options and the same leading #include lines, which
+ * then resume reading the main file after them.
+ *
+ * A snapshot is only saved when its prefix was preprocessed without any
+ * diagnostic, assertion change or __DATE__/__TIME__ expansion, and it is
+ * ignored when any of the files it read has changed size or date, or
+ * when a file it looked for and did not find (an earlier directory in
+ * the include path) now exists.
+ */
+
+#include "tune.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getcwd	_getcwd
+#define getpid	_getpid
+#else
+#include <unistd.h>
+#endif
+#include "ucppi.h"
+#include "mem.h"
+
+#define SNAPSHOT_MAGIC		"UCPPSNAP"
+#define SNAPSHOT_VERSION	2
+#define SNAPSHOT_NONE		0xFFFFFFFFUL
+
+char *snapshot_dir = 0;
+int snapshot_recording = 0;
+
+static char *key_text = 0;		/* options, directories, #include lines */
+static size_t key_len = 0, key_size = 0;
+static char *snapshot_file = 0;
+static char *main_name = 0;
+static long prefix_line, prefix_offset;
+static int tainted = 0;
+
+static unsigned char *capture = 0;	/* output of the recording run */
+static size_t capture_len = 0, capture_size = 0;
+
+static char *missed = 0;		/* files looked for and not found */
+static size_t missed_len = 0, missed_size = 0;
+
+static void key_add(const char *s, size_t len)
+{
+	if (key_len + len + 1 > key_size) {
+		size_t n = key_size ? key_size : 256;
+
+		while (key_len + len + 1 > n) n *= 2;
+		key_text = key_text ? incmem(key_text, key_size, n)
+			: getmem(n);
+		key_size = n;
+	}
+	mmv(key_text + key_len, (void *)s, len);
+	key_len += len;
+	key_text[key_len ++] = '\n';
+}
+
+/*
+ * Record a command-line option that changes the preprocessor state.
+ */
+void snapshot_add_option(char *opt)
+{
+	key_add(opt, strlen(opt));
+}
+
+/*
+ * Record the output of the recording run.
+ */
+void snapshot_output(unsigned char *buf, size_t len)
+{
+	if (!snapshot_recording) return;
+	if (capture_len + len > capture_size) {
+		size_t n = capture_size ? capture_size : 8192;
+
+		while (capture_len + len > n) n *= 2;
+		capture = capture ? incmem(capture, capture_size, n)
+			: getmem(n);
+		capture_size = n;
+	}
+	mmv(capture + capture_len, buf, len);
+	capture_len += len;
+}
+
+/*
+ * Record a file that an #include looked for and did not find while
+ * recording. If it appears later, the #include finds it instead of the
+ * file that was read.
+ */
+void snapshot_missed(char *path)
+{
+	size_t len = strlen(path) + 1;
+
+	if (!snapshot_recording) return;
+	if (missed_len + len > missed_size) {
+		size_t n = missed_size ? missed_size : 1024;
+
+		while (missed_len + len > n) n *= 2;
+		missed = missed ? incmem(missed, missed_size, n)
+			: getmem(n);
+		missed_size = n;
+	}
+	mmv(missed + missed_len, path, len);
+	missed_len += len;
+}
+
+/*
+ * Something in the prefix cannot be replayed from a snapshot.
+ */
+void snapshot_cancel(void)
+{
+	tainted = 1;
+}
+
+/*
+ * Snapshot file writer and reader.
+ */
+static FILE *snap_out;
+static unsigned char *snap_buf;
+static size_t snap_len, snap_pos;
+static int snap_bad;
+
+void snap_put_u32(unsigned long x)
+{
+	unsigned char b[4];
+
+	b[0] = x & 0xFF;
+	b[1] = (x >> 8) & 0xFF;
+	b[2] = (x >> 16) & 0xFF;
+	b[3] = (x >> 24) & 0xFF;
+	fwrite(b, 1, 4, snap_out);
+}
+
+void snap_put_bytes(const void *p, size_t len)
+{
+	snap_put_u32(len);
+	fwrite(p, 1, len, snap_out);
+}
+
+/* strings are stored with their trailing 0, a null pointer is SNAPSHOT_NONE */
+void snap_put_str(char *s)
+{
+	if (!s) {
+		snap_put_u32(SNAPSHOT_NONE);
+		return;
+	}
+	snap_put_bytes(s, strlen(s) + 1);
+}
+
+unsigned long snap_get_u32(void)
+{
+	unsigned char *b = snap_buf + snap_pos;
+
+	if (snap_bad || snap_len - snap_pos < 4) {
+		snap_bad = 1;
+		return 0;
+	}
+	snap_pos += 4;
+	return (unsigned long)b[0] | ((unsigned long)b[1] << 8)
+		| ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+}
+
+unsigned char *snap_get_bytes(size_t *len)
+{
+	unsigned long n = snap_get_u32();
+	unsigned char *p = snap_buf + snap_pos;
+
+	if (snap_bad || n == SNAPSHOT_NONE || n > snap_len - snap_pos) {
+		if (n != SNAPSHOT_NONE) snap_bad = 1;
+		*len = 0;
+		return 0;
+	}
+	snap_pos += n;
+	*len = n;
+	return p;
+}
+
+/* returns a pointer into the loaded snapshot, or 0 */
+char *snap_get_str(void)
+{
+	size_t len;
+	char *s = (char *)snap_get_bytes(&len);
+
+	if (s && (len == 0 || s[len - 1] != 0)) {
+		snap_bad = 1;
+		return 0;
+	}
+	return s;
+}
+
+/*
+ * Write the size and date of a file, check them against a loaded snapshot.
+ */
+void snap_put_stamp(char *path)
+{
+	struct stat st;
+	unsigned long long t = 0;
+	unsigned long size = 0;
+
+	if (stat(path, &st) == 0) {
+		t = (unsigned long long)st.st_mtime;
+		size = (unsigned long)st.st_size;
+	} else {
+		tainted = 1;
+	}
+	snap_put_u32(size);
+	snap_put_u32((unsigned long)(t & 0xFFFFFFFFUL));
+	snap_put_u32((unsigned long)(t >> 32));
+}
+
+int snap_check_stamp(char *path)
+{
+	struct stat st;
+	unsigned long long t;
+	unsigned long size = snap_get_u32();
+
+	t = snap_get_u32();
+	t |= (unsigned long long)snap_get_u32() << 32;
+	if (snap_bad || stat(path, &st) != 0) return 0;
+	return size == (unsigned long)st.st_size
+		&& t == (unsigned long long)st.st_mtime;
+}
+
+/*
+ * Write the files that were not found, check that they're still missing.
+ */
+static void save_missed(void)
+{
+	size_t i;
+
+	for (i = 0; i < missed_len; i += strlen(missed + i) + 1)
+		snap_put_str(missed + i);
+	snap_put_str(0);
+}
+
+static int load_missed(int apply)
+{
+	struct stat st;
+	char *path;
+
+	while ((path = snap_get_str()) != 0)
+		if (!apply && stat(path, &st) == 0) return 0;
+	return !snap_bad;
+}
+
+static int is_space(int c)
+{
+	return c == ' ' || c == '\t' || c == '\f' || c == '\v';
+}
+
+/*
+ * Find the leading #include lines of the main file: only lines made of
+ * white space, comments and one #include <file> or #include "file"
+ * belong to it, and it ends at the start of a line outside of a comment.
+ * The #include lines are added to the key; returns 0 if there are none.
+ */
+static int scan_prefix(char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	unsigned char *buf, *p, *end;
+	long size, line = 1;
+	size_t good_key;
+	int in_comment = 0, includes = 0, good_includes = 0;
+
+	if (!f) return 0;
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0
+		|| fseek(f, 0, SEEK_SET)) {
+		fclose(f);
+		return 0;
+	}
+	buf = getmem(size + 1);
+	if (fread(buf, 1, size, f) != (size_t)size) {
+		freemem(buf);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	p = buf;
+	end = buf + size;
+	prefix_line = 1;
+	prefix_offset = 0;
+	good_key = key_len;
+	while (p < end) {
+		unsigned char *eol = memchr(p, '\n', end - p), *q = p;
+		int clean = 1, seen = 0;
+
+		if (!eol) break;
+		if ((eol > p && eol[-1] == '\\') || (eol - p > 1
+			&& eol[-1] == '\r' && eol[-2] == '\\')) break;
+		while (clean && q < eol) {
+			if (in_comment) {
+				for (; q + 1 < eol; q ++)
+					if (q[0] == '*' && q[1] == '/') break;
+				if (q + 1 < eol) {
+					q += 2;
+					in_comment = 0;
+				} else q = eol;
+			} else if (is_space(*q)) {
+				q ++;
+			} else if (*q == '\r' && q + 1 == eol) {
+				q ++;
+			} else if (*q == '/' && q + 1 < eol && q[1] == '/') {
+				q = eol;
+			} else if (*q == '/' && q + 1 < eol && q[1] == '*') {
+				q += 2;
+				in_comment = 1;
+			} else if (*q == '#' && !seen) {
+				unsigned char *n, c;
+
+				for (q ++; q < eol && is_space(*q); q ++);
+				if (eol - q < 8 || memcmp(q, "include", 7)) {
+					clean = 0;
+					break;
+				}
+				for (q += 7; q < eol && is_space(*q); q ++);
+				if (q == eol || (*q != '<' && *q != '"')) {
+					clean = 0;
+					break;
+				}
+				c = (*q == '<') ? '>' : '"';
+				for (n = q + 1; n < eol && *n != c; n ++);
+				if (n == eol) {
+					clean = 0;
+					break;
+				}
+				key_add((char *)q, n + 1 - q);
+				includes ++;
+				q = n + 1;
+				seen = 1;
+			} else clean = 0;
+		}
+		if (!clean) break;
+		p = eol + 1;
+		line ++;
+		if (!in_comment) {
+			prefix_line = line;
+			prefix_offset = p - buf;
+			good_key = key_len;
+			good_includes = includes;
+		}
+	}
+	freemem(buf);
+	key_len = good_key;
+	return good_includes > 0;
+}
+
+/* 64-bit FNV-1a */
+static unsigned long long hash_key(void)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	size_t i;
+
+	for (i = 0; i < key_len; i ++) {
+		h ^= (unsigned char)key_text[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*
+ * Read a snapshot; with apply == 0 it is only checked, and it is applied
+ * to the preprocessor state otherwise.
+ */
+static int read_snapshot(struct lexer_state *ls, int apply)
+{
+	size_t len, out_len, main_len, i;
+	unsigned char *key, *out;
+	char *recorded;
+	long line, offset, oline;
+
+	snap_pos = 0;
+	snap_bad = 0;
+	if (snap_len < 8 || memcmp(snap_buf, SNAPSHOT_MAGIC, 8)) return 0;
+	snap_pos = 8;
+	if (snap_get_u32() != SNAPSHOT_VERSION) return 0;
+	key = snap_get_bytes(&len);
+	if (!key || len != key_len || memcmp(key, key_text, len)) return 0;
+	recorded = snap_get_str();
+	line = snap_get_u32();
+	offset = snap_get_u32();
+	oline = snap_get_u32();
+	if (snap_bad || !recorded || line != prefix_line
+		|| offset != prefix_offset) return 0;
+	if (!load_found_files(apply)) return 0;
+	if (!load_missed(apply)) return 0;
+	if (!load_macros(apply)) return 0;
+	out = snap_get_bytes(&out_len);
+	if (snap_bad || snap_pos != snap_len) return 0;
+	if (!apply) return 1;
+
+	/*
+	 * Replay the output, the #line directives naming the recorded main
+	 * file now name this one.
+	 */
+	main_len = strlen(recorded);
+	for (i = 0; i < out_len; i ++) {
+		if (out[i] == '"' && out_len - i > main_len + 2
+			&& !memcmp(out + i + 1, recorded, main_len)
+			&& out[i + main_len + 1] == '"'
+			&& out[i + main_len + 2] == '\n') {
+			char *c;
+
+			put_char(ls, '"');
+			for (c = main_name; *c; c ++) put_char(ls, *c);
+			i += main_len + 1;
+		}
+		put_char(ls, out[i]);
+	}
+	ls->oline = oline;
+	return 1;
+}
+
+static int seek_input(struct lexer_state *ls, long offset)
+{
+#ifndef NO_UCPP_BUF
+#ifdef UCPP_MMAP
+	if (ls->from_mmap) {
+		if ((size_t)offset > ls->ebuf) return 1;
+		ls->pbuf = offset;
+		return 0;
+	}
+#endif
+	ls->pbuf = ls->ebuf = 0;
+#endif
+	return fseek(ls->input, offset, SEEK_SET);
+}
+
+/*
+ * Called once the options are parsed and the main file is open. Returns
+ * 1 if a snapshot was restored, the main file is then positioned after
+ * its leading #include lines. Otherwise this run may record one.
+ */
+int snapshot_restore(struct lexer_state *ls, char *filename)
+{
+	char cwd[4096];
+	char *s;
+	size_t n;
+	FILE *f;
+	long size;
+	int ok = 0;
+
+#ifndef LOW_MEM
+	/* only the compressed macro storage can be saved */
+	snapshot_dir = 0;
+#endif
+	if (!snapshot_dir || !(ls->flags & KEEP_OUTPUT)
+		|| !(ls->flags & DISCARD_COMMENTS)
+		|| emit_dependencies || emit_defines || emit_assertions)
+		return 0;
+	if (!getcwd(cwd, sizeof cwd)) return 0;
+	key_add(cwd, strlen(cwd));
+	for (s = filename + strlen(filename); s > filename; s --)
+		if (s[-1] == '/' || s[-1] == '\\') break;
+	key_add(filename, s - filename);
+	if (!scan_prefix(filename)) return 0;
+
+	n = strlen(snapshot_dir) + 32;
+	snapshot_file = getmem(n);
+	sprintf(snapshot_file, "%s/%016llx.ups", snapshot_dir, hash_key());
+	main_name = sdup(filename);
+	if ((f = fopen(snapshot_file, "rb")) != 0) {
+		if (!fseek(f, 0, SEEK_END) && (size = ftell(f)) > 0
+			&& !fseek(f, 0, SEEK_SET)) {
+			snap_buf = getmem(size);
+			snap_len = fread(snap_buf, 1, size, f);
+			ok = snap_len == (size_t)size
+				&& read_snapshot(ls, 0)
+				&& !seek_input(ls, prefix_offset)
+				&& read_snapshot(ls, 1);
+			freemem(snap_buf);
+			snap_buf = 0;
+		}
+		fclose(f);
+	}
+	if (ok) {
+		ls->line = prefix_line;
+		ls->last = '\n';
+		ls->discard = 1;
+		ls->ltwnl = 1;
+		protect_detect.state = 0;
+		return 1;
+	}
+	if (seek_input(ls, 0)) return 0;
+	snapshot_recording = 1;
+	return 0;
+}
+
+/*
+ * Called by cpp() before each token of the main file while recording;
+ * saves the snapshot when the end of the leading #include lines is
+ * reached.
+ */
+void snapshot_point(struct lexer_state *ls)
+{
+	char *tmp;
+	int err;
+
+	if (ls->line < prefix_line) return;
+	if (tainted || ls->ifnest || ls->nlka || !ls->discard
+		|| ls->pending_token || !ls->condcomp
+		|| ls->line != prefix_line) {
+		snapshot_recording = 0;
+		goto done;
+	}
+#ifndef NO_UCPP_BUF
+	flush_output(ls);
+#endif
+	snapshot_recording = 0;
+	tmp = getmem(strlen(snapshot_file) + 32);
+	sprintf(tmp, "%s.%ld.tmp", snapshot_file, (long)getpid());
+	if ((snap_out = fopen(tmp, "wb")) == 0) {
+		freemem(tmp);
+		goto done;
+	}
+	fwrite(SNAPSHOT_MAGIC, 1, 8, snap_out);
+	snap_put_u32(SNAPSHOT_VERSION);
+	snap_put_bytes(key_text, key_len);
+	snap_put_str(main_name);
+	snap_put_u32(prefix_line);
+	snap_put_u32(prefix_offset);
+	snap_put_u32(ls->oline);
+	save_found_files(main_name);
+	save_missed();
+	save_macros();
+	snap_put_bytes(capture, capture_len);
+	err = ferror(snap_out);
+	err |= fclose(snap_out);
+	if (err || tainted) {
+		remove(tmp);
+	} else {
+		/* another run may have won the race, that one is as good */
+		remove(snapshot_file);
+		if (rename(tmp, snapshot_file)) remove(tmp);
+	}
+	freemem(tmp);
+done:
+	if (capture) freemem(capture);
+	capture = 0;
+	capture_len = capture_size = 0;
+	if (missed) freemem(missed);
+	missed = 0;
+	missed_len = missed_size = 0;
+}
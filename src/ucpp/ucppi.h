@@ -123,6 +123,8 @@ struct macro {
 #define substitute_macro	ucpp_substitute_macro
 #define get_macro		ucpp_get_macro
 #define wipe_macros		ucpp_wipe_macros
+#define save_macros		ucpp_save_macros
+#define load_macros		ucpp_load_macros
 #define dsharp_lexer		ucpp_dsharp_lexer
 #define compile_time		ucpp_compile_time
 #define compile_date		ucpp_compile_date
@@ -139,6 +141,8 @@ int substitute_macro(struct lexer_state *, struct macro *,
 	struct token_fifo *, int, int, long);
 struct macro *get_macro(char *);
 void wipe_macros(void);
+void save_macros(void);
+int load_macros(int);
 
 extern struct lexer_state dsharp_lexer;
 extern char compile_time[], compile_date[];
@@ -177,6 +181,8 @@ extern JMP_BUF eval_exception;
 #define throw_away		ucpp_throw_away
 #define garbage_collect		ucpp_garbage_collect
 #define init_buf_lexer_state	ucpp_init_buf_lexer_state
+#define save_found_files	ucpp_save_found_files
+#define load_found_files	ucpp_load_found_files
 #ifdef PRAGMA_TOKENIZE
 #define compress_token_list	ucpp_compress_token_list
 #endif
@@ -185,6 +191,8 @@ char *token_name(struct token *);
 void throw_away(struct garbage_fifo *, char *);
 void garbage_collect(struct garbage_fifo *);
 void init_buf_lexer_state(struct lexer_state *, int);
+void save_found_files(char *);
+int load_found_files(int);
 #ifdef PRAGMA_TOKENIZE
 struct comp_token_fifo compress_token_list(struct token_fifo *);
 #endif
@@ -193,4 +201,41 @@ struct comp_token_fifo compress_token_list(struct token_fifo *);
 #define error		ucpp_error
 #define warning		ucpp_warning
 
+/*
+ * from snapshot.c
+ */
+#define snapshot_dir		ucpp_snapshot_dir
+#define snapshot_recording	ucpp_snapshot_recording
+#define snapshot_add_option	ucpp_snapshot_add_option
+#define snapshot_output		ucpp_snapshot_output
+#define snapshot_cancel		ucpp_snapshot_cancel
+#define snapshot_restore	ucpp_snapshot_restore
+#define snapshot_point		ucpp_snapshot_point
+#define snapshot_missed		ucpp_snapshot_missed
+#define snap_put_u32		ucpp_snap_put_u32
+#define snap_put_bytes		ucpp_snap_put_bytes
+#define snap_put_str		ucpp_snap_put_str
+#define snap_put_stamp		ucpp_snap_put_stamp
+#define snap_get_u32		ucpp_snap_get_u32
+#define snap_get_bytes		ucpp_snap_get_bytes
+#define snap_get_str		ucpp_snap_get_str
+#define snap_check_stamp	ucpp_snap_check_stamp
+
+extern char *snapshot_dir;
+extern int snapshot_recording;
+void snapshot_add_option(char *);
+void snapshot_output(unsigned char *, size_t);
+void snapshot_cancel(void);
+int snapshot_restore(struct lexer_state *, char *);
+void snapshot_point(struct lexer_state *);
+void snapshot_missed(char *);
+void snap_put_u32(unsigned long);
+void snap_put_bytes(const void *, size_t);
+void snap_put_str(char *);
+void snap_put_stamp(char *);
+unsigned long snap_get_u32(void);
+unsigned char *snap_get_bytes(size_t *);
+char *snap_get_str(void);
+int snap_check_stamp(char *);
+
 #endif
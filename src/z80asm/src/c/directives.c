@@ -126,6 +126,9 @@ static int* DEFVARS_PC = &DEFVARS_STRUCT_PC;	/* select current DEFVARS PC*/
 /* start a new DEFVARS context, closing any previously open one */
 void asm_DEFVARS_start(int start_addr)
 {
+	if (start_addr != 0)
+		module_depends_on_previous();		/* DEFVARS_GLOBAL_PC is shared by all modules */
+
 	if (start_addr == -1)
 		DEFVARS_PC = &DEFVARS_GLOBAL_PC;	/* continue from previous DEFVARS_GLOBAL_PC */
 	else if (start_addr == 0)
@@ -23,6 +23,7 @@ see http://www.engr.mun.ca/~theo/Misc/exp_parsing.htm
 #include "symtab1.h"
 #include "utstring.h"
 #include "utlist.h"
+#include <stdint.h>
 
 /*-----------------------------------------------------------------------------
 *	UT_array of Expr1*
@@ -116,7 +117,7 @@ static long _calc_power(long base, long exp)
 *	Calculation functions for all operators, template:
 *	long calc_<symbol> (long a [, long b [, long c ] ] );
 *----------------------------------------------------------------------------*/
-#define OPERATOR(_operation, _tok, _type, _prec, _assoc, _args, _calc)	\
+#define OPERATOR(_operation, _code, _tok, _type, _prec, _assoc, _args, _calc)	\
 	static long calc_##_operation _args { return _calc; }
 #include "expr_def.h"
 
@@ -127,6 +128,9 @@ static long _calc_power(long base, long exp)
 /* hash of (tok,op_type) to Operator* */
 static StrHash* operator_hash;
 
+/* object file RPN code to Operator* */
+static Operator* operator_codes[256];
+
 /* compute hash key */
 static const char* operator_hash_key(tokid_t tok, op_type_t op_type)
 {
@@ -145,12 +149,13 @@ static void init_operator_hash(void)
 {
 	const char* key;
 
-#define OPERATOR(_operation, _tok, _type, _prec, _assoc, _args, _calc)		\
+#define OPERATOR(_operation, _code, _tok, _type, _prec, _assoc, _args, _calc)	\
 	{																		\
 		static Operator op_##_operation;									\
 																			\
 		/* init static operator structure */								\
 		op_##_operation.tok			= _tok;									\
+		op_##_operation.code		= _code;								\
 		op_##_operation.op_type		= _type;								\
 		op_##_operation.prec		= _prec;								\
 		op_##_operation.assoc		= _assoc;								\
@@ -159,6 +164,8 @@ static void init_operator_hash(void)
 																			\
 		key = operator_hash_key( _tok, _type );								\
 		StrHash_set( &operator_hash, key, & op_##_operation );				\
+		if ( _code )														\
+			operator_codes[(byte_t)(_code)] = & op_##_operation;			\
 	}
 #include "expr_def.h"
 }
@@ -180,6 +187,15 @@ Operator* Operator_get(tokid_t tok, op_type_t op_type)
 	return (Operator*)StrHash_get(operator_hash, key);
 }
 
+/* get the operator descriptor for the given object file RPN code, NULL if none */
+Operator* Operator_get_code(int code)
+{
+	init_module();
+	if (code <= 0 || code > 255)
+		return NULL;
+	return operator_codes[code];
+}
+
 /*-----------------------------------------------------------------------------
 *	Stack for calculator
 *----------------------------------------------------------------------------*/
@@ -991,3 +1007,168 @@ bool Expr_is_addr_diff(Expr1* self) {
 
 	return ret;
 }
+
+/*-----------------------------------------------------------------------------
+*	RPN code stored in object files
+*----------------------------------------------------------------------------*/
+static void rpn_append_byte(UT_string* code, int value)
+{
+	char c = (char)(value & 0xFF);
+	utstring_bincpy(code, &c, 1);
+}
+
+static void rpn_append_word(UT_string* code, int value)
+{
+	rpn_append_byte(code, value);
+	rpn_append_byte(code, value >> 8);
+}
+
+static void rpn_append_dword(UT_string* code, long long value)
+{
+	rpn_append_word(code, (int)(value & 0xFFFF));
+	rpn_append_word(code, (int)((value >> 16) & 0xFFFF));
+}
+
+static int rpn_word(const byte_t* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static long long rpn_dword(const byte_t* p)
+{
+	return (int32_t)((uint32_t)rpn_word(p) | ((uint32_t)rpn_word(p + 2) << 16));
+}
+
+/* append the RPN code of the expression to code; symbols are looked up in
+   name_index and appended to names if not there yet */
+void Expr_rpn_encode(Expr1* self, UT_string* code, StrHash** name_index, argv_t* names)
+{
+	for (size_t i = 0; i < ExprOpArray_size(self->rpn_ops); i++) {
+		ExprOp* op = ExprOpArray_item(self->rpn_ops, i);
+		intptr_t index;
+
+		switch (op->op_type) {
+		case ASMPC_OP:
+			rpn_append_byte(code, RPN_ASMPC);
+			break;
+
+		case NUMBER_OP:
+			if (op->d.value >= INT32_MIN && op->d.value <= INT32_MAX) {
+				rpn_append_byte(code, RPN_NUMBER);
+				rpn_append_dword(code, op->d.value);
+			}
+			else {
+				rpn_append_byte(code, RPN_NUMBER64);
+				rpn_append_dword(code, op->d.value);
+				rpn_append_dword(code, (long long)op->d.value >> 32);
+			}
+			break;
+
+		case SYMBOL_OP:
+			/* index is stored plus one, to tell it from a missing name */
+			index = (intptr_t)StrHash_get(*name_index, op->d.symbol->name);
+			if (index == 0) {
+				argv_push(names, op->d.symbol->name);
+				index = argv_len(names);
+				xassert(index <= 0x10000);
+				StrHash_set(name_index, op->d.symbol->name, (void*)index);
+			}
+			rpn_append_byte(code, RPN_SYMBOL);
+			rpn_append_word(code, (int)(index - 1));
+			break;
+
+		case UNARY_OP:
+		case BINARY_OP:
+		case TERNARY_OP:
+			xassert(op->d.op->code != 0);
+			rpn_append_byte(code, op->d.op->code);
+			break;
+
+		default:
+			xassert(0);
+		}
+	}
+}
+
+/* create expression in the current module from RPN code, resolving symbols
+   by index into names; return NULL if the code is malformed */
+Expr1* Expr_rpn_decode(const byte_t* code, int size, argv_t* names)
+{
+	Expr1* self = OBJ_NEW(Expr1);
+	int depth = 0;					/* number of operands on the calculator stack */
+	int pos = 0;
+
+	while (pos < size) {
+		int c = code[pos++];
+		Symbol1* symptr;
+		Operator* op;
+		int index, num_args;
+		long long value;
+
+		switch (c) {
+		case RPN_ASMPC:
+			ExprOp_init_asmpc(ExprOpArray_push(self->rpn_ops));
+			self->type = MAX(self->type, TYPE_ADDRESS);
+			depth++;
+			break;
+
+		case RPN_NUMBER:
+			if (pos + 4 > size)
+				goto error;
+			value = rpn_dword(code + pos);
+			pos += 4;
+
+			ExprOp_init_number(ExprOpArray_push(self->rpn_ops), (long)value);
+			self->type = MAX(self->type, TYPE_CONSTANT);
+			depth++;
+			break;
+
+		case RPN_NUMBER64:
+			if (pos + 8 > size)
+				goto error;
+			value = (long long)(((unsigned long long)rpn_dword(code + pos + 4) << 32) |
+				(rpn_dword(code + pos) & 0xFFFFFFFFLL));
+			pos += 8;
+
+			ExprOp_init_number(ExprOpArray_push(self->rpn_ops), (long)value);
+			self->type = MAX(self->type, TYPE_CONSTANT);
+			depth++;
+			break;
+
+		case RPN_SYMBOL:
+			if (pos + 2 > size)
+				goto error;
+			index = rpn_word(code + pos);
+			pos += 2;
+			if (index >= (int)argv_len(names))
+				goto error;
+
+			symptr = get_used_symbol(argv_get(names, index));
+			ExprOp_init_symbol(ExprOpArray_push(self->rpn_ops), symptr);
+			self->type = MAX(self->type, symptr->type);
+			depth++;
+			break;
+
+		default:
+			op = Operator_get_code(c);
+			if (op == NULL)
+				goto error;
+
+			num_args = op->op_type == UNARY_OP ? 1 : op->op_type == BINARY_OP ? 2 : 3;
+			if (depth < num_args)
+				goto error;
+			depth -= num_args - 1;
+
+			ExprOp_init_operator(ExprOpArray_push(self->rpn_ops), op->tok, op->op_type);
+		}
+	}
+
+	if (depth != 1)
+		goto error;
+
+	return self;
+
+error:
+	OBJ_DELETE(self);
+	return NULL;
+}
@@ -15,9 +15,14 @@ see http://www.engr.mun.ca/~theo/Misc/exp_parsing.htm
 #include "array.h"
 #include "class.h"
 #include "classlist.h"
+#include "objfile.h"
 #include "scan.h"
+#include "strhash.h"
+#include "strutil.h"
 #include "sym.h"
+#include "types.h"
 #include "utarray.h"
+#include "utstring.h"
 
 struct Module1;
 struct Section1;
@@ -44,6 +49,7 @@ typedef enum { ASSOC_NONE, ASSOC_LEFT, ASSOC_RIGHT } assoc_t;
 typedef struct Operator
 {
 	tokid_t		tok;				/* symbol */
+	char		code;				/* byte code in object file RPN */
 	op_type_t	op_type;			/* UNARY_OP, BINARY_OP, TERNARY_OP */
 	int			prec;				/* precedence lowest (1) to highest (N) */
 	assoc_t		assoc;				/* left or rigth association */
@@ -58,6 +64,9 @@ typedef struct Operator
 /* get the operator descriptor for the given (sym, op_type) */
 extern Operator* Operator_get(tokid_t tok, op_type_t op_type);
 
+/* get the operator descriptor for the given object file RPN code, NULL if none */
+extern Operator* Operator_get_code(int code);
+
 /*-----------------------------------------------------------------------------
 *	Expression operations
 *----------------------------------------------------------------------------*/
@@ -162,6 +171,19 @@ extern bool Expr_is_recusive(Expr1* self, const char* name);
 /* check if expression is difference of two addresses in the same section, convert it to a constant */
 bool Expr_is_addr_diff(Expr1* expr);
 
+/*-----------------------------------------------------------------------------
+*	RPN code stored in object files, operand codes in objfile.h,
+*	operator codes in expr_def.h
+*----------------------------------------------------------------------------*/
+
+/* append the RPN code of the expression to code; symbols are looked up in
+   name_index and appended to names if not there yet */
+extern void Expr_rpn_encode(Expr1* self, UT_string* code, StrHash** name_index, argv_t* names);
+
+/* create expression in the current module from RPN code, resolving symbols
+   by index into names; return NULL if the code is malformed */
+extern Expr1* Expr_rpn_decode(const byte_t* code, int size, argv_t* names);
+
 /*-----------------------------------------------------------------------------
 *	Stack for calculator
 *----------------------------------------------------------------------------*/
@@ -13,6 +13,7 @@
 #include "zobjfile.h"
 
 char Z80libhdr[] = "Z80LMF" OBJ_VERSION;
+char Z80libdir[] = "Z80LDX" OBJ_VERSION;
 
 /*-----------------------------------------------------------------------------
 *	define a library file name from the command line
@@ -37,6 +38,9 @@ void make_library(const char *lib_filename)
 	FILE	*lib_file;
 	const char *obj_filename;
 	size_t	 fptr, obj_size;
+	argv_t	*names;
+	argv_t	*dir_names;
+	intArray *dir_ptrs;
 
 	lib_filename = search_libfile(lib_filename);
 	if ( lib_filename == NULL )
@@ -49,6 +53,10 @@ void make_library(const char *lib_filename)
 	lib_file = xfopen( lib_filename, "wb" );	
 	xfwrite_cstr(Z80libhdr, lib_file);
 
+	names = argv_new();
+	dir_names = argv_new();
+	dir_ptrs = OBJ_NEW(intArray);
+
 	/* write each object file */
 	for (size_t i = 0; i < option_files_size(); i++)
 	{
@@ -61,7 +69,7 @@ void make_library(const char *lib_filename)
 		{
 			xfclose(lib_file);			/* error */
 			remove(lib_filename);
-			return;
+			goto cleanup;
 		}
 
 		/* write file pointer of next file, or -1 if last */
@@ -76,10 +84,35 @@ void make_library(const char *lib_filename)
 
 		/* write module */
 		xfwrite_bytes((char *)ByteArray_item(obj_file_data, 0), obj_size, lib_file);
+
+		/* collect global symbols for the directory */
+		argv_clear(names);
+		obj_module_global_names(ByteArray_item(obj_file_data, 0), (int)obj_size, names);
+		for (char **p = argv_front(names); p < argv_back(names); p++) {
+			argv_push(dir_names, *p);
+			*(intArray_push(dir_ptrs)) = (int)fptr;
+		}
 	}
 
+	/* write symbol directory after the last module, so that the linker does
+	   not need to scan every module to find the one defining a symbol:
+	   count, {module pointer, symbol name}..., pointer to count, signature */
+	fptr = ftell( lib_file );
+	xfwrite_dword((int)argv_len(dir_names), lib_file);
+	for (size_t i = 0; i < argv_len(dir_names); i++) {
+		xfwrite_dword(*(intArray_item(dir_ptrs, i)), lib_file);
+		xfwrite_wcount_cstr(argv_get(dir_names, i), lib_file);
+	}
+	xfwrite_dword((int)fptr, lib_file);
+	xfwrite_cstr(Z80libdir, lib_file);
+
 	/* close and write lib file */
 	xfclose( lib_file );
+
+cleanup:
+	argv_free(names);
+	argv_free(dir_names);
+	OBJ_DELETE(dir_ptrs);
 }
 
 bool check_library_file(const char *src_filename)
@@ -12,6 +12,7 @@
 #include "utstring.h"
 
 extern char Z80libhdr[];
+extern char Z80libdir[];				// signature of the symbol directory at end of library
 
 /* make library from source files; convert each source to object file name */
 extern void make_library(const char *lib_filename);
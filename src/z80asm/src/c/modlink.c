@@ -22,6 +22,7 @@ Repository: https://github.com/z88dk/z88dk
 #include "sym.h"
 #include "symtab1.h"
 #include "types.h"
+#include "uthash.h"
 #include "utstring.h"
 #include "z80asm.h"
 #include "zobjfile.h"
@@ -43,6 +44,21 @@ typedef struct obj_file_t {
 } obj_file_t;
 
 
+// library module that defines a global symbol, found via the library directory
+typedef struct lib_module_t {
+	obj_file_t*		lib;				// weak pointer to library
+	int				lib_order;			// position of library in the command line
+	int				pos;				// offset of module header inside library
+} lib_module_t;
+
+// extern symbol waiting to be resolved by a library module
+typedef struct pending_sym_t {
+	lib_module_t*	module;				// first library module that defines the symbol
+	const char*		name;				// symbol name (strpool)
+} pending_sym_t;
+
+static UT_icd ut_pending_sym_icd = { sizeof(pending_sym_t), NULL, NULL, NULL };
+
 /* local functions */
 static void link_lib_module(const char* modname, obj_file_t* obj, StrHash* extern_syms);
 static void merge_modules(StrHash* extern_syms);
@@ -58,10 +74,12 @@ int totaladdr, curroffset;
 
 static obj_file_t*	g_objects;				// list of objects to link
 static obj_file_t*	g_libraries;			// list of libraries to link
+static StrHash*		g_lib_symbols;			// global symbol -> first lib_module_t defining it
 
 static void dtor(void) {
 	obj_files_free(&g_objects);
 	obj_files_free(&g_libraries);
+	OBJ_DELETE(g_lib_symbols);
 }
 
 static void init(void) {
@@ -110,6 +128,14 @@ static const char* parse_wcount_str(obj_file_t* obj) {
 	return parse_str(obj, len);
 }
 
+static const byte_t* parse_wcount_bytes(obj_file_t* obj, int* plen) {
+	*plen = parse_word(obj);
+	xassert(obj->i + *plen <= obj->size);
+	const byte_t* ret = obj->data + obj->i;
+	obj->i += *plen;
+	return ret;
+}
+
 static bool goto_modname(obj_file_t* obj) {
 	obj->i = 8 + 0 * 4;
 	obj->i = parse_int(obj);
@@ -313,6 +339,12 @@ static void set_expr_env(Expr1* expr, bool module_relative_addr)
 
 static void read_cur_module_exprs(Expr1List* exprs, obj_file_t* obj) {
 	const char* last_filename = spool_add(obj->filename);
+	argv_t* names = argv_new();
+
+	// names referred to by the RPN code
+	int num_names = parse_word(obj);
+	for (int i = 0; i < num_names; i++)
+		argv_push(names, parse_wcount_str(obj));
 
 	while (true) {
 		int type = parse_byte(obj);
@@ -334,11 +366,25 @@ static void read_cur_module_exprs(Expr1List* exprs, obj_file_t* obj) {
 
 		const char* target_name = parse_wcount_str(obj);
 		const char* expr_text = parse_wcount_str(obj);
+		int code_size;
+		const byte_t* code = parse_wcount_bytes(obj, &code_size);
 
-		// call parser to interpret expression
+		// build expression from the RPN code; objects converted from older
+		// versions have only the text, call parser to interpret it
 		set_asmpc_env(CURRENTMODULE, section_name, expr_text, source_filename, line_num,
 			asmpc, false);
-		Expr1* expr = parse_expr(expr_text);
+		Expr1* expr;
+		if (code_size > 0) {
+			expr = Expr_rpn_decode(code, code_size, names);
+			if (expr)
+				Str_set(expr->text, expr_text);
+			else
+				error_not_obj_file(obj->filename);
+		}
+		else {
+			expr = parse_expr(expr_text);
+		}
+
 		if (expr) {
 			expr->range = 0;
 			switch (type) {
@@ -371,6 +417,8 @@ static void read_cur_module_exprs(Expr1List* exprs, obj_file_t* obj) {
 			Expr1List_push(&exprs, expr);
 		}
 	}
+
+	argv_free(names);
 }
 
 // read all the modules' expressions to the given list, or to the module's if NULL
@@ -390,110 +438,256 @@ static void read_module_exprs(Expr1List* exprs) {
 	clear_error_location();
 }
 
-/* compute equ expressions and remove them from the list
-   return >0: number of computed expressions
-   return 0 : nothing done, all EQU expression computed and removed from list
-   return <0: -(number of expressions with unresolved symbols)
-*/
-static int compute_equ_exprs_once(Expr1List* exprs, bool show_error, bool module_relative_addr)
+/*-----------------------------------------------------------------------------
+*   EQU expressions are computed in dependency order: each expression is
+*   evaluated once, after all the expressions that define the symbols it uses.
+*   Building and walking the graph is linear in the number of expressions and
+*   symbol references; each reference also costs a symbol table lookup, so the
+*   whole step is only linear while those lookups stay constant time
+*----------------------------------------------------------------------------*/
+
+// EQU expression, node of the dependency graph
+typedef struct equ_node_t {
+	Expr1*			expr;
+	Symbol1*		target;				// symbol defined by the expression
+	intArray*		deps;				// nodes defining symbols used by expr
+	intArray*		users;				// nodes using target
+	int				num_pending;		// deps not yet computed
+	int				visit;				// cycle search: 0 new, 1 in path, 2 done
+	bool			computed : 1;
+	bool			in_cycle : 1;
+} equ_node_t;
+
+static void ut_equ_node_init(void* elt) {
+	equ_node_t* node = (equ_node_t*)elt;
+	memset(node, 0, sizeof(*node));
+	node->deps = OBJ_NEW(intArray);
+	node->users = OBJ_NEW(intArray);
+}
+
+static void ut_equ_node_dtor(void* elt) {
+	equ_node_t* node = (equ_node_t*)elt;
+	OBJ_DELETE(node->deps);
+	OBJ_DELETE(node->users);
+}
+
+static UT_icd ut_equ_node_icd = { sizeof(equ_node_t), ut_equ_node_init, NULL, ut_equ_node_dtor };
+
+// symbol defined by an EQU expression -> node
+typedef struct equ_target_t {
+	Symbol1*		sym;
+	int				node;
+	UT_hash_handle	hh;
+} equ_target_t;
+
+static equ_node_t* equ_node(UT_array* nodes, int i) {
+	return (equ_node_t*)utarray_eltptr(nodes, i);
+}
+
+// create one node for each EQU expression that can be computed now, in list order
+static void equ_graph_nodes(UT_array* nodes, equ_target_t** targets, Expr1List* exprs,
+	bool module_relative_addr)
 {
-	Expr1ListElem* iter;
-	Expr1* expr, * expr2;
-	long value;
-	int  num_computed = 0;
-	int  num_unresolved = 0;
-	bool computed;
+	for (Expr1ListElem* iter = Expr1List_first(exprs); iter != NULL; iter = Expr1List_next(iter)) {
+		Expr1* expr = iter->obj;
+		if (!expr->target_name)
+			continue;
 
-	iter = Expr1List_first(exprs);
-	while (iter != NULL)
-	{
-		expr = iter->obj;
-		computed = false;
+		/* touch symbol so that it ends in object file */
+		Symbol1* sym = get_used_symbol(expr->target_name);
+		sym->is_touched = true;
 
-		if (expr->target_name)
-		{
-			/* touch symbol so that it ends in object file */
-			Symbol1* sym = get_used_symbol(expr->target_name);
-			sym->is_touched = true;
-
-			/* expressions with symbols from other sections need to be passed to the link phase */
-			if (!module_relative_addr || /* link phase */
-				(Expr_is_local_in_section(expr, CURRENTMODULE, CURRENTSECTION) &&	/* or symbols from other sections */
-					Expr_without_addresses(expr))		/* expression addressees - needs to be computed at link time */
-				)
-			{
-				set_expr_env(expr, module_relative_addr);
-				value = Expr_eval(expr, show_error);
-				if (expr->result.not_evaluable)		/* unresolved */
-				{
-					num_unresolved++;
-				}
-				else if (!expr->is_computed)
-				{
-					/* expression depends on other variables not yet computed */
-				}
-				else
-				{
-					num_computed++;
-					computed = true;
-					update_symbol(expr->target_name, value, expr->type);
-				}
-			}
+		/* expressions with symbols from other sections need to be passed to the link phase */
+		if (module_relative_addr &&		/* not link phase */
+			!(Expr_is_local_in_section(expr, CURRENTMODULE, CURRENTSECTION) &&	/* or symbols from other sections */
+				Expr_without_addresses(expr)))		/* expression addressees - needs to be computed at link time */
+			continue;
+
+		/* the target as seen from the module of the expression, as update_symbol() does */
+		set_expr_env(expr, module_relative_addr);
+		sym = get_used_symbol(expr->target_name);
+
+		utarray_extend_back(nodes);
+		equ_node_t* node = (equ_node_t*)utarray_back(nodes);
+		node->expr = expr;
+		node->target = sym;
+
+		equ_target_t* target;
+		HASH_FIND_PTR(*targets, &sym, target);
+		if (target == NULL) {				// first definition wins
+			target = xnew(equ_target_t);
+			target->sym = sym;
+			target->node = (int)utarray_len(nodes) - 1;
+			HASH_ADD_PTR(*targets, sym, target);
 		}
+	}
+}
 
-		/* continue loop - delete expression if computed */
-		if (computed)
-		{
-			/* remove current expression, advance iterator */
-			expr2 = Expr1List_remove(exprs, &iter);
-			xassert(expr == expr2);
+// link each node to the nodes that define the symbols it uses, whatever
+// their current type, so that a cycle through an extern is still a cycle
+static void equ_graph_edges(UT_array* nodes, equ_target_t* targets)
+{
+	for (int i = 0; i < (int)utarray_len(nodes); i++) {
+		equ_node_t* node = equ_node(nodes, i);
+		for (size_t j = 0; j < ExprOpArray_size(node->expr->rpn_ops); j++) {
+			ExprOp* op = ExprOpArray_item(node->expr->rpn_ops, j);
+			if (op->op_type != SYMBOL_OP)
+				continue;
+
+			equ_target_t* target;
+			HASH_FIND_PTR(targets, &op->d.symbol, target);
+			if (target == NULL)
+				continue;					// never computed, eval will fail
+
+			*intArray_push(node->deps) = target->node;
+			*intArray_push(equ_node(nodes, target->node)->users) = i;
+			node->num_pending++;
+		}
+	}
+}
+
+// evaluate nodes in topological order
+static void equ_graph_compute(UT_array* nodes, bool module_relative_addr)
+{
+	intArray* queue = OBJ_NEW(intArray);
 
-			OBJ_DELETE(expr);
+	for (int i = 0; i < (int)utarray_len(nodes); i++) {
+		if (equ_node(nodes, i)->num_pending == 0)
+			*intArray_push(queue) = i;
+	}
+
+	for (size_t head = 0; head < intArray_size(queue); head++) {
+		equ_node_t* node = equ_node(nodes, *intArray_item(queue, head));
+		Expr1* expr = node->expr;
+
+		set_expr_env(expr, module_relative_addr);
+		long value = Expr_eval(expr, false);
+		if (expr->result.not_evaluable || !expr->is_computed)
+			continue;						// unresolved, users stay pending
+
+		update_symbol(expr->target_name, value, expr->type);
+		node->computed = true;
+
+		for (size_t j = 0; j < intArray_size(node->users); j++) {
+			equ_node_t* user = equ_node(nodes, *intArray_item(node->users, j));
+			if (--user->num_pending == 0)
+				*intArray_push(queue) = (int)(user - equ_node(nodes, 0));
 		}
-		else
-			iter = Expr1List_next(iter);
 	}
 
-	if (num_computed > 0)
-		return num_computed;
-	else if (num_unresolved > 0)
-		return -num_unresolved;
-	else
-		return 0;
+	OBJ_DELETE(queue);
 }
 
-/* check if we have expressions still with target, i.e. circular definitions (see #1869) */
-static void check_equ_exprs_solved(Expr1List* exprs, bool module_relative_addr) {
-	if (module_relative_addr)			/* not linking */
-		return;
+// report one cycle found in the path, ending at node i
+static void equ_graph_report_cycle(UT_array* nodes, intArray* path, int i,
+	bool module_relative_addr)
+{
+	size_t start = intArray_size(path);
+	while (*intArray_item(path, start - 1) != i)
+		start--;
+	start--;
+
+	STR_DEFINE(names, STR_SIZE);
+	for (size_t j = start; j < intArray_size(path); j++) {
+		equ_node_t* node = equ_node(nodes, *intArray_item(path, j));
+		node->in_cycle = true;
+		Str_append_sprintf(names, "%s -> ", node->expr->target_name);
+	}
+	Str_append(names, equ_node(nodes, i)->expr->target_name);
+
+	set_expr_env(equ_node(nodes, i)->expr, module_relative_addr);
+	error_circular_definition(Str_data(names));
+
+	STR_DELETE(names);
+}
+
+// depth-first search of the not computed nodes, report cycles
+static void equ_graph_find_cycles(UT_array* nodes, int i, intArray* path,
+	bool module_relative_addr)
+{
+	equ_node_t* node = equ_node(nodes, i);
+	node->visit = 1;
+	*intArray_push(path) = i;
+
+	for (size_t j = 0; j < intArray_size(node->deps); j++) {
+		int dep = *intArray_item(node->deps, j);
+		equ_node_t* dep_node = equ_node(nodes, dep);
+		if (dep_node->computed)
+			continue;
+		if (dep_node->visit == 1)
+			equ_graph_report_cycle(nodes, path, dep, module_relative_addr);
+		else if (dep_node->visit == 0)
+			equ_graph_find_cycles(nodes, dep, path, module_relative_addr);
+	}
 
+	intArray_pop(path);
+	node->visit = 2;
+}
+
+/* compute all equ expressions, removing the computed ones from the list */
+void compute_equ_exprs(Expr1List* exprs, bool show_error, bool module_relative_addr)
+{
+	UT_array* nodes;
+	equ_target_t* targets = NULL, * target, * tmp;
+
+	utarray_new(nodes, &ut_equ_node_icd);
+	equ_graph_nodes(nodes, &targets, exprs, module_relative_addr);
+	equ_graph_edges(nodes, targets);
+	equ_graph_compute(nodes, module_relative_addr);
+
+	if (show_error) {
+		/* report cycles */
+		intArray* path = OBJ_NEW(intArray);
+		for (int i = 0; i < (int)utarray_len(nodes); i++) {
+			equ_node_t* node = equ_node(nodes, i);
+			if (!node->computed && node->visit == 0)
+				equ_graph_find_cycles(nodes, i, path, module_relative_addr);
+		}
+		OBJ_DELETE(path);
+
+		/* show errors of the unresolved expressions */
+		for (int i = 0; i < (int)utarray_len(nodes); i++) {
+			equ_node_t* node = equ_node(nodes, i);
+			if (!node->computed && !node->in_cycle) {
+				set_expr_env(node->expr, module_relative_addr);
+				Expr_eval(node->expr, true);
+			}
+		}
+	}
+
+	/* remove computed expressions, nodes are in list order;
+	   if linking, all EQU expressions must have been solved */
 	Expr1ListElem* iter = Expr1List_first(exprs);
+	int i = 0;
 	while (iter != NULL) {
 		Expr1* expr = iter->obj;
-		if (expr->target_name) {
+		equ_node_t* node = i < (int)utarray_len(nodes) ? equ_node(nodes, i) : NULL;
+		if (node && node->expr == expr) {
+			i++;
+			if (node->computed) {
+				Expr1* expr2 = Expr1List_remove(exprs, &iter);
+				xassert(expr == expr2);
+				OBJ_DELETE(expr);
+				continue;
+			}
+			if (node->in_cycle) {				/* already reported */
+				iter = Expr1List_next(iter);
+				continue;
+			}
+		}
+
+		if (expr->target_name && !module_relative_addr) {
 			set_expr_env(expr, module_relative_addr);
 			error_undefined_symbol(expr->target_name);
 		}
 		iter = Expr1List_next(iter);
 	}
-}
-
-/* compute all equ expressions, removing them from the list */
-void compute_equ_exprs(Expr1List* exprs, bool show_error, bool module_relative_addr)
-{
-	int  compute_result;
-
-	/* loop to solve dependencies while some are solved */
-	do {
-		compute_result = compute_equ_exprs_once(exprs, false, module_relative_addr);
-	} while (compute_result > 0);
-
-	/* if some unresolved, give up and show error */
-	if (show_error && compute_result < 0)
-		compute_equ_exprs_once(exprs, true, module_relative_addr);
 
-	/* if linking, check that we solved all EQU expressions */
-	check_equ_exprs_solved(exprs, module_relative_addr);
+	HASH_ITER(hh, targets, target, tmp) {
+		HASH_DEL(targets, target);
+		xfree(target);
+	}
+	utarray_free(nodes);
 }
 
 /* compute and patch expressions */
@@ -729,36 +923,12 @@ static void define_location_symbols(void)
 *   link used libraries
 *----------------------------------------------------------------------------*/
 
-// check if there are symbols not yet linked
-static bool pending_syms(StrHash* extern_syms) {
-	// delete defined symbols
-	StrHashElem* elem, * next;
-	for (elem = StrHash_first(extern_syms); elem != NULL; elem = next) {
-		next = StrHash_next(elem);
-		if (find_global_symbol(elem->key) != NULL) {		// symbol defined
-			StrHash_remove_elem(extern_syms, elem);
-		}
-	}
-
-	if (StrHash_empty(extern_syms))
-		return false;
-	else
-		return true;
-}
-
-// search one module for unresolved symbols and link if needed
-static bool linked_module(obj_file_t* obj, StrHash* extern_syms) {
-	bool linked = false;
-
-	// get module name
-	xassert(goto_modname(obj));
-	const char* modname = parse_wcount_str(obj);
-
-	// get defined names
+// push the names of all global symbols defined in the module
+static void parse_global_names(obj_file_t* obj, argv_t* names) {
 	if (goto_defined_names(obj)) {
-		while (!linked) {
+		while (true) {
 			int scope = parse_byte(obj);
-			if (scope == 0)	
+			if (scope == 0)
 				break;					// end of list
 			obj->i++;					// skip type
 			parse_wcount_str(obj);		// skip section name
@@ -767,55 +937,207 @@ static bool linked_module(obj_file_t* obj, StrHash* extern_syms) {
 			parse_wcount_str(obj);		// skip defined file name
 			obj->i += 4;				// skip line number
 
-			// link module if one defined symbol matches pending externals
-			if (scope == 'G' && StrHash_exists(extern_syms, symbol_name)) {
-				link_lib_module(modname, obj, extern_syms);
-				linked = true;
-			}
+			if (scope == 'G')
+				argv_push(names, symbol_name);
 		}
 	}
-	return linked;
 }
 
-// search chain of libraries for modules that resolve any of the pending symbols
-// break search after first found module, so that first all dependencies of this module
-// are linked in, before going to the next library module
-static bool linked_libraries(StrHash* extern_syms) {
-	// search library chain
-	bool linked = false;
-	// search all libraries
-	for (obj_file_t* lib = g_libraries; !linked && lib != NULL; lib = lib->next) {
-		// search all object modules inside each library
-		int next_pos = -1;
-		for (int pos = 8; !linked && pos > 0 && pos < lib->size; pos = next_pos) {
-			lib->i = pos;
-			next_pos = parse_int(lib);
-			int module_size = parse_int(lib);
-
-			if (module_size == 0)
-				continue;					// deleted module
-
-			// define an obj_file_t to link
-			obj_file_t obj;
-			obj.filename = lib->filename;
-			obj.data = lib->data + lib->i;
-			obj.size = module_size;
-			obj.i = 0;
-			if (linked_module(&obj, extern_syms))
-				linked = true;
+void obj_module_global_names(byte_t* data, int size, argv_t* names) {
+	obj_file_t obj = { 0 };
+	obj.data = data;
+	obj.size = size;
+	parse_global_names(&obj, names);
+}
+
+// point obj to the library module whose header is at pos
+static void lib_module_obj(obj_file_t* lib, int pos, obj_file_t* obj) {
+	lib->i = pos + 4;					// skip next pointer
+	int module_size = parse_int(lib);
+
+	memset(obj, 0, sizeof(*obj));
+	obj->filename = lib->filename;
+	obj->data = lib->data + lib->i;
+	obj->size = module_size;
+}
+
+// add symbol to the directory, unless already defined by a previous module
+static void add_lib_symbol(obj_file_t* lib, int lib_order, int pos, const char* name) {
+	if (!StrHash_exists(g_lib_symbols, name)) {
+		lib_module_t* module = xnew(lib_module_t);
+		module->lib = lib;
+		module->lib_order = lib_order;
+		module->pos = pos;
+		StrHash_set(&g_lib_symbols, name, module);
+	}
+}
+
+// load the symbol directory written by make_library(); return false if the
+// library has no directory
+static bool read_lib_directory(obj_file_t* lib, int lib_order) {
+	int sig_size = (int)strlen(Z80libdir);
+	int dir_ptr_pos = lib->size - sig_size - 4;
+	if (dir_ptr_pos < 8 ||
+		memcmp(lib->data + lib->size - sig_size, Z80libdir, sig_size) != 0)
+		return false;
+
+	lib->i = dir_ptr_pos;
+	lib->i = parse_int(lib);
+	if (lib->i < 8 || lib->i > dir_ptr_pos)
+		return false;
+
+	int count = parse_int(lib);
+	for (int n = 0; n < count; n++) {
+		int pos = parse_int(lib);
+		const char* name = parse_wcount_str(lib);
+		add_lib_symbol(lib, lib_order, pos, name);
+	}
+	return true;
+}
+
+// build the directory of a library without one by scanning all its modules once
+static void scan_lib_modules(obj_file_t* lib, int lib_order) {
+	argv_t* names = argv_new();
+	int next_pos = -1;
+	for (int pos = 8; pos > 0 && pos < lib->size; pos = next_pos) {
+		lib->i = pos;
+		next_pos = parse_int(lib);
+		int module_size = parse_int(lib);
+
+		if (module_size == 0)
+			continue;					// deleted module
+
+		obj_file_t obj;
+		lib_module_obj(lib, pos, &obj);
+
+		argv_clear(names);
+		parse_global_names(&obj, names);
+		for (char** p = argv_front(names); p < argv_back(names); p++)
+			add_lib_symbol(lib, lib_order, pos, *p);
+	}
+	argv_free(names);
+}
+
+// map each global symbol to the first library module that defines it,
+// searching libraries in the order given in the command line
+static void load_lib_directories(void) {
+	OBJ_DELETE(g_lib_symbols);
+	g_lib_symbols = OBJ_NEW(StrHash);
+	g_lib_symbols->free_data = free;
+
+	int lib_order = 0;
+	for (obj_file_t* lib = g_libraries; lib != NULL; lib = lib->next, lib_order++) {
+		if (!read_lib_directory(lib, lib_order))
+			scan_lib_modules(lib, lib_order);
+	}
+}
+
+// min-heap of pending symbols ordered by the position of the defining module,
+// so that modules are pulled in the same order as a linear search of the libraries
+static bool pending_sym_before(pending_sym_t* a, pending_sym_t* b) {
+	if (a->module->lib_order != b->module->lib_order)
+		return a->module->lib_order < b->module->lib_order;
+	else
+		return a->module->pos < b->module->pos;
+}
+
+static void pending_sym_push(UT_array* heap, lib_module_t* module, const char* name) {
+	pending_sym_t elem = { module, name };
+	utarray_push_back(heap, &elem);
+
+	size_t i = utarray_len(heap) - 1;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		pending_sym_t* pi = (pending_sym_t*)utarray_eltptr(heap, i);
+		pending_sym_t* pp = (pending_sym_t*)utarray_eltptr(heap, parent);
+		if (!pending_sym_before(pi, pp))
+			break;
+		pending_sym_t tmp = *pi; *pi = *pp; *pp = tmp;
+		i = parent;
+	}
+}
+
+static bool pending_sym_pop(UT_array* heap, pending_sym_t* out) {
+	size_t size = utarray_len(heap);
+	if (size == 0)
+		return false;
+
+	pending_sym_t* elems = (pending_sym_t*)utarray_front(heap);
+	*out = elems[0];
+	elems[0] = elems[size - 1];
+	utarray_pop_back(heap);
+	size--;
+
+	size_t i = 0;
+	while (true) {
+		size_t left = 2 * i + 1, right = left + 1, min = i;
+		if (left < size && pending_sym_before(&elems[left], &elems[min]))
+			min = left;
+		if (right < size && pending_sym_before(&elems[right], &elems[min]))
+			min = right;
+		if (min == i)
+			break;
+		pending_sym_t tmp = elems[i]; elems[i] = elems[min]; elems[min] = tmp;
+		i = min;
+	}
+	return true;
+}
+
+// queue an extern symbol the first time it is seen, if some library defines it
+static void queue_extern(UT_array* heap, StrHash* queued, const char* name) {
+	if (StrHash_exists(queued, name))
+		return;
+	StrHash_set(&queued, name, NULL);
+
+	if (find_global_symbol(name) != NULL)
+		return;							// already defined
+
+	lib_module_t* module = (lib_module_t*)StrHash_get(g_lib_symbols, name);
+	if (module != NULL)
+		pending_sym_push(heap, module, name);
+}
+
+// queue the extern symbols referenced by a module
+static void queue_module_externs(obj_file_t* obj, UT_array* heap, StrHash* queued) {
+	xassert(goto_modname(obj));
+	int end_external_names = obj->i;
+	if (goto_external_names(obj)) {
+		while (obj->i < end_external_names) {
+			const char* name = parse_wcount_str(obj);
+			queue_extern(heap, queued, name);
 		}
 	}
-	return linked;
 }
 
-// link libraries in the order given in the command line
+// link libraries in the order given in the command line: each time link the
+// first library module that defines any of the pending symbols, so that first all
+// dependencies of this module are linked in, before going to the next library module
 static void link_libraries(StrHash* extern_syms) {
-	// while symbols to resolve and new module pulled in
-	while (!get_num_errors() &&
-		pending_syms(extern_syms) &&
-		linked_libraries(extern_syms)) {
-		// loop
+	load_lib_directories();
+
+	StrHash* queued = OBJ_NEW(StrHash);
+	UT_array* heap;
+	utarray_new(heap, &ut_pending_sym_icd);
+
+	for (StrHashElem* elem = StrHash_first(extern_syms); elem != NULL; elem = StrHash_next(elem))
+		queue_extern(heap, queued, elem->key);
+
+	pending_sym_t next;
+	while (!get_num_errors() && pending_sym_pop(heap, &next)) {
+		if (find_global_symbol(next.name) != NULL)
+			continue;					// defined by a module linked meanwhile
+
+		obj_file_t obj;
+		lib_module_obj(next.module->lib, next.module->pos, &obj);
+		xassert(goto_modname(&obj));
+		const char* modname = parse_wcount_str(&obj);
+
+		link_lib_module(modname, &obj, extern_syms);
+		queue_module_externs(&obj, heap, queued);
 	}
+
+	utarray_free(heap);
+	OBJ_DELETE(queued);
 }
 
 /*-----------------------------------------------------------------------------
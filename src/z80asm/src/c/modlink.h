@@ -12,6 +12,7 @@ Repository: https://github.com/z88dk/z88dk
 #include "types.h"
 #include "expr1.h"
 #include "module1.h"
+#include "strutil.h"
 #include "utlist.h"
 
 // append a library from the command line to the list to be linked
@@ -20,6 +21,9 @@ void library_file_append(const char* filename);
 // append an object from the command line to the list to be linked
 bool object_file_append(const char* filename, Module1* module, bool reserve_space, bool no_errors);
 
+// push the names of all global symbols defined in the object module
+void obj_module_global_names(byte_t* data, int size, argv_t* names);
+
 void link_modules(void);
 void compute_equ_exprs(Expr1List *exprs, bool show_error, bool module_relative_addr);
 
@@ -91,50 +91,41 @@ struct Expr1 *parse_expr(const char *expr_text)
 	return expr;
 }
 
-/* push current expression */
-static void push_expr(ParseCtx *ctx)
+/* parse the expression from the tokens already scanned for the statement */
+static Expr1 *parse_expr_tokens(Sym *start, Sym *end)
 {
-	STR_DEFINE(expr_text, STR_SIZE);
 	Expr1 *expr;
-	Sym  *expr_p;
+	Sym save_sym = sym;
+	bool save_found_EOL = found_EOL;
+	int num_errors = get_num_errors();
 
-	/* build expression text - split constant prefixes from numbers and names */
-	Str_clear(expr_text);
-	bool last_was_prefix = false;
-	for (expr_p = ctx->expr_start; expr_p < ctx->p; expr_p++)
-	{
-		if (last_was_prefix && expr_p->tlen > 0 &&
-			(isalnum(*expr_p->tstart) || *expr_p->tstart == '"'))
-		{
-			Str_append_char(expr_text, ' ');
-			last_was_prefix = false;
-		}
+	scan_tokens(start, end);
+	GetSym();
+	expr = expr_parse();		/* may output error */
+	if (sym.tok != TK_END && num_errors == get_num_errors()) {
+		error_syntax();
+		OBJ_DELETE(expr);
+		expr = NULL;
+	}
+	scan_tokens(NULL, NULL);
 
-		Str_append_n(expr_text, expr_p->tstart, expr_p->tlen);
+	sym = save_sym;
+	found_EOL = save_found_EOL;
 
-		if (expr_p->tlen > 0)
-		{
-			switch (expr_p->tstart[expr_p->tlen - 1])
-			{
-			case '@':
-			case '%':
-			case '$':
-				last_was_prefix = true;
-				break;
-
-			default:
-				last_was_prefix = false;
-			}
-		}
-	}
-	
-	/* parse expression */
-	expr = parse_expr(Str_data(expr_text));
+	return expr;
+}
+
+/* push current expression */
+static void push_expr(ParseCtx *ctx)
+{
+	Expr1 *expr;
+
+	/* parse expression; the parser accepts only names, numbers, ASMPC, 
+	*  operators and parentheses, returned by the scanner as in operands */
+	expr = parse_expr_tokens(ctx->expr_start, ctx->p);
 
 	/* push the new expression, or NULL on error */
 	utarray_push_back(ctx->exprs, &expr);
-
-	STR_DELETE(expr_text);
 }
 
 /*-----------------------------------------------------------------------------
@@ -230,6 +221,7 @@ const char *autolabel(void)
 	static int n;
 	const char *ret;
 
+	module_depends_on_previous();		/* n continues from previous modules */
 	Str_sprintf(label, "__autolabel_%04d", ++n);
 	ret = spool_add(Str_data(label));
 
@@ -42,6 +42,9 @@ static char	*p, *pe, *eof_, *ts, *te;	/* Ragel state variables */
 static bool	expect_opcode;				/* true to return opcodes as tokens, 
 										*  false to return as names */
 
+static Sym	*tokens_p, *tokens_end;		/* tokens to return instead of scanning, 
+										*  see scan_tokens() */
+
 /* save scan status */
 typedef struct scan_state_t
 {
@@ -307,13 +310,12 @@ static bool fill_buffer( void )
 		else 
 		{
 			/* get next line from input source file */
-			char* line = sfile_get_source_line();
+			const char* line = sfile_get_source_line();
 			if ( line == NULL )
 				return false;
 
 			/* got new line */
 			set_scan_buf( line, true );		/* read from file - at BOL */
-			xfree(line);
 		}
 	}
 
@@ -329,6 +331,14 @@ tokid_t GetSym( void )
 
 	init_sym();
 
+	/* return tokens already scanned */
+	if ( tokens_p != NULL )
+	{
+		if ( tokens_p < tokens_end )
+			sym = *tokens_p++;
+		return sym.tok;
+	}
+
 	/* keep returning TK_NEWLINE until found_EOL is cleared 
 	*  NOTE: HACK for inconsistent parser in handling newlines, should be removed */
 	if ( found_EOL )
@@ -381,6 +391,17 @@ void CurSymExpect(tokid_t expected_tok)
 }
 
 
+/*-----------------------------------------------------------------------------
+*   Return the given tokens from GetSym() followed by TK_END, instead of 
+*	scanning the input; scan_tokens(NULL, NULL) returns to the input
+*----------------------------------------------------------------------------*/
+void scan_tokens(Sym *start, Sym *end)
+{
+	init_module();
+	tokens_p = start;
+	tokens_end = end;
+}
+
 /*-----------------------------------------------------------------------------
 *   Insert the given text at the current scan position
 *----------------------------------------------------------------------------*/
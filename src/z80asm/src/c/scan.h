@@ -51,6 +51,9 @@ extern void drop_scan_state(void);
 extern void CurSymExpect(tokid_t expected_tok);
 extern void GetSymExpect(tokid_t expected_tok);
 
+/* return the given tokens from GetSym() instead of scanning the input */
+extern void scan_tokens(Sym *start, Sym *end);
+
 /* insert the given text at the current scan position */
 extern void SetTemporaryLine(const char *line );
 
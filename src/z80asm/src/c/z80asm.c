@@ -23,6 +23,10 @@ Repository: https://github.com/z88dk/z88dk
 #include "utstring.h"
 #include "zobjfile.h"
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 /* external functions */
 void Z80pass2(int start_errors);
@@ -34,20 +38,32 @@ size_t sizeof_reloctable = 0;
 
 char *reloctable = NULL, *relocptr = NULL;
 
+static bool depends_on_previous = false;	/* module cannot be assembled by a -j job */
+
 /* local functions */
+static void assemble_or_load_file(const char* filename, bool date_stamp, bool obj_ready);
 static void do_assemble(const char *src_filename );
 
+static bool is_obj_filename(const char* filename) {
+	return strcmp(filename + strlen(filename) - strlen(EXT_O), EXT_O) == 0;
+}
+
 /*-----------------------------------------------------------------------------
 *   Assemble one source file or link one object file
 *----------------------------------------------------------------------------*/
 void assemble_file( const char *filename ) {
+	assemble_or_load_file(filename, option_date_stamp(), false);
+}
+
+// obj_ready: the source was already assembled by a -j job, load its object file
+static void assemble_or_load_file(const char* filename, bool date_stamp, bool obj_ready) {
 	const char* src_filename;
 	const char* obj_filename;
 
 	set_error_location(filename, 0);
 
 	// check if we got a source or object file
-	bool got_obj = strcmp(filename + strlen(filename) - strlen(EXT_O), EXT_O) == 0;
+	bool got_obj = is_obj_filename(filename);
 	if (got_obj) {
 		src_filename = get_asm_filename(filename);
 		obj_filename = spool_add(filename);
@@ -55,6 +71,17 @@ void assemble_file( const char *filename ) {
 	else {
 		src_filename = spool_add(filename);
 		obj_filename = get_o_filename(filename);
+
+		// append the directoy of the file being assembled to the include path 
+		// and remove it at function end, -d compares the include path too
+		push_includes(path_parent_dir(src_filename));
+
+		// -d: use the object file if the source, the files it reads and the options did not change
+		if (obj_ready ||
+			(date_stamp &&
+			 path_file_exists(obj_filename) && check_object_file_no_errors(obj_filename) &&
+			 depend_up_to_date(get_hash_filename(filename), src_filename, obj_filename)))
+			got_obj = true;
 	}
 
 	// create output directory
@@ -74,19 +101,16 @@ void assemble_file( const char *filename ) {
 		object_file_append(obj_filename, CURRENTMODULE, true, false);
 	}
 	else {
-		// append the directoy of the file being assembled to the include path 
-		// and remove it at function end 
-		push_includes(path_parent_dir(src_filename));
-		{
-			// normal case - assemble a asm source file 
-			list_set(option_list_file());		// initial LSTON status
-			do_assemble(src_filename);
-			list_set(false);
-		}
-		// finished assembly, remove dirname from include path
-		pop_includes();
+		// normal case - assemble a asm source file 
+		list_set(option_list_file());		// initial LSTON status
+		do_assemble(src_filename);
+		list_set(false);
 	}
 
+	// finished assembly, remove dirname from include path
+	if (!is_obj_filename(filename))
+		pop_includes();
+
 	clear_error_location();
 }
 
@@ -101,6 +125,9 @@ static void do_assemble(const char *src_filename )
 	/* initialize local symtab with copy of static one (-D defines) */
 	copy_static_syms();
 
+	/* collect files read for -d */
+	depend_clear();
+
 	/* Init ASMPC */
 	set_PC(0);
 
@@ -116,8 +143,12 @@ static void do_assemble(const char *src_filename )
 	list_close();
 
 	/* remove incomplete object file */
-	if (start_errors != get_num_errors())
+	if (start_errors != get_num_errors()) {
 		remove(get_o_filename(src_filename));
+		remove(get_hash_filename(src_filename));
+	}
+	else if (option_date_stamp())
+		depend_write(get_hash_filename(src_filename));
 
 	remove_all_local_syms();
 	remove_all_global_syms();
@@ -127,13 +158,132 @@ static void do_assemble(const char *src_filename )
 		putchar('\n');    /* separate module texts */
 }
 
+/*-----------------------------------------------------------------------------
+*	-j: assemble source files in child processes
+*	Up to option_jobs() children assemble the next source files while the
+*	parent loads the object files in command line order, so that the modules,
+*	the output and the messages are the same as in a serial run. A child that
+*	writes to stderr has its output discarded and the file is assembled again
+*	by the parent, to report errors and warnings in the right order. So is a
+*	file that uses state left by the previous modules.
+*	Only used when each module starts with a new code area, i.e. not when
+*	linking with -b or -o.
+*----------------------------------------------------------------------------*/
+void module_depends_on_previous() {
+	depends_on_previous = true;
+}
+
+#ifdef _WIN32
+static void assemble_files_in_parallel() {
+	for (size_t i = 0; i < option_files_size(); i++)
+		assemble_file(option_file(i));
+}
+#else
+typedef struct Job {
+	pid_t	pid;				// 0 if file is assembled by the parent
+	FILE*	out;				// stdout of child
+	FILE*	err;				// stderr of child
+} Job;
+
+static void start_job(Job* job, const char* filename) {
+	job->out = tmpfile();
+	job->err = tmpfile();
+	if (job->out == NULL || job->err == NULL) {
+		if (job->out) fclose(job->out);
+		if (job->err) fclose(job->err);
+		job->out = job->err = NULL;
+		return;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid == 0) {
+		int start_errors = get_num_errors();
+		dup2(fileno(job->out), STDOUT_FILENO);
+		dup2(fileno(job->err), STDERR_FILENO);
+		depends_on_previous = false;
+		assemble_file(filename);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(start_errors == get_num_errors() && !depends_on_previous ?
+			EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	else if (pid > 0) {
+		job->pid = pid;
+	}
+	else {
+		fclose(job->out);
+		fclose(job->err);
+		job->out = job->err = NULL;
+	}
+}
+
+// wait for job to finish, return true if the object file can be used
+static bool finish_job(Job* job) {
+	int status = 0;
+	bool ok = waitpid(job->pid, &status, 0) == job->pid &&
+		WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS &&
+		ftell(job->err) == 0;
+
+	if (ok) {
+		rewind(job->out);
+		char buffer[0x1000];
+		size_t size;
+		while ((size = fread(buffer, 1, sizeof(buffer), job->out)) > 0)
+			fwrite(buffer, 1, size, stdout);
+	}
+
+	fclose(job->out);
+	fclose(job->err);
+	job->pid = 0;
+	job->out = job->err = NULL;
+	return ok;
+}
+
+static void assemble_files_in_parallel() {
+	size_t num_files = option_files_size();
+	Job* jobs = m_calloc(num_files, sizeof(Job));
+	size_t next = 0;				// next file to start
+	int running = 0;
+
+	for (size_t i = 0; i < num_files; i++) {
+		for (; next < num_files && running < option_jobs(); next++) {
+			if (!is_obj_filename(option_file(next))) {
+				start_job(&jobs[next], option_file(next));
+				if (jobs[next].pid)
+					running++;
+			}
+		}
+
+		if (jobs[i].pid) {
+			running--;
+			if (finish_job(&jobs[i]))
+				assemble_or_load_file(option_file(i), false, true);
+			else
+				assemble_or_load_file(option_file(i), false, false);
+		}
+		else {
+			assemble_file(option_file(i));
+		}
+	}
+
+	m_free(jobs);
+}
+#endif
+
 /***************************************************************************************************
  * Main entry of Z80asm
  ***************************************************************************************************/
 int z80asm_main() {
 	if (!get_num_errors()) {
-		for (size_t i = 0; i < option_files_size(); i++)
-			assemble_file(option_file(i));
+		if (option_jobs() > 1 && option_files_size() > 1 &&
+			!(option_make_bin() || option_bin_file()))
+			assemble_files_in_parallel();
+		else {
+			for (size_t i = 0; i < option_files_size(); i++)
+				assemble_file(option_file(i));
+		}
 	}
 
 	/* Create output file */
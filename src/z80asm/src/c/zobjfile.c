@@ -40,12 +40,33 @@ static long write_expr(FILE* fp)
 	char range;
 	const char* target_name;
 	long expr_ptr;
+	UT_string* code;						/* RPN code of all expressions */
+	intArray* code_start;					/* start of each expression in code */
+	StrHash* name_index = NULL;				/* name -> index in names + 1 */
+	argv_t* names;							/* names referred to by the RPN code */
+	int i;
 
 	if (Expr1List_empty(CURRENTMODULE->exprs))	/* no expressions */
 		return -1;
 
-	expr_ptr = ftell(fp);
+	/* encode all expressions first, the name table goes before them */
+	utstring_new(code);
+	names = argv_new();
+	code_start = OBJ_NEW(intArray);
 	for (iter = Expr1List_first(CURRENTMODULE->exprs); iter != NULL; iter = Expr1List_next(iter))
+	{
+		*intArray_push(code_start) = (int)utstring_len(code);
+		Expr_rpn_encode(iter->obj, code, &name_index, names);
+	}
+	*intArray_push(code_start) = (int)utstring_len(code);
+
+	expr_ptr = ftell(fp);
+
+	xfwrite_word((int)argv_len(names), fp);			/* name table */
+	for (char** p = argv_front(names); p < argv_back(names); p++)
+		xfwrite_wcount_cstr(*p, fp);
+
+	for (iter = Expr1List_first(CURRENTMODULE->exprs), i = 0; iter != NULL; iter = Expr1List_next(iter), i++)
 	{
 		expr = iter->obj;
 
@@ -93,12 +114,20 @@ static long write_expr(FILE* fp)
 		xfwrite_word(expr->asmpc, fp);					/* ASMPC */
 		xfwrite_word(expr->code_pos, fp);				/* patchptr */
 		xfwrite_wcount_cstr(target_name, fp);			/* target symbol for expression */
-		xfwrite_wcount_cstr(Str_data(expr->text), fp);	/* expression */
+		xfwrite_wcount_cstr(Str_data(expr->text), fp);	/* expression text, for messages */
+
+		int start = *intArray_item(code_start, i);		/* expression RPN code */
+		int end = *intArray_item(code_start, i + 1);
+		xfwrite_wcount_bytes(utstring_body(code) + start, end - start, fp);
 	}
 
 	xfwrite_byte(0, fp);								/* terminator */
 
 	STR_DELETE(last_sourcefile);
+	utstring_free(code);
+	argv_free(names);
+	OBJ_DELETE(code_start);
+	OBJ_DELETE(name_index);
 
 	return expr_ptr;
 }
@@ -19,7 +19,7 @@ Handle object file contruction, reading and writing
 #include <stdio.h>
 #include <stdlib.h>
 
-#define OBJ_VERSION	"16"
+#define OBJ_VERSION	"17"
 
 /*-----------------------------------------------------------------------------
 *   Write current module to object file - object file name is computed
@@ -161,6 +161,10 @@ string Args::def_filename(const string& filename) {
 	return prepend_output_dir(replace_ext(filename, EXT_DEF));
 }
 
+string Args::hash_filename(const string& filename) {
+	return prepend_output_dir(replace_ext(filename, EXT_HASH));
+}
+
 // see https://github.com/z88dk/z88dk/issues/2049
 // No fix, to avoid breaking too many things:
 // -oFILE generates single binary FILE
@@ -280,6 +284,8 @@ bool Args::parse_opt_int(int& value, const string& opt_arg) {
 }
 
 void Args::parse_define(const string& opt_arg) {
+	m_defines.push_back(opt_arg);
+
 	// check if we have the "=nnn" optional part
 	size_t equal_pos = opt_arg.find('=');
 
@@ -344,6 +350,7 @@ string Args::expand_env_vars(string text) {
 }
 
 void Args::set_float_format(const string& format) {
+	m_float_format = format;
 	if (!g_float_format.set_text(format))
 		g_errors.error(ErrCode::InvalidFloatFormat, FloatFormat::get_formats());
 }
@@ -520,27 +527,15 @@ bool Args::check_source(const string& filename, string& out_filename) {
 		check_object_file_no_errors(obj_file.generic_string().c_str());
 
 	// if both .o and .asm exist and .o is valid, return .asm
-	// or .o if -d and .o is newer
+	// or .o if given and no -d; with -d the .asm is only assembled 
+	// if it or the files it depends on changed, see assemble_file()
 	// NOTE: -d must come before the file to have effect
 	if (src_ok && obj_ok) {
-		if (!m_date_stamp) {
-			// no -d
-			if (got_obj)
-				out_filename = obj_file.generic_string();
-			else
-				out_filename = src_file.generic_string();
-			return true;
-		}
-		else if (fs::last_write_time(obj_file) >= fs::last_write_time(src_file)) {
-			// -d and .o is up-to-date
+		if (got_obj && !m_date_stamp)
 			out_filename = obj_file.generic_string();
-			return true;
-		}
-		else {
-			// -d and .o is old
+		else
 			out_filename = src_file.generic_string();
-			return true;
-		}
+		return true;
 	}
 	else if (src_ok) {
 		out_filename = src_file.generic_string();
@@ -714,6 +709,14 @@ void Args::set_filler(const string& opt_arg) {
 		m_filler = value;
 }
 
+void Args::set_jobs(const string& opt_arg) {
+	int value = 0;
+	if (!parse_opt_int(value, opt_arg) || value < 1)
+		g_errors.error(ErrCode::InvalidJobsOption, opt_arg);
+	else
+		m_jobs = value;
+}
+
 void Args::pre_parsing_actions() {
 	parse_env_vars();
 }
@@ -820,6 +823,23 @@ bool Args::check_library(const fs::path& file_path) {
 	}
 }
 
+string Args::signature() const {
+	ostringstream ss;
+	ss << Z88DK_VERSION << "\n"
+		<< m_cpu_name << "\n"
+		<< m_swap_ixiy << m_ucase << m_ti83 << m_ti83plus
+		<< m_opt_speed << m_debug << "\n"
+		<< m_filler << "\n"
+		<< m_float_format << "\n";
+	for (auto& define : m_defines)
+		ss << define << "\n";
+	for (auto& dir : m_include_path)
+		ss << "-I" << dir << "\n";
+	for (auto& dir : m_library_path)
+		ss << "-L" << dir << "\n";
+	return ss.str();
+}
+
 void Args::define_assembly_defines() {
 	switch (m_cpu) {
 	case CPU_Z80:
@@ -953,6 +973,10 @@ bool option_date_stamp() {
 	return g_args.date_stamp();
 }
 
+int option_jobs() {
+	return g_args.jobs();
+}
+
 bool option_relocatable() {
 	return g_args.relocatable();
 }
@@ -1042,6 +1066,10 @@ const char* get_def_filename(const char* filename) {
 	return spool_add(g_args.def_filename(filename).c_str());
 }
 
+const char* get_hash_filename(const char* filename) {
+	return spool_add(g_args.hash_filename(filename).c_str());
+}
+
 const char* get_bin_filename(const char* filename, const char* section) {
 	return spool_add(g_args.bin_filename(filename, section).c_str());
 }
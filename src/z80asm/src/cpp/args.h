@@ -31,6 +31,7 @@ public:
 	const string& output_dir() const { return m_output_dir; }
 	bool split_bin() const { return m_split_bin; }
 	bool date_stamp() const { return m_date_stamp; }
+	int jobs() const { return m_jobs; }
 	bool relocatable() const { return m_relocatable; }
 	bool reloc_info() const { return m_reloc_info; }
 	int filler() const { return m_filler; }
@@ -45,6 +46,7 @@ public:
 	int appmake() const { return m_appmake; }
 	const vector<string>& include_path() { return m_include_path; }
 	const vector<string>& files() { return m_files; }
+	string signature() const;			// version and options that change the object file
 
 	void push_include_path(const string& dir) { push_path(m_include_path, dir); }
 	void pop_include_path() { pop_path(m_include_path); }
@@ -64,6 +66,7 @@ public:
 	string sym_filename(const string& filename);
 	string map_filename(const string& filename);
 	string reloc_filename(const string& bin_filename);
+	string hash_filename(const string& filename);
 
 private:
 	// options
@@ -82,6 +85,7 @@ private:
 	bool			m_make_bin{ false };		// -b option
 	bool			m_split_bin{ false };		// -split-bin option
 	bool			m_date_stamp{ false };		// -d option
+	int				m_jobs{ 4 };				// -j option
 	bool			m_relocatable{ false };		// -R option
 	bool			m_reloc_info{ false };		// -reloc-info option
 	int				m_filler{ 0 };				// -f option
@@ -93,6 +97,8 @@ private:
 	int				m_appmake{ APPMAKE_NONE };	// +zx or +zx81 options
 	vector<string>	m_include_path;				// -I option
 	vector<string>	m_library_path;				// -L option
+	vector<string>	m_defines;					// -D option
+	string			m_float_format;				// -float option
 	vector<string>	m_files;					// command line files
 
 	// parsing
@@ -119,6 +125,7 @@ private:
 
 	void set_cpu(const string& name);
 	void set_filler(const string& opt_arg);
+	void set_jobs(const string& opt_arg);
 
 	static void exit_help();
 	static void exit_copyright();
@@ -126,10 +133,10 @@ private:
 								string& opt_arg);
 
 	static bool parse_opt_int(int& value, const string& opt_arg);
-	static void parse_define(const string& opt_arg);
+	void parse_define(const string& opt_arg);
 	static string unquote(string text);
 	static string expand_env_vars(string text);
-	static void set_float_format(const string& format);
+	void set_float_format(const string& format);
 	static void set_origin(const string& opt_arg);
 
 	// filenames
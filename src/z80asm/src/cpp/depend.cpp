@@ -0,0 +1,130 @@
+//-----------------------------------------------------------------------------
+// z80asm
+// files and options an object file depends on, used by -d
+// Copyright (C) Paulo Custodio, 2011-2022
+// License: The Artistic License 2.0, http://www.perlfoundation.org/artistic_license_2_0
+//-----------------------------------------------------------------------------
+
+#include "args.h"
+#include "depend.h"
+#include "errors.h"
+#include "if.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+using namespace std;
+
+Depend g_depend;
+
+/*-----------------------------------------------------------------------------
+Hash file format:
+signature HHHHHHHHHHHHHHHH		hash of z80asm version and options
+HHHHHHHHHHHHHHHH filename		hash of each file read, first is the source
+//---------------------------------------------------------------------------*/
+static const char* SignatureTag = "signature";
+
+// FNV-1a, 64 bits
+static const uint64_t FnvOffset = 0xcbf29ce484222325ULL;
+static const uint64_t FnvPrime = 0x100000001b3ULL;
+
+static uint64_t hash_bytes(const char* bytes, size_t size, uint64_t hash = FnvOffset) {
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= FnvPrime;
+	}
+	return hash;
+}
+
+static string hash_to_hex(uint64_t hash) {
+	ostringstream ss;
+	ss << setfill('0') << setw(16) << hex << hash;
+	return ss.str();
+}
+
+// hash of the file contents, empty if the file cannot be read
+static string hash_file(const string& filename) {
+	ifstream ifs(filename, ios::binary);
+	if (!ifs.is_open())
+		return "";
+
+	uint64_t hash = FnvOffset;
+	char buffer[0x4000];
+	while (ifs.read(buffer, sizeof(buffer)) || ifs.gcount() > 0)
+		hash = hash_bytes(buffer, static_cast<size_t>(ifs.gcount()), hash);
+	return hash_to_hex(hash);
+}
+
+void Depend::add_file(const string& filename) {
+	if (find(m_files.begin(), m_files.end(), filename) == m_files.end())
+		m_files.push_back(filename);
+}
+
+bool Depend::up_to_date(const string& hash_filename, const string& src_filename,
+	const string& obj_filename) const {
+	if (!fs::exists(hash_filename)) {
+		error_code ec1, ec2;
+		auto src_time = fs::last_write_time(src_filename, ec1);
+		auto obj_time = fs::last_write_time(obj_filename, ec2);
+		return !ec1 && !ec2 && obj_time >= src_time;
+	}
+
+	ifstream ifs(hash_filename, ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	string line;
+	if (!safe_getline(ifs, line) || line != signature_line())
+		return false;
+
+	bool got_files = false;
+	while (safe_getline(ifs, line) && !ifs.eof()) {
+		size_t space = line.find(' ');
+		if (space == string::npos)
+			return false;
+		string hash = hash_file(line.substr(space + 1));
+		if (hash.empty() || hash != line.substr(0, space))
+			return false;
+		got_files = true;
+	}
+	return got_files;
+}
+
+void Depend::write(const string& hash_filename) const {
+	ofstream ofs(hash_filename, ios::binary);
+	if (!ofs.is_open()) {
+		g_errors.error(ErrCode::FileOpen, hash_filename);
+		return;
+	}
+
+	ofs << signature_line() << "\n";
+	for (auto& filename : m_files) {
+		string hash = hash_file(filename);
+		if (!hash.empty())
+			ofs << hash << " " << filename << "\n";
+	}
+}
+
+string Depend::signature_line() {
+	string signature = g_args.signature();
+	return string(SignatureTag) + " " +
+		hash_to_hex(hash_bytes(signature.c_str(), signature.size()));
+}
+
+//-----------------------------------------------------------------------------
+// C interface
+//-----------------------------------------------------------------------------
+void depend_clear() {
+	g_depend.clear();
+}
+
+bool depend_up_to_date(const char* hash_filename, const char* src_filename,
+	const char* obj_filename) {
+	return g_depend.up_to_date(hash_filename, src_filename, obj_filename);
+}
+
+void depend_write(const char* hash_filename) {
+	g_depend.write(hash_filename);
+}
@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// z80asm
+// files and options an object file depends on, used by -d
+// Copyright (C) Paulo Custodio, 2011-2022
+// License: The Artistic License 2.0, http://www.perlfoundation.org/artistic_license_2_0
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// Collects the source, INCLUDE and BINARY files read while assembling a
+// module. With -d a hash file is written next to the object file with the
+// hash of the options and of the contents of each file; the object file is
+// up to date while all hashes match. An object file without hash file, e.g.
+// assembled without -d, is up to date while it is not older than the source.
+class Depend {
+public:
+	void clear() { m_files.clear(); }
+	void add_file(const string& filename);
+	bool up_to_date(const string& hash_filename, const string& src_filename,
+		const string& obj_filename) const;
+	void write(const string& hash_filename) const;
+
+private:
+	vector<string>	m_files;			// files read, in order
+
+	static string signature_line();
+};
+
+extern Depend g_depend;
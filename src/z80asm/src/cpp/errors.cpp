@@ -249,6 +249,10 @@ void error_undefined_symbol(const char* name) {
 	g_errors.error(ErrCode::UndefinedSymbol, name);
 }
 
+void error_circular_definition(const char* names) {
+	g_errors.error(ErrCode::CircularDefinition, names);
+}
+
 void error_illegal_ident() {
 	g_errors.error(ErrCode::IllegalIdent);
 }
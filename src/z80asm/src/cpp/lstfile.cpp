@@ -40,6 +40,7 @@ void LstFile::open(const string& filename) {
 			m_asmpc = 0;
 			m_phased_pc = 0;
 			m_bytes.clear();
+			m_binary_size = 0;
 			m_text.clear();
 			m_last_filename.clear();
 		}
@@ -62,6 +63,7 @@ void LstFile::source_line(Location location, int asmpc, int phased_pc, const str
 		m_asmpc = asmpc;
 		m_phased_pc = phased_pc;
 		m_bytes.clear();
+		m_binary_size = 0;
 		m_text = text;
 	}
 }
@@ -75,6 +77,7 @@ void LstFile::expanded_line(int asmpc, int phased_pc, const string& text) {
 		m_asmpc = asmpc;
 		m_phased_pc = phased_pc;
 		m_bytes.clear();
+		m_binary_size = 0;
 		m_text = text;
 	}
 }
@@ -86,6 +89,17 @@ void LstFile::append_bytes(const vector<uint8_t>& bytes) {
 	}
 }
 
+// list only the first row of a binary block and its size
+void LstFile::append_binary(const uint8_t* bytes, int num_bytes) {
+	if (m_ofs.is_open()) {
+		int row_size = BytesWidth / 2;
+		for (int i = 0; i < num_bytes && i < row_size; i++)
+			m_bytes.push_back(bytes[i]);
+		if (num_bytes > row_size)
+			m_binary_size = num_bytes;
+	}
+}
+
 void LstFile::patch_bytes(int asmpc, const vector<uint8_t>& bytes) {
 	if (m_ofs.is_open()) {
 		out_line();									// output any pending bytes
@@ -160,8 +174,17 @@ void LstFile::out_line() {
 			m_ofs << setw(SeparatorWidth) << "";
 			m_ofs << endl;
 		}
+
+		// output size of binary block
+		if (m_binary_size > 0) {
+			m_ofs << setw(LineNumWidth + SeparatorWidth + AddressWidth + SeparatorWidth) << ""
+				<< setw(BytesWidth) << left << "..." << right
+				<< setw(SeparatorWidth) << ""
+				<< "; " << m_binary_size << " bytes" << endl;
+		}
 	}
 	m_line_started = false;
+	m_binary_size = 0;
 }
 
 void LstFile::out_bytes(int row) {
@@ -216,6 +239,10 @@ void list_append_bytes(int value, int num_bytes) {
 	g_list_file.append_bytes(bytes);
 }
 
+void list_append_binary(const unsigned char* bytes, int num_bytes) {
+	g_list_file.append_binary(bytes, num_bytes);
+}
+
 void list_patch_bytes(int asmpc, int value, int num_bytes) {
 	if (asmpc >= 0) {
 		vector<uint8_t> bytes;
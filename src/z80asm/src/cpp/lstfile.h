@@ -24,6 +24,7 @@ public:
 	void source_line(Location location, int asmpc, int phased_pc, const string& text);
 	void expanded_line(int asmpc, int phased_pc, const string& text);
 	void append_bytes(const vector<uint8_t>& bytes);
+	void append_binary(const uint8_t* bytes, int num_bytes);
 	void patch_bytes(int asmpc, const vector<uint8_t>& bytes);
 	void end_line();
 	void set_list_on(bool f = true) { m_list_on = f; }
@@ -37,6 +38,7 @@ private:
 	int			m_asmpc;			// address of patch bytes
 	int			m_phased_pc;		// address output to list file
 	vector<uint8_t> m_bytes;		// bytes collected in this line
+	int			m_binary_size;		// size of binary block, only first row listed
 	string		m_text;				// line text
 	string		m_last_filename;	// last filename output
 	bool		m_list_on{ false };
@@ -6,6 +6,7 @@
 //-----------------------------------------------------------------------------
 
 #include "args.h"
+#include "depend.h"
 #include "float.h"
 #include "if.h"
 #include "lex.h"
@@ -24,20 +25,17 @@ Preproc g_preproc;
 
 //-----------------------------------------------------------------------------
 
-static string concat(const string& s1, const string& s2) {
-	if (s1.empty() || s2.empty())
-		return s1 + s2;
-	else if (str_ends_with(s1, "##"))   // cpp-style concatenation
-		return s1.substr(0, s1.length() - 2) + s2;
-	else if (isspace(s1.back()) || isspace(s2.front()))
-		return s1 + s2;
+// true if s1 followed by s2 would be scanned as one token
+static bool need_space(const string& s1, const string& s2) {
+	if (isspace(s1.back()) || isspace(s2.front()))
+		return false;
 	else if (isident(s1.back()) && isident(s2.front()))
-		return s1 + " " + s2;
+		return true;
 	else if (s1.back() == '$' && isxdigit(s2.front()))
-		return s1 + " " + s2;
+		return true;
 	else if ((s1.back() == '%' || s1.back() == '@') &&
 		(isdigit(s2.front()) || s2.front() == '"'))
-		return s1 + " " + s2;
+		return true;
 	else if ((s1.back() == '&' && s2.front() == '&') ||
 		(s1.back() == '|' && s2.front() == '|') ||
 		(s1.back() == '^' && s2.front() == '^') ||
@@ -47,13 +45,25 @@ static string concat(const string& s1, const string& s2) {
 		(s1.back() == '=' && s2.front() == '=') ||
 		(s1.back() == '!' && s2.front() == '=') ||
 		(s1.back() == '#' && s2.front() == '#'))
-		return s1 + " " + s2;
+		return true;
 	else
-		return s1 + s2;
+		return false;
+}
+
+// append s2 to s1 in place
+static void concat(string& s1, const string& s2) {
+	if (!s1.empty() && !s2.empty()) {
+		if (str_ends_with(s1, "##"))	// cpp-style concatenation
+			s1.resize(s1.length() - 2);
+		else if (need_space(s1, s2))
+			s1.push_back(' ');
+	}
+	s1 += s2;
 }
 
 static int next_id() {
 	static int id = 0;
+	module_depends_on_previous();			// id continues from previous modules
 	return ++id;
 }
 
@@ -149,11 +159,16 @@ bool PreprocFile::get_source_line(string& line) {
 //-----------------------------------------------------------------------------
 
 void ExpandedText::append(const string& str) {
-	m_text = concat(m_text, str);
+	concat(m_text, str);
 }
 
 //-----------------------------------------------------------------------------
 
+PreprocOutput::PreprocOutput(const string& text_, const string& binary_file_)
+	: text(text_), binary_file(binary_file_) {}
+
+//-----------------------------------------------------------------------------
+
 IfNest::IfNest(Keyword keyword, Location location, bool flag)
 	: keyword(keyword), location(location), flag(flag), done_if(false) {}
 
@@ -185,6 +200,7 @@ bool Preproc::open(const string& filename_, bool search_include_path) {
 		return false;
 	}
 	else {
+		g_depend.add_file(found_filename);
 		m_files.emplace_back(found_filename, ifs);
 		return true;
 	}
@@ -205,10 +221,14 @@ bool Preproc::getline1(string& line) {
 	line.clear();
 	while (true) {
 		if (!m_output.empty()) {		// output queue
-			line = m_output.front();
+			PreprocOutput output = std::move(m_output.front());
 			m_output.pop_front();
-			if (!line.empty())
+			if (!output.binary_file.empty())
+				append_binary_file(output.binary_file);
+			else if (!output.text.empty()) {
+				line = std::move(output.text);
 				return true;
+			}
 		}
 		else if (m_levels.back().getline(line)) {	// read from macro expansion
 			if (g_is_preproc_active)
@@ -678,37 +698,38 @@ void Preproc::do_binary() {
 		if (!m_lexer.peek().is(TType::Newline))
 			g_errors.error(ErrCode::Syntax);
 		else {
-			// search file in path
+			// search file in path; the bytes are appended to the code after
+			// the lines already in the output queue are assembled
 			string found_filename = search_includes(filename.c_str());
-
-			// open file
-			ifstream ifs(found_filename, ios::binary);
-			if (!ifs.is_open())
-				g_errors.error(ErrCode::FileOpen, found_filename);
-			else {
-				// output DEFB lines
-				const int line_len = 16;
-				unsigned char bytes[line_len];
-
-				while (!ifs.eof()) {
-					ifs.read(reinterpret_cast<char*>(bytes), line_len);
-					size_t num_read = static_cast<size_t>(ifs.gcount());
-					if (num_read > 0) {
-						string line = "defb ";
-						string separator = "";
-						for (size_t i = 0; i < num_read; i++) {
-							line += separator + std::to_string(bytes[i]);
-							separator = ",";
-						}
-						line += "\n";
-						m_output.push_back(line);
-					}
-				}
-			}
+			m_output.emplace_back("", found_filename);
 		}
 	}
 }
 
+// read the whole file directly into the current section
+void Preproc::append_binary_file(const string& filename) {
+	ifstream ifs(filename, ios::binary | ios::ate);
+	if (!ifs.is_open()) {
+		g_errors.error(ErrCode::FileOpen, filename);
+		return;
+	}
+
+	g_depend.add_file(filename);
+
+	// the previous lines were already assembled, errors refer to this line
+	set_error_expanded_line("");
+
+	int size = static_cast<int>(ifs.tellg());
+	if (size > 0) {
+		ifs.seekg(0);
+		unsigned char* bytes = append_reserve(size);
+		ifs.read(reinterpret_cast<char*>(bytes), size);
+		if (list_is_on())
+			list_append_binary(bytes, size);
+		next_PC();						// next line starts after the block
+	}
+}
+
 void Preproc::do_define() {
 	if (!m_lexer.peek().is(TType::Ident))
 		g_errors.error(ErrCode::Syntax);
@@ -1021,7 +1042,7 @@ ExpandedText Preproc::expand(Lexer& lexer, Macros& defines) {
 	ExpandedText out;
 
 	while (!lexer.at_end()) {
-		Token token = lexer.peek(0);
+		const Token& token = lexer.peek(0);
 		lexer.next();
 
 		switch (token.ttype) {
@@ -1369,13 +1390,13 @@ char* sfile_getline() {
 		return nullptr;
 }
 
-// NOTE: user must free returned pointer
-char* sfile_get_source_line() {
-	string line;
+// NOTE: returns a static buffer, overwritten by the next call
+const char* sfile_get_source_line() {
+	static string line;
 	if (g_hold_getline)
 		return nullptr;
 	if (g_preproc.getline(line)) 
-		return must_strdup(line.c_str());	// needs to be freed by the user
+		return line.c_str();				// valid until the next call
 	else
 		return nullptr;
 }
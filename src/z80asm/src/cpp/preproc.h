@@ -54,7 +54,7 @@ private:
 
 class ExpandedText {
 public:
-	string text() const { return m_text; }
+	const string& text() const { return m_text; }
 	bool got_error() const { return m_error; }
 	void append(const string& str);
 	void set_error(bool f) { m_error = f; }
@@ -76,6 +76,15 @@ struct IfNest {
 
 //-----------------------------------------------------------------------------
 
+struct PreprocOutput {
+	string		text;				// line to parse
+	string		binary_file;		// or binary file to append to the code
+
+	PreprocOutput(const string& text_ = "", const string& binary_file_ = "");
+};
+
+//-----------------------------------------------------------------------------
+
 class Preproc {
 public:
 	Preproc();
@@ -93,7 +102,7 @@ public:
 private:
 	list<PreprocFile>	m_files;		// input stack of files
 	list<PreprocLevel>	m_levels;		// levels of macro expansion
-	deque<string>		m_output;       // parsed output
+	deque<PreprocOutput> m_output;      // parsed output
 	vector<IfNest>		m_if_stack;		// state of nested IFs
 	Lexer				m_lexer;		// line being parsed
 	Macros				m_macros;		// MACRO..ENDM macros
@@ -130,6 +139,7 @@ private:
 	void do_elifndef();
 	void do_include();
 	void do_binary();
+	void append_binary_file(const string& filename);
 	void do_define();
 	void do_undef();
 	void do_defl(const string& name);
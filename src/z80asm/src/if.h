@@ -27,6 +27,7 @@ extern "C" {
 #define EXT_SYM     ".sym"    
 #define EXT_MAP     ".map"    
 #define EXT_RELOC   ".reloc"  
+#define EXT_HASH    ".hash"   
 
 // appmake
 #define APPMAKE_NONE	0
@@ -73,6 +74,9 @@ extern "C" {
 // main routine
 int z80asm_main();
 
+// -j: the module being assembled uses state left by the previous modules
+void module_depends_on_previous();
+
 // string pool
 const char* spool_add(const char* str);
 
@@ -119,6 +123,7 @@ void error_symbol_redecl(const char* name);
 void error_syntax();
 void error_syntax_expr();
 void error_undefined_symbol(const char* name);
+void error_circular_definition(const char* names);
 void warn_expr_in_parens();
 void warn_org_ignored(const char* filename, const char* section);
 void warn_int_range(int value);
@@ -157,6 +162,7 @@ const char* option_bin_file();
 bool option_make_bin();
 bool option_split_bin();
 bool option_date_stamp();
+int option_jobs();
 bool option_relocatable();
 bool option_reloc_info();
 int option_filler();
@@ -185,6 +191,7 @@ const char* get_lib_filename(const char* filename);
 const char* get_sym_filename(const char* filename);
 const char* get_map_filename(const char* filename);
 const char* get_reloc_filename(const char* filename);
+const char* get_hash_filename(const char* filename);
 
 // expressions
 void parse_const_expr_eval(const char* expr_text, int* result, bool* error);
@@ -196,7 +203,7 @@ bool sfile_open(const char* filename, bool search_include_path);
 void sfile_hold_input();
 void sfile_unhold_input();
 char* sfile_getline();			// NOTE: user must free returned pointer
-char* sfile_get_source_line();	// NOTE: user must free returned pointer
+const char* sfile_get_source_line();	// NOTE: valid until the next call
 const char* sfile_filename();
 int sfile_line_num();
 bool sfile_is_c_source();
@@ -211,6 +218,8 @@ struct Symbol1* define_static_def_sym(const char* name, long value);
 // code area
 int get_PC();
 int get_phased_PC();
+int next_PC();
+unsigned char* append_reserve(int num_bytes);
 
 // list file
 void list_open(const char* list_file);
@@ -218,6 +227,7 @@ void list_close();
 void list_source_line(const char* filename, int line_num, int asmpc, int phased_pc, const char* text);
 void list_expanded_line(int asmpc, int phased_pc, const char* text);
 void list_append_bytes(int value, int num_bytes);
+void list_append_binary(const unsigned char* bytes, int num_bytes);
 void list_patch_bytes(int asmpc, int value, int num_bytes);
 void list_end_line();
 void list_got_source_line(const char* filename, int line_num, const char* text);
@@ -232,6 +242,12 @@ const char* get_float_format_define(void);
 bool check_object_file(const char* obj_filename);
 bool check_object_file_no_errors(const char* obj_filename);
 
+// dependencies of the object file, for -d
+void depend_clear();
+bool depend_up_to_date(const char* hash_filename, const char* src_filename,
+	const char* obj_filename);
+void depend_write(const char* hash_filename);
+
 #ifdef __cplusplus
 }
 #endif
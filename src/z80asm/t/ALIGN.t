@@ -109,7 +109,7 @@ run_ok("z88dk-z80asm -b $test.asm");
 check_bin_file("$test.bin", bytes(0, (0) x 15, 1,2,3,4));
 
 capture_ok("z88dk-z80nm -a $test.o", <<END);
-Object  file $test.o at \$0000: Z80RMF16
+Object  file $test.o at \$0000: Z80RMF17
   Name: $test
   Section code: 1 bytes
     C \$0000: 00
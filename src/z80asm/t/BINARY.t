@@ -58,7 +58,6 @@ z80asm_nok("", "", <<END_ASM, <<END_ERR);
 END_ASM
 $test.asm:2: error: segment overflow
   ^---- binary "test_t_BINARY.dat"
-      ^---- defb 240,241,242,243,244,245,246,247,248,249,250,251,252,253,254,255
 END_ERR
 
 spew("$test.dat", $blob."x");		# 64k+1
@@ -67,9 +66,28 @@ z80asm_nok("", "", <<END_ASM, <<END_ERR);
 END_ASM
 $test.asm:1: error: segment overflow
   ^---- binary "test_t_BINARY.dat"
-      ^---- defb 120
 END_ERR
 
+#-------------------------------------------------------------------------------
+# list file shows only the first bytes of the binary
+#-------------------------------------------------------------------------------
+spew("$test.dat", join("", map{chr} 0..19));
+spew("$test.asm", <<END);
+	ld bc,1
+L1:	binary "$test.dat"
+	nop
+END
+run_ok("z88dk-z80asm -b -l $test.asm");
+check_bin_file("$test.bin", bytes(1, 1, 0, 0..19, 0));
+check_text_file("$test.lis", <<END);
+$test.asm:
+     1  0000  010100            	ld bc,1
+     2  0003  0001020304050607  L1:	binary "$test.dat"
+              ...               ; 20 bytes
+     3  0017  00                	nop
+     4                          
+END
+
 #-------------------------------------------------------------------------------
 # with directories
 #-------------------------------------------------------------------------------
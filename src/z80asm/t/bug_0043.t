@@ -17,7 +17,7 @@ z80asm_ok("", "$test.asm $test.1.asm", "", <<END, words(1000));
 END
 
 capture_ok("z88dk-z80nm -a $test.o", <<END);
-Object  file $test.o at \$0000: Z80RMF16
+Object  file $test.o at \$0000: Z80RMF17
   Name: $test
   Section "": 2 bytes
     C \$0000: 00 00
@@ -22,7 +22,7 @@ END
 capture_ok("z88dk-z80asm ${test}1.asm", "");
 
 capture_ok("z88dk-z80nm -a ${test}1.o", <<END);
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section LOADER: 3 bytes
     C \$0000: 21 00 00
@@ -37,7 +37,7 @@ END
 capture_ok("z88dk-z80asm -o${test}1.o ${test}1.asm", "");
 
 capture_ok("z88dk-z80nm -a ${test}1.o", <<END);
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section LOADER: 3 bytes
     C \$0000: 21 00 00
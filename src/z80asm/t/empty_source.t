@@ -8,7 +8,7 @@ use Modern::Perl;
 z80asm_ok("", "", "", "", "");
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
 END
 
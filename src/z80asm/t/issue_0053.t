@@ -51,7 +51,7 @@ DEFC asm_BIFROST2_stop               = $C9B2
 END
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes, ORG \$FDE8
     C \$0000: C9
@@ -61,7 +61,7 @@ DEFC asm_BIFROST2_showNext2Tiles     = \$C9C2
 END
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes, ORG \$FDE8
     C \$0000: C9
@@ -19,7 +19,7 @@ lbl2:	binary  "${test}1.bin"
 END
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 2 bytes
     C \$0000: 00 01
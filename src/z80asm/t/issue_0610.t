@@ -20,7 +20,7 @@ spew("${test}.def",		"test");
 capture_ok("z88dk-z80asm ${test}", "");
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes
     C \$0000: 00
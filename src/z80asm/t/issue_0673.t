@@ -16,7 +16,7 @@ z80asm_ok("", "", "", <<END, bytes(1,2));
 END
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: a
   Section a: 1 bytes
     C \$0000: 01
@@ -11,9 +11,24 @@ z80asm_nok("", "", <<END_ASM, <<END_ERR);
         defc    i_64 = i_61
         defc    i_61 = i_64
 END_ASM
-$test.asm:1: error: undefined symbol: i_64
+$test.asm:1: error: circular definition: i_64 -> i_61 -> i_64
   ^---- i_61
-$test.asm:2: error: undefined symbol: i_61
+END_ERR
+
+# longer cycle, expressions that depend on the cycle are unresolved
+z80asm_nok("", "", <<END_ASM, <<END_ERR);
+        defc    i_64 = i_61 + 1
+        defc    i_61 = i_63
+        defc    i_63 = i_62
+        defc    i_62 = i_61
+        defc    x = i_64
+        ld      a, x
+END_ASM
+$test.asm:2: error: circular definition: i_61 -> i_63 -> i_62 -> i_61
+  ^---- i_63
+$test.asm:1: error: undefined symbol: i_64
+  ^---- i_61+1
+$test.asm:5: error: undefined symbol: x
   ^---- i_64
 END_ERR
 
@@ -30,10 +45,45 @@ spew("$test.2.asm", <<END_ASM);
 END_ASM
 
 capture_nok("z88dk-z80asm -b $test.1.asm $test.2.asm", <<END_ERR);
-$test.1.asm:3: error: undefined symbol: i_64
+$test.1.asm:3: error: circular definition: i_64 -> i_61 -> i_64
   ^---- i_61
-$test.2.asm:3: error: undefined symbol: i_61
-  ^---- i_64
+END_ERR
+
+# cycle that also refers to an extern
+spew("$test.1.asm", <<END_ASM);
+        extern  ext
+        defc    i_64 = i_61 + ext
+        defc    i_61 = i_64
+        defw    i_64
+END_ASM
+
+spew("$test.2.asm", <<END_ASM);
+        public  ext
+        defc    ext = 3
+END_ASM
+
+capture_nok("z88dk-z80asm -b $test.1.asm $test.2.asm", <<END_ERR);
+$test.1.asm:2: error: circular definition: i_64 -> i_61 -> i_64
+  ^---- i_61+ext
+END_ERR
+
+# same, with the cycle split across modules
+spew("$test.1.asm", <<END_ASM);
+        public  i_64
+        extern  i_61, ext
+        defc    i_64 = i_61 + ext
+END_ASM
+
+spew("$test.2.asm", <<END_ASM);
+        public  i_61, ext
+        extern  i_64
+        defc    i_61 = i_64
+        defc    ext = 3
+END_ASM
+
+capture_nok("z88dk-z80asm -b $test.1.asm $test.2.asm", <<END_ERR);
+$test.1.asm:3: error: circular definition: i_64 -> i_61 -> i_64
+  ^---- i_61+ext
 END_ERR
 
 unlink_testfiles;
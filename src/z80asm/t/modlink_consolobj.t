@@ -155,7 +155,7 @@ capture_ok("z88dk-z80asm -s -o${test}.o ".
 		   "${test}1.asm ${test}2.asm ${test}3.asm ${test}4.asm", "");
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section code: 37 bytes
     C \$0000: CD 00 00 21 00 00 CD 00 00 CD 00 00 C9 7E A7 C8
@@ -30,7 +30,7 @@ capture_ok("z88dk-z80asm -b ${test}.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 8 bytes, ORG \$0100
     C \$0000: 00 00 00 00 00 00 00 00
@@ -111,7 +111,7 @@ capture_ok("z88dk-z80asm -b ${test}.o ${test}1.o ${test}2.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o ${test}1.o ${test}2.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 0 bytes, ORG \$1000
   Section code: 9 bytes
@@ -125,7 +125,7 @@ Object  file ${test}.o at \$0000: Z80RMF16
     E Cw \$0000 \$0001: func1_alias (section code) (file ${test}.asm:7)
     E Cw \$0003 \$0004: func2_alias (section code) (file ${test}.asm:8)
     E Cw \$0006 \$0007: computed_end (section code) (file ${test}.asm:9)
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section "": 0 bytes, ORG \$1000
   Section code: 1 bytes
@@ -135,7 +135,7 @@ Object  file ${test}1.o at \$0000: Z80RMF16
   Symbols:
     G A \$0000 func1 (section lib) (file ${test}1.asm:7)
     G A \$0000 func2 (section code) (file ${test}1.asm:10)
-Object  file ${test}2.o at \$0000: Z80RMF16
+Object  file ${test}2.o at \$0000: Z80RMF17
   Name: ${test}2
   Section "": 0 bytes, ORG \$1000
   Section code: 0 bytes
@@ -202,7 +202,7 @@ capture_ok("z88dk-z80asm -b ${test}.o ${test}1.o ${test}2.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o ${test}1.o ${test}2.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 0 bytes, ORG \$1000
   Symbols:
@@ -211,13 +211,13 @@ Object  file ${test}.o at \$0000: Z80RMF16
     U         asm_b_array_at
   Expressions:
     E =  \$0000 \$0000: asm_b_vector_at := asm_b_array_at (section "") (file ${test}.asm:4)
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section "": 1 bytes, ORG \$1000
     C \$0000: C9
   Symbols:
     G A \$0000 asm_b_array_at (section "") (file ${test}1.asm:3)
-Object  file ${test}2.o at \$0000: Z80RMF16
+Object  file ${test}2.o at \$0000: Z80RMF17
   Name: ${test}2
   Section "": 7 bytes, ORG \$1000
     C \$0000: CD 00 00 CD 00 00 C9
@@ -231,6 +231,21 @@ Object  file ${test}2.o at \$0000: Z80RMF16
     E Cw \$0003 \$0004: asm_b_array_at (section "") (file ${test}2.asm:6)
 END
 
+#------------------------------------------------------------------------------
+# long chain of defc across modules, defined in reverse order
+unlink_testfiles;
+spew("${test}.asm", 
+	"\tpublic chain0\n\textern chain1\n".
+	"\tdefc chain0 = chain1 + 1\n".
+	"\tdefw chain0\n");
+spew("${test}1.asm",
+	"\tpublic chain1\n".
+	join('', map {"\tdefc chain$_ = chain".($_+1)." + 1\n"} reverse 1..99).
+	"\tdefc chain100 = last\n".
+	"last: defb 0\n");
+capture_ok("z88dk-z80asm -b -r0x1000 ${test}.asm ${test}1.asm", "");
+check_bin_file("${test}.bin", words(0x1002 + 100).bytes(0));
+
 
 unlink_testfiles;
 done_testing;
@@ -83,7 +83,7 @@ capture_ok("z88dk-z80asm -b -l -m ${test}.o ${test}1.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o ${test}1.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 28 bytes, ORG \$1234
     C \$0000: 3E 00 C3 00 00 06 00 C3 00 00 21 00 00 01 06 00
@@ -106,7 +106,7 @@ Object  file ${test}.o at \$0000: Z80RMF16
     E Cw \$0013 \$0014: __head (section "") (file ${test}.asm:14)
     E Cw \$0016 \$0017: __tail (section "") (file ${test}.asm:15)
     E Cw \$0019 \$001A: __size (section "") (file ${test}.asm:16)
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section "": 28 bytes, ORG \$1234
     C \$0000: 3E 00 C3 00 00 06 00 C3 00 00 21 00 00 01 00 00
@@ -176,7 +176,7 @@ capture_ok("z88dk-z80asm -b ${test}.o ${test}1.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o ${test}1.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 4 bytes, ORG \$1000
     C \$0000: CD 00 00 C9
@@ -186,7 +186,7 @@ Object  file ${test}.o at \$0000: Z80RMF16
     U         func2
   Expressions:
     E Cw \$0000 \$0001: func2 (section "") (file ${test}.asm:3)
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section "": 4 bytes, ORG \$1000
     C \$0000: CD 00 00 C9
@@ -235,7 +235,7 @@ capture_ok("z88dk-z80asm -b ${test}.o ${test}1.o", "");
 check_bin_file("${test}.bin", $bin);
 
 capture_ok("z88dk-z80nm -a ${test}.o ${test}1.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 4 bytes, ORG \$1000
     C \$0000: CD 00 00 C9
@@ -245,7 +245,7 @@ Object  file ${test}.o at \$0000: Z80RMF16
     U         func2
   Expressions:
     E Cw \$0000 \$0001: func2 (section "") (file ${test}.asm:1)
-Object  file ${test}1.o at \$0000: Z80RMF16
+Object  file ${test}1.o at \$0000: Z80RMF17
   Name: ${test}1
   Section "": 4 bytes, ORG \$1000
     C \$0000: CD 00 00 C9
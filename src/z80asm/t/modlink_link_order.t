@@ -25,11 +25,11 @@ END
 capture_ok("z88dk-z80asm -x${test}plat1.lib ${test}plat1.asm ${test}gen.asm", "");
 
 capture_ok("z88dk-z80nm -a ${test}plat1.lib", <<END);
-Library file ${test}plat1.lib at \$0000: Z80LMF16
-Object  file ${test}plat1.lib at \$0010: Z80RMF16
+Library file ${test}plat1.lib at \$0000: Z80LMF17
+Object  file ${test}plat1.lib at \$0010: Z80RMF17
   Name: ${test}plat1
 
-Object  file ${test}plat1.lib at \$0054: Z80RMF16
+Object  file ${test}plat1.lib at \$0054: Z80RMF17
   Name: ${test}gen
   Section "": 3 bytes
     C \$0000: 3E 01 C9
@@ -52,11 +52,11 @@ END
 capture_ok("z88dk-z80asm -x${test}plat2.lib ${test}plat2.asm ${test}gen.asm", "");
 
 capture_ok("z88dk-z80nm -a ${test}plat1.lib", <<END);
-Library file ${test}plat1.lib at \$0000: Z80LMF16
-Object  file ${test}plat1.lib at \$0010: Z80RMF16
+Library file ${test}plat1.lib at \$0000: Z80LMF17
+Object  file ${test}plat1.lib at \$0010: Z80RMF17
   Name: ${test}plat1
 
-Object  file ${test}plat1.lib at \$0054: Z80RMF16
+Object  file ${test}plat1.lib at \$0054: Z80RMF17
   Name: ${test}gen
   Section "": 3 bytes
     C \$0000: 3E 01 C9
@@ -84,6 +84,25 @@ unlink("${test}.bin");
 capture_ok("z88dk-z80asm -l${test}plat2.lib -b ${test}.asm", "");
 check_bin_file("${test}.bin", bytes(0xC3, 3, 0, 0x3E, 2, 0xC9));
 
+# first library in the command line wins
+unlink("${test}.bin");
+capture_ok("z88dk-z80asm -l${test}plat2.lib -l${test}plat1.lib -b ${test}.asm", "");
+check_bin_file("${test}.bin", bytes(0xC3, 3, 0, 0x3E, 2, 0xC9));
+
+unlink("${test}.bin");
+capture_ok("z88dk-z80asm -l${test}plat1.lib -l${test}plat2.lib -b ${test}.asm", "");
+check_bin_file("${test}.bin", bytes(0xC3, 3, 0, 0x3E, 1, 0xC9));
+
+# library without symbol directory, e.g. written by another tool
+my $lib = slurp("${test}plat2.lib");
+is substr($lib, -8), "Z80LDX17", "library has symbol directory";
+my $dir_ptr = unpack("V", substr($lib, -12, 4));
+spew("${test}plat3.lib", substr($lib, 0, $dir_ptr));
+
+unlink("${test}.bin");
+capture_ok("z88dk-z80asm -l${test}plat3.lib -b ${test}.asm", "");
+check_bin_file("${test}.bin", bytes(0xC3, 3, 0, 0x3E, 2, 0xC9));
+
 
 unlink_testfiles;
 done_testing;
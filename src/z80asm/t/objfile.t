@@ -17,7 +17,7 @@ capture_ok("z88dk-z80asm ${test}.asm", "");
 check_bin_file("${test}.o", objfile(NAME => $test));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
 END
 
@@ -32,7 +32,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 									CODE => [["", -1, 1, bytes(0)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes
     C \$0000: 00
@@ -49,7 +49,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 									CODE => [["", -1, 1, bytes(0) x 0x10000]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 65536 bytes
     C \$0000: 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00
@@ -4161,7 +4161,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 									CODE => [["", 0, 1, bytes(0)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes, ORG \$0000
     C \$0000: 00
@@ -4178,7 +4178,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 									CODE => [["", 0xFFFF, 1, bytes(0)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 1 bytes, ORG \$FFFF
     C \$0000: 00
@@ -4216,7 +4216,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 												  0x21,0x7F,0x00,0x39)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 42 bytes
     C \$0000: 3E 0C DD 46 0C 11 0C 00 0C 00 00 00 EB 21 80 00
@@ -4267,7 +4267,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 						  0x21,0x7F,0x00,0x39)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 42 bytes
     C \$0000: 3E 0C DD 46 0C 11 0C 00 0C 00 00 00 EB 21 80 00
@@ -4323,7 +4323,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 						  0x21,0x7F,0x00,0x39)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 42 bytes
     C \$0000: 3E 0C DD 46 0C 11 0C 00 0C 00 00 00 EB 21 80 00
@@ -4376,7 +4376,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 						  0x00,0x00,0x00,0x00)]]));	# addr  14
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 18 bytes, ORG \$0003
     C \$0000: 3E 00 DD 46 00 01 00 00 11 00 00 01 00 00 00 00
@@ -4423,7 +4423,7 @@ check_bin_file("${test}.o", objfile(NAME => $test,
 							  0xCD,0x00,0x00)]]));
 
 capture_ok("z88dk-z80nm -a ${test}.o", <<END);
-Object  file ${test}.o at \$0000: Z80RMF16
+Object  file ${test}.o at \$0000: Z80RMF17
   Name: ${test}
   Section "": 7 bytes
     C \$0000: 00 CD 00 00 CD 00 00
@@ -4460,15 +4460,15 @@ my $obj2 = slurp("${test}2.o");
 check_bin_file("${test}.lib", libfile($obj1, $obj2));
 
 capture_ok("z88dk-z80nm -a ${test}.lib", <<END);
-Library file ${test}.lib at \$0000: Z80LMF16
-Object  file ${test}.lib at \$0010: Z80RMF16
+Library file ${test}.lib at \$0000: Z80LMF17
+Object  file ${test}.lib at \$0010: Z80RMF17
   Name: ${test}1
   Section "": 1 bytes
     C \$0000: C9
   Symbols:
     G A \$0000 mult (section "") (file ${test}1.asm:2)
 
-Object  file ${test}.lib at \$0080: Z80RMF16
+Object  file ${test}.lib at \$0080: Z80RMF17
   Name: ${test}2
   Section "": 1 bytes
     C \$0000: C9
@@ -26,7 +26,7 @@ ok -f "${test}.o", "object file";
 
 ok abs((-M "${test}.o") - $date_obj) < 0.001, "same object";
 
-# touch source
+# touch source, same contents -> skips compile
 sleep(1);		# make sure our obj is older
 
 spew("${test}.asm", <<END);
@@ -36,8 +36,122 @@ END
 capture_ok("z88dk-z80asm -d ${test}.asm", "");
 ok -f "${test}.o", "object file";
 
+ok abs((-M "${test}.o") - $date_obj) < 0.001, "same object";
+
+# change source
+sleep(1);		# make sure our obj is older
+
+spew("${test}.asm", <<END);
+	nop
+	include "${test}.inc"
+	binary "${test}.dat"
+END
+spew("${test}.inc", <<END);
+	halt
+END
+spew("${test}.dat", "\x01\x02");
+
+capture_ok("z88dk-z80asm -d ${test}.asm", "");
+ok -f "${test}.o", "object file";
+ok -f "${test}.hash", "hash file";
+
+ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
+
+# change include file
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+spew("${test}.inc", <<END);
+	di
+END
+
+capture_ok("z88dk-z80asm -d ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
+
+capture_ok("z88dk-z80asm -b ${test}.o", "");
+check_bin_file("${test}.bin", bytes(0, 0xF3, 1, 2));
+
+# change binary file
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+spew("${test}.dat", "\x03");
+
+capture_ok("z88dk-z80asm -d ${test}.asm", "");
 ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
 
+# change define
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+capture_ok("z88dk-z80asm -d -DFOO ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
+
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+capture_ok("z88dk-z80asm -d -DFOO ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) < 0.001, "same object";
+
+# change cpu
+sleep(1);		# make sure our obj is older
+
+capture_ok("z88dk-z80asm -d -DFOO -m8080 ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
+
+# change include path, picks up a file with the same name in another directory
+unlink_testfiles;
+path("$test.dir1")->mkpath;
+path("$test.dir2")->mkpath;
+
+spew("${test}.asm", <<END);
+	include "${test}.inc"
+END
+spew("$test.dir1/${test}.inc", <<END);
+	defb 1
+END
+spew("$test.dir2/${test}.inc", <<END);
+	defb 2
+END
+
+capture_ok("z88dk-z80asm -d -b -I$test.dir1 ${test}.asm", "");
+check_bin_file("${test}.bin", bytes(1));
+
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+capture_ok("z88dk-z80asm -d -b -I$test.dir2 ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) > 0, "new object";
+check_bin_file("${test}.bin", bytes(2));
+
+$date_obj = -M "${test}.o";
+sleep(1);		# make sure our obj is older
+
+capture_ok("z88dk-z80asm -d -b -I$test.dir2 ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) < 0.001, "same object";
+
+path("$test.dir1")->remove_tree if Test::More->builder->is_passing;
+path("$test.dir2")->remove_tree if Test::More->builder->is_passing;
+
+# object assembled without -d, e.g. by zcc, has no hash file -> used while not older than the source
+unlink_testfiles;
+
+spew("${test}.asm", <<END);
+	include "${test}.inc"
+END
+spew("${test}.inc", <<END);
+	halt
+END
+
+capture_ok("z88dk-z80asm ${test}.asm", "");
+ok ! -f "${test}.hash", "no hash file";
+unlink "${test}.inc";			# would fail if assembled again
+
+$date_obj = -M "${test}.o";
+capture_ok("z88dk-z80asm -d -b ${test}.asm", "");
+ok abs((-M "${test}.o") - $date_obj) < 0.001, "same object";
+check_bin_file("${test}.bin", bytes(0x76));
+
 # remove source, give -d -> uses existing object - with extensiom
 unlink "${test}.asm";
 
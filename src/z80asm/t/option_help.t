@@ -59,6 +59,7 @@ Binary Output:
   -b                    Assemble and link/relocate to file.bin
   -split-bin            Create one binary file per section
   -d                    Assemble only updated files
+  -j[=]N                Assemble up to N files in parallel
   -R                    Create relocatable code
   -reloc-info           Generate binary file relocation information
   -r[=]ADDR             Relocate binary file to given address in decimal or hex
@@ -0,0 +1,62 @@
+#!/usr/bin/env perl
+
+BEGIN { use lib 't'; require 'testlib.pl'; }
+
+use Modern::Perl;
+
+# -j
+
+# invalid option
+unlink_testfiles;
+spew("${test}.asm", "nop");
+capture_nok("z88dk-z80asm -j0 ${test}.asm", <<END);
+error: invalid jobs (-j) option: 0
+END
+
+# library built in parallel is the same as built serially
+unlink_testfiles;
+for my $i (1..9) {
+	spew("${test}${i}.asm", <<END);
+	PUBLIC f${i}
+	EXTERN f@{[$i % 9 + 1]}
+f${i}:
+	ld a, ${i}
+	call f@{[$i % 9 + 1]}
+	ret
+END
+}
+
+# uses the DEFVARS address counter left by the previous module
+spew("${test}a.asm", <<END);
+	DEFVARS 0x80
+	{
+		va ds.b 2
+	}
+	PUBLIC fa
+fa:	ld a, va
+END
+spew("${test}b.asm", <<END);
+	DEFVARS -1
+	{
+		vb ds.b 1
+	}
+	PUBLIC fb
+fb:	ld a, vb
+	ld a, 256
+END
+
+my $files = join(" ", map {"${test}${_}.asm"} 1..9, 'a', 'b');
+
+run_ok("z88dk-z80asm -v -x${test}_serial.lib $files > ${test}_serial.out 2> ${test}_serial.err");
+run_ok("z88dk-z80asm -j4 -v -x${test}_jobs.lib $files > ${test}_jobs.out 2> ${test}_jobs.err");
+
+ok slurp("${test}_serial.lib") eq slurp("${test}_jobs.lib"), "same library";
+ok slurp("${test}_serial.err") eq slurp("${test}_jobs.err"), "same errors";
+ok slurp("${test}_serial.out") =~ s/_serial/_jobs/r eq slurp("${test}_jobs.out"), "same output";
+check_text_file("${test}_jobs.err", <<END);
+${test}b.asm:7: warning: integer range: \$100
+  ^---- 256
+END
+
+unlink_testfiles;
+done_testing;
@@ -23,7 +23,7 @@ __size                          = \$0004 ; const, public, def, , ,
 END
 
 capture_ok("z88dk-z80nm -a $test.o", <<END);
-Object  file $test.o at \$0000: Z80RMF16
+Object  file $test.o at \$0000: Z80RMF17
   Name: $test
   Section "": 4 bytes
     C \$0000: C9 CD 00 00
@@ -48,7 +48,7 @@ __size                          = \$0004 ; const, public, def, , ,
 END
 
 capture_ok("z88dk-z80nm -a $test.o", <<END);
-Object  file $test.o at \$0000: Z80RMF16
+Object  file $test.o at \$0000: Z80RMF17
   Name: $test
   Section "": 4 bytes
     C \$0000: C9 CD 00 00
@@ -13,7 +13,7 @@ $ENV{PATH} = join($Config{path_sep},
 			"../../bin",
 			$ENV{PATH});
 
-my $OBJ_FILE_VERSION = "16";
+my $OBJ_FILE_VERSION = "17";
 
 use vars '$test', '$null';
 $test = "test_".(($0 =~ s/\.t$//r) =~ s/[\.\/\\]/_/gr);
@@ -154,16 +154,22 @@ sub objfile {
 	my $lib_addr	 = length($o); $o .= pack("V", -1);
 	my $code_addr	 = length($o); $o .= pack("V", -1);
 
-	# store expressions
+	# store expressions, preceded by the names table of the RPN code;
+	# RPN code is compiled from text, unless given as 9th element
 	if ($args{EXPR}) {
 		store_ptr(\$o, $expr_addr);
+		my(@names, %name_index, $exprs);
 		for (@{$args{EXPR}}) {
-			@$_ == 8 or die;
-			my($type, $filename, $line_nr, $section, $asmptr, $ptr, $target_name, $text) = @$_;
-			$o .= $type . pack_lstring($filename) . pack("V", $line_nr) .
+			@$_ == 8 || @$_ == 9 or die;
+			my($type, $filename, $line_nr, $section, $asmptr, $ptr, $target_name, $text, $rpn) = @$_;
+			$rpn //= expr_rpn($text, \@names, \%name_index);
+			$exprs .= $type . pack_lstring($filename) . pack("V", $line_nr) .
 			        pack_lstring($section) . pack("vv", $asmptr, $ptr) .
-					pack_lstring($target_name) . pack_lstring($text);
+					pack_lstring($target_name) . pack_lstring($text) .
+					pack_lstring($rpn);
 		}
+		$o .= pack("v", scalar(@names)) . join('', map {pack_lstring($_)} @names);
+		$o .= $exprs;
 		$o .= "\0";
 	}
 
@@ -210,6 +216,44 @@ sub objfile {
 	return $o;
 }
 
+#------------------------------------------------------------------------------
+# compile simple infix expression (names, numbers, + - * / % and parentheses)
+# to object file RPN code, adding names to the names table
+sub expr_rpn {
+	my($text, $names, $name_index) = @_;
+	my %prec = ('+' => 1, '-' => 1, '*' => 2, '/' => 2, '%' => 2);
+	my(@out, @ops);
+	for my $tok ($text =~ /([_a-z]\w*|\d+|\S)/gi) {
+		if ($tok =~ /^\d/) {
+			push @out, "k".pack("V", $tok);
+		}
+		elsif ($tok =~ /^[_a-z]/i) {
+			if (!exists $name_index->{$tok}) {
+				$name_index->{$tok} = scalar(@$names);
+				push @$names, $tok;
+			}
+			push @out, "s".pack("v", $name_index->{$tok});
+		}
+		elsif ($tok eq '(') {
+			push @ops, $tok;
+		}
+		elsif ($tok eq ')') {
+			push @out, pop @ops while $ops[-1] ne '(';
+			pop @ops;
+		}
+		elsif (exists $prec{$tok}) {
+			push @out, pop @ops 
+				while @ops && $ops[-1] ne '(' && $prec{$ops[-1]} >= $prec{$tok};
+			push @ops, $tok;
+		}
+		else {
+			die "cannot compile expression '$text'";
+		}
+	}
+	push @out, reverse @ops;
+	return join('', @out);
+}
+
 #------------------------------------------------------------------------------
 # store a pointer to the end of the binary object at the given address
 sub store_ptr {
@@ -230,19 +274,52 @@ sub pack_lstring {
 sub libfile {
 	my(@o_files) = @_;
 	my $lib = "Z80LMF".$OBJ_FILE_VERSION;
+	my @dir;
 	for my $i (0 .. $#o_files) {
 		my $o_file = $o_files[$i];
 		my $next_ptr = ($i == $#o_files) ?
 						-1 : length($lib) + 4 + 4 + length($o_file);
 
+		push @dir, map {[length($lib), $_]} objfile_global_names($o_file);
+
 		$lib .= pack("V", $next_ptr);
 		$lib .= pack("V", length($o_file));
 		$lib .= $o_file;
 	}
 
+	# symbol directory
+	my $dir_ptr = length($lib);
+	$lib .= pack("V", scalar(@dir));
+	for (@dir) {
+		my($ptr, $name) = @$_;
+		$lib .= pack("V", $ptr) . pack_lstring($name);
+	}
+	$lib .= pack("V", $dir_ptr) . "Z80LDX".$OBJ_FILE_VERSION;
+
 	return $lib;
 }
 
+#------------------------------------------------------------------------------
+# return names of global symbols defined in object file binary representation
+sub objfile_global_names {
+	my($o) = @_;
+	my @names;
+	my $p = unpack("V", substr($o, 8 + 2 * 4, 4));
+	return () if $p == 0xFFFFFFFF;
+	while ($p < length($o) && (my $scope = substr($o, $p, 1)) ne "\0") {
+		$p += 2;
+		$p += 2 + unpack("v", substr($o, $p, 2));			# section
+		$p += 4;											# value
+		my $len = unpack("v", substr($o, $p, 2));
+		my $name = substr($o, $p + 2, $len);
+		$p += 2 + $len;
+		$p += 2 + unpack("v", substr($o, $p, 2));			# file name
+		$p += 4;											# line number
+		push @names, $name if $scope eq 'G';
+	}
+	return @names;
+}
+
 #------------------------------------------------------------------------------
 # quote command line argument with "" on Windows, '' otherwise
 sub quote_os {
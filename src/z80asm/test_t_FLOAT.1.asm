@@ -0,0 +1,2 @@
+		setfloat ieee16
+		float 5.5
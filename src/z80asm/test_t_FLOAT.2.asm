@@ -0,0 +1 @@
+		float 5.5
@@ -0,0 +1,2 @@
+setfloat am9511
+float 1,-1,255,-255,256,-256,65535,-65535,65536,-65536,5.5,-5.5,55,0.5
@@ -0,0 +1,3 @@
+		float fdata[] = { 1,-1,255,-255,256,-256,65535,-65535,65536,-65536,5.5,-5.5,55,0.5 };
+		float fend = 0.0;
+		int main() {}
@@ -0,0 +1 @@
+		nop
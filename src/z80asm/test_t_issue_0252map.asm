@@ -0,0 +1,11 @@
+		section s0
+		org 0
+		section s1
+		section s2
+		section s3
+		section a0
+		org 0x100
+		section a1
+		section b0
+		org 0x200
+		section b1
@@ -0,0 +1,23 @@
+		section s0
+		defb 0
+
+		section s1
+		defb 1
+
+		section s2
+		defb 2
+
+		section s3
+		defb 3
+
+		section a0
+		defb 10
+
+		section a1
+		defb 11
+
+		section b0
+		defb 20
+
+		section b1
+		defb 21
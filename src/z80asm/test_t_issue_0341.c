@@ -0,0 +1,12 @@
+int add(int a, int b) 
+{
+	return a+b;
+}
+
+int main()
+{
+	int a = 4;
+	int b = 6;
+	int s = add(a,b);
+	return s;
+}
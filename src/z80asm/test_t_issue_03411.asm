@@ -0,0 +1,3 @@
+	public func
+func:
+	ret
@@ -0,0 +1,2 @@
+		extern __z80asm__cpir
+		call   __z80asm__cpir
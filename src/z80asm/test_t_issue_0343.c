@@ -0,0 +1,7 @@
+#include <string.h>
+#include <stdio.h>
+int main () {
+	printf("%d\n", strncmp("hello world", "hello", 5) == 0);
+	printf("%d\n", strncmp("HELLO WORLD", "hello", 5) <  0);
+	return 0;
+}
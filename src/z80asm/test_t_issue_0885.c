@@ -0,0 +1,7 @@
+			void main(void)
+			{
+			__asm
+			ici:
+				DEFC toto = ici %8
+			__endasm;
+			}
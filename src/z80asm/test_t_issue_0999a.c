@@ -0,0 +1,4 @@
+unsigned char fa(void)
+{
+	return 100;
+}
@@ -0,0 +1,4 @@
+unsigned char fb(void)
+{
+	return 200;
+}
@@ -0,0 +1,16 @@
+aa_start:	defb 1
+aa_end:
+bb_start:	defb 2, 2
+bb_end:
+
+	defc s1=aa_end-aa_start
+	defc s2=2*(aa_end-aa_start)
+	defc s3=-aa_start+aa_end
+	defc s4=aa_end+2-aa_start
+	defc s5=bb_end-bb_start+aa_end-aa_start
+	
+	defs s1,3
+	defs s2,4
+	defs s3,5
+	defs s4,6
+	defs s5,7
@@ -0,0 +1,4 @@
+#include "test_t_option_debug.h"
+int main() {
+	return one()+one();
+}
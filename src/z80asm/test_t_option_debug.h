@@ -0,0 +1,4 @@
+// some
+// random
+extern int one();
+// lines
@@ -0,0 +1,4 @@
+	public _one
+_one:
+	ld hl, 1
+	ret
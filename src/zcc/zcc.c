@@ -30,6 +30,7 @@
 #include        "regex/regex.h"
 #include        "dirname.h"
 #include        "option.h"
+#include        "pragma.h"
 
 #ifdef WIN32
 #include        <direct.h>
@@ -47,6 +48,7 @@
 
 #else
 #include        <unistd.h>
+#include        <sys/wait.h>
 #endif
 
 
@@ -182,7 +184,12 @@ static void            configure_compiler();
 static void            configure_misc_options();
 static void            configure_maths_library(char **libstring);
 
-static void            apply_copt_rules(int filenumber, int num, char **rules, char *ext1, char *ext2, char *ext);
+static void            process_file(int i);
+static void            process_file_pragmas(int i);
+static void            process_files_in_parallel(int first, int last);
+static void            merge_pragmas(int first, int last);
+static int             filter_pragmas(int number, int sccz80_mode);
+static void            apply_copt_rules(int filenumber, int num, char **rules, char *ext1, char *ext);
 static void            zsdcc_asm_filter_comments(int filenumber, char *ext);
 static void            remove_temporary_files(void);
 static void            remove_file_with_extension(char *file, char *suffix);
@@ -215,6 +222,7 @@ struct explicit_extension
 static int             createapp = 0;    /* Go the next stage and create the app */
 static int             z80verbose = 0;
 static int             cleanup = 1;
+static int             c_jobs = 1;       /* Number of files processed in parallel */
 static int             assembleonly = 0;
 static int             lstcwd = 0;
 static int             compileonly = 0;
@@ -286,6 +294,7 @@ static char           *c_crt_incpath = NULL;
 static int             processing_user_command_line_arg = 0;
 static char            c_sccz80_r2l_calling;
 static char            c_copy_m4_processed_files;
+static char           *c_cpp_snapshot_dir = NULL;
 
 static char            filenamebuf[FILENAME_MAX + 1];
 #ifdef WIN32
@@ -332,7 +341,6 @@ static char  *c_sdcc_exe = "z88dk-zsdcc";
 static char  *c_sccz80_exe = "z88dk-sccz80";
 static char  *c_cpp_exe = "z88dk-ucpp";
 static char  *c_sdcc_preproc_exe = "z88dk-zsdcpp";
-static char  *c_zpragma_exe = "z88dk-zpragma";
 static char  *c_copt_exe = "z88dk-copt";
 static char  *c_appmake_exe = "z88dk-appmake";
 #ifndef WIN32
@@ -395,7 +403,6 @@ static arg_t  config[] = {
     { "CPP", 0, SetStringConfig, &c_cpp_exe, NULL, "Name of the cpp binary" },
     { "SDCPP", 0, SetStringConfig, &c_sdcc_preproc_exe, NULL, "Name of the SDCC cpp binary" },
     { "STYLECPP", 0, SetNumber, &c_stylecpp, NULL, "" },
-    { "ZPRAGMAEXE", 0, SetStringConfig, &c_zpragma_exe, NULL, "Name of the zpragma binary" },
 
     { "Z80EXE", 0, SetStringConfig, &c_z80asm_exe, NULL, "Name of the z80asm binary" },
     { "LINKOPTS", 0, SetStringConfig, &c_linkopts, NULL, "Options for z80asm as linker", " -L\"DESTDIR/lib/clibs\" -I\"DESTDIR/lib\" " },
@@ -507,6 +514,7 @@ static option options[] = {
     { 0, "I", OPT_FUNCTION|OPT_INCLUDE_OPT,  "Add an include directory for the preprocessor" , NULL, AddPreProcIncPath, 0},
     { 0, "iquote", OPT_FUNCTION|OPT_INCLUDE_OPT,  "Add a quoted include path for the preprocessor" , &cpparg, AddToArgsQuoted, 0},
     { 0, "isystem", OPT_FUNCTION|OPT_INCLUDE_OPT,  "Add a system include path for the preprocessor" , &cpparg, AddToArgsQuoted, 0},
+    { 0, "cpp-snapshot-dir", OPT_STRING,  "Keep snapshots of the leading #includes of C files in this directory (sccz80)" , &c_cpp_snapshot_dir, NULL, 0},
 
     { 0, "", OPT_HEADER, "Compiler (all) options:", NULL, NULL, 0 },
     { 0, "compiler", OPT_STRING,  "Set the compiler type from the command line (sccz80,sdcc)" , &c_compiler_type, NULL, 0},
@@ -554,6 +562,7 @@ static option options[] = {
     { 'M', NULL, OPT_BOOL|OPT_PRIVATE,  "Swallow -M option in configs" , &swallow_M, NULL, 0},
     { 0, "vn", OPT_BOOL_FALSE|OPT_PRIVATE,  "Turn off command tracing" , &verbose, NULL, 0},
     { 0, "no-cleanup", OPT_BOOL_FALSE, "Don't cleanup temporary files", &cleanup, NULL, 0 },
+    { 'j', "jobs", OPT_INT, "Number of files to compile in parallel", &c_jobs, NULL, 0 },
     { 0, "", 0, NULL },
 
 };
@@ -891,10 +900,9 @@ int linkthem(char *linker)
 
 int main(int argc, char **argv)
 {
-    int             i, ft;
+    int             i;
     char           *ptr;
     char            config_filename[FILENAME_MAX + 1];
-    char            asmarg[4096];    /* Hell, that should be long enough! */
     char            buffer[LINEMAX + 1];    /* For reading in option file */
     FILE           *fp;
 
@@ -1116,18 +1124,19 @@ int main(int argc, char **argv)
     /* process pragma-include */
     if (pragincname)
     {
-        char cmdline[FILENAME_MAX + 128];
+        pragma_set *pragmas = pragma_set_new();
 
-#ifdef _WIN32
-        snprintf(cmdline, FILENAME_MAX + 127, "%s -zcc-opt=\"%s\" < \"%s\" > nul",c_zpragma_exe, zcc_opt_def, pragincname);
-#else
-        snprintf(cmdline, FILENAME_MAX + 127, "%s -zcc-opt=\"%s\" < \"%s\" > /dev/null",c_zpragma_exe, zcc_opt_def, pragincname);
-#endif
-        if (verbose) { printf("%s\n", cmdline); fflush(stdout); }
-        if (-1 == system(cmdline)) {
-            fprintf(stderr, "Could not execute %s\n", cmdline);
+        if ((fp = fopen(pragincname, "r")) == NULL) {
+            fprintf(stderr, "Could not open %s\n", pragincname);
             exit(1);
         }
+        pragma_filter(pragmas, fp, NULL, 0);
+        fclose(fp);
+        if (pragma_write(pragmas, zcc_opt_def, "a")) {
+            fprintf(stderr, "Could not write %s\n", zcc_opt_def);
+            exit(1);
+        }
+        pragma_set_free(pragmas);
     }
 
 
@@ -1274,335 +1283,18 @@ int main(int argc, char **argv)
     /* The crt must be processed last because the new c library now processes zcc_opt.def with m4.               */
     /* With the crt first, the other .c files have not been processed yet and zcc_opt.def may not be complete.   */
     /*                                                                                                           */
-    /* To solve let's do something awkward.  Process the files starting at index one but go one larger than      */
-    /* the number of files.  When the one larger number is hit, set the index to zero to do the crt.             */
-    /*                                                                                                           */
-    /* This nastiness is marked "HACK" in the loop below.  Maybe something better will come along later.         */
-
-    /* Parse through the files, handling each one in turn */
-    for (i = 1; (i <= nfiles) && (i != 0); i += (i != 0)) { /* HACK 1 OF 2 */
-        char   temp_filename[FILENAME_MAX+1];
-        char   *ext;
-
-        if (i == nfiles) i = 0;                            /* HACK 2 OF 2 */
-        if (verbose) printf("\nPROCESSING %s\n", original_filenames[i]);
-    SWITCH_REPEAT:
-        switch (get_filetype_by_suffix(filelist[i]))
-        {
-        case M4FILE:
-            // Strip off the .m4 suffix and find the underlying extension
-            snprintf(temp_filename,sizeof(temp_filename),"%s", filelist[i]);
-            ext = find_file_ext(temp_filename);
-            if ( ext != NULL ) {
-                *ext = 0;
-                ext = find_file_ext(temp_filename);
-            }
-            if ( ext == NULL) ext = "";
-
-            if (process(".m4", ext, "m4", (m4arg == NULL) ? "" : m4arg, filter, i, YES, YES))
-                exit(1);
-            /* Disqualify recursive .m4 extensions */
-            ft = get_filetype_by_suffix(filelist[i]);
-            if (ft == M4FILE) {
-                fprintf(stderr, "Cannot process recursive .m4 file %s\n", original_filenames[i]);
-                exit(1);
-            }
-            if ( c_copy_m4_processed_files ) {
-                /* Write processed file to original source location immediately */		
-                 ptr = stripsuffix(original_filenames[i], ".m4");		
-                 if (copy_file(filelist[i], "", ptr, "")) {		
-                     fprintf(stderr, "Couldn't write output file %s\n", ptr);		
-                     exit(1);		
-                 }		
-                 /* Copied file becomes the new original file */		
-                 free(original_filenames[i]);		
-                 free(filelist[i]);		
-                 original_filenames[i] = ptr;		
-                 filelist[i] = muststrdup(ptr);
-            }
-            /* No more processing for .h and .inc files */
-            ft = get_filetype_by_suffix(filelist[i]);
-            if ((ft == HDRFILE) || (ft == INCFILE)) continue;
-            /* Continue processing macro expanded source file */
-            goto SWITCH_REPEAT;
-            break;
-        CASE_LLFILE:
-        case LLFILE:
-            if (m4only || clangonly) continue;
-            /* llvm-cbe translates llvm-ir to c */
-            if (zopt && process(".ll", ".opt.ll", "zopt", llvmopt, outspecified_flag, i, YES, NO))
-                exit(1);
-            if (process(".ll", ".cbe.c", c_llvm_exe, llvmarg, outspecified_flag, i, YES, NO))
-                exit(1);
-            /* Write .cbe.c to original directory immediately */
-            ptr = changesuffix(original_filenames[i], ".cbe.c");
-            if (copy_file(filelist[i], "", ptr, "")) {
-                fprintf(stderr, "Couldn't write output file %s\n", ptr);
-                exit(1);
-            }
-            /* Copied file becomes the new original file */
-            free(original_filenames[i]);
-            free(filelist[i]);
-            original_filenames[i] = ptr;
-            filelist[i] = muststrdup(ptr);
-        case CFILE:
-            if (m4only) continue;
-            /* special treatment for clang+llvm */
-            if ((strcmp(c_compiler_type, "clang") == 0) && !hassuffix(filelist[i], ".cbe.c")) {
-                if (process(".c", ".ll", c_clang_exe, clangarg, outspecified_flag, i, YES, NO))
-                    exit(1);
-                goto CASE_LLFILE;
-            }
-            if (clangonly || llvmonly) continue;
-            if (hassuffix(filelist[i], ".cbe.c"))
-                BuildOptions(&cpparg, clangcpparg);
-            /* past clang+llvm related pre-processing */
-            if (compiler_type == CC_SDCC) {
-                char zpragma_args[1024];
-                snprintf(zpragma_args, sizeof(zpragma_args),"-zcc-opt=\"%s\"", zcc_opt_def);
-                if (process(".c", ".i2", c_cpp_exe, cpparg, c_stylecpp, i, YES, YES))
-                    exit(1);
-                if (process(".i2", ".i", c_zpragma_exe, zpragma_args, filter, i, YES, NO))
-                    exit(1);
-            }
-            else {
-                char zpragma_args[1024];
-                snprintf(zpragma_args, sizeof(zpragma_args),"-sccz80 -zcc-opt=\"%s\"", zcc_opt_def);
-
-                if (process(".c", ".i2", c_cpp_exe, cpparg, c_stylecpp, i, YES, YES))
-                    exit(1);
-                if (process(".i2", ".i", c_zpragma_exe, zpragma_args, filter, i, YES, NO))
-                    exit(1);
-            }
-        case CPPFILE:
-            if (m4only || clangonly || llvmonly || preprocessonly) continue;
-            if (process(".i", ".opt", c_compiler, comparg, compiler_style, i, YES, NO))
-                exit(1);
-        case OPTFILE:
-            if (m4only || clangonly || llvmonly || preprocessonly) continue;
-            if (compiler_type == CC_SDCC) {
-                char  *rules[MAX_COPT_RULE_FILES];
-                int    num_rules = 0;
-
-                /* filter comments out of asz80 asm file see issue #801 on github */
-                if (peepholeopt) zsdcc_asm_filter_comments(i, ".op1");
-
-                /* sdcc_opt.9 bugfixes critical sections and implements RST substitution */
-                /* rules[num_rules++] = c_sdccopt9;                                      */
-
-                switch (peepholeopt)
-                {
-                case 0:
-                    rules[num_rules++] = c_sdccopt9;
-                    break;
-                case 1:
-                    rules[num_rules++] = c_sdccopt1;
-                    rules[num_rules++] = c_sdccopt9;
-                    break;
-                default:
-                    rules[num_rules++] = c_sdccopt1;
-                    rules[num_rules++] = c_sdccopt9;
-                    rules[num_rules++] = c_sdccopt2;
-                    break;
-                }
-
-                if ( c_coptrules_target ) {
-                    rules[num_rules++] = c_coptrules_target;
-                }
-
-                if ( coptrules_cpu ) {
-                    rules[num_rules++] = coptrules_cpu;
-                }
-
-                if ( c_coptrules_user ) {
-                    rules[num_rules++] = c_coptrules_user;
-                }
-
-
-
-                if (peepholeopt == 0)
-                    apply_copt_rules(i, num_rules, rules, ".opt", ".op1", ".s");
-                else
-                    apply_copt_rules(i, num_rules, rules, ".op1", ".opt", ".asm");
-            } else {
-                char  *rules[MAX_COPT_RULE_FILES];
-                int    num_rules = 0;
-
-                /* z80rules.9 implements intrinsics and RST substitution */
-                rules[num_rules++] = c_coptrules9;
-
-                switch (peepholeopt) {
-                case 0:
-                    break;
-                case 1:
-                    rules[num_rules++] = c_coptrules1;
-                    break;
-                case 2:
-                    rules[num_rules++] = c_coptrules2;
-                    rules[num_rules++] = c_coptrules1;
-                    break;
-                default:
-                    rules[num_rules++] = c_coptrules2;
-                    rules[num_rules++] = c_coptrules1;
-                    rules[num_rules++] = c_coptrules3;
-                    break;
-                }
-
-                if ( c_coptrules_target ) {
-                    rules[num_rules++] = c_coptrules_target;
-                }
-
-
-                if ( coptrules_cpu ) {
-                    rules[num_rules++] = coptrules_cpu;
-                }
-
-                if ( c_coptrules_sccz80 ) {
-                    rules[num_rules++] = c_coptrules_sccz80;
-                }
-
-                if ( c_coptrules_user ) {
-                    rules[num_rules++] = c_coptrules_user;
-                }
-
-                apply_copt_rules(i, num_rules, rules, ".opt", ".op1", ".asm");
-            }
-            /* continue processing if this is not a .s file */
-            if ((compiler_type != CC_SDCC) || (peepholeopt != 0))
-                goto CASE_ASMFILE;
-            /* user wants to stop at the .s file if stopping at assembly translation */
-            if (assembleonly) continue;
-        case SFILE:
-            if (m4only || clangonly || llvmonly || preprocessonly) continue;
-            /* filter comments out of asz80 asm file see issue #801 on github */
-            zsdcc_asm_filter_comments(i, ".s2");
-            if (process(".s2", ".asm", c_copt_exe, c_sdccopt1, filter, i, YES, NO))
-                exit(1);
-        CASE_ASMFILE:
-        case ASMFILE:
-            if (m4only || clangonly || llvmonly || preprocessonly || assembleonly)
-                continue;
-
-            /* See #16 on github.                                                                    */
-            /* z80asm is unable to output object files to an arbitrary destination directory.        */
-            /* We don't want to assemble files in their original source directory because that would */
-            /* create a temporary object file there which may accidentally overwrite user files.     */
-
-            /* Instead the plan is to copy the asm file to the temp directory and add the original   */
-            /* source directory to the include search path                                           */
-
-            BuildAsmLine(asmarg, sizeof(asmarg), " -s ");
+    /* To solve, process the files starting at index one and do the crt at index zero last.                     */
 
-            /* Check if source .asm file is in the temp directory already (indicates this is an intermediate file) */
-            ptr = changesuffix(temporary_filenames[i], ".asm");
-            if (strcmp(ptr, filelist[i]) == 0) {
-                free(ptr);
-                ptr = muststrdup(asmarg);
-            } else {
-                char *p, tmp[FILENAME_MAX*2 + 2];
-
-                /* copy .asm file to temp directory */
-                if (copy_file(filelist[i], "", ptr, "")) {
-                    fprintf(stderr, "Couldn't write output file %s\n", ptr);
-                    exit(1);
-                }
-
-                /* determine path to original source directory */
-                p = last_path_char(filelist[i]);
-
-                if (!is_path_absolute(filelist[i])) {
-                    int len;
-#ifdef WIN32
-                    if (_getcwd(tmp, sizeof(tmp) - 1) == NULL)
-                        *tmp = '\0';
-#else
-                    if (getcwd(tmp, sizeof(tmp) - 1) == NULL)
-                        *tmp = '\0';
-#endif
-                    if (p) {
-                        len = strlen(tmp);
-                        snprintf(tmp + len, sizeof(tmp) - len - 1, "/%.*s", (int)(p - filelist[i]), filelist[i]);
-                    }
-
-                    if (*tmp == '\0')
-                        strcpy(tmp, ".");
-                }
-                else if (p) {
-                    snprintf(tmp, sizeof(tmp) - 1, "%.*s", (int)(p - filelist[i]), filelist[i]);
-                } else {
-                    strcpy(tmp, ".");
-                }
-
-                /* working file is now the .asm file in the temp directory */
-                free(filelist[i]);
-                filelist[i] = ptr;
-
-                /* add original source directory to the include path */
-                ptr = mustmalloc((strlen(asmarg) + strlen(tmp) + 7) * sizeof(char));
-                sprintf(ptr, "%s -I\"%s\" ", asmarg, tmp);
-            }
-
-            /* insert module directive at front of .asm file see issue #46 on github                                                 */
-            /* this is a bit of a hack - foo.asm is copied to foo.tmp and then foo.tmp is written back to foo.asm with module header */
-
-            {
-                char *p, *q, tmp[FILENAME_MAX*2 + 100];
-
-                p = changesuffix(temporary_filenames[i], ".tmp");
-
-                if (copy_file(filelist[i], "", p, "")) {
-                    fprintf(stderr, "Couldn't write output file %s\n", p);
-                    exit(1);
-                }
-
-                if ((q = last_path_char(original_filenames[i])) != NULL )
-                    q++;
-                else
-                    q = original_filenames[i];
-
-                snprintf(tmp, sizeof(tmp) - 3, 
-						 "MODULE %s%s\n"
-                         "LINE 0, \"%s\"\n\n", 
-						isdigit(*q) ? "_" : "", q, original_filenames[i]);
-
-                /* change non-alnum chars in module name to underscore */
-
-                for (q = tmp+7; *q != '\n'; ++q)
-                    if (!isalnum(*q)) *q = '_';
-
-                if (prepend_file(p, "", filelist[i], "", tmp)) {
-                    fprintf(stderr, "Couldn't append output file %s\n", p);
-                    exit(1);
-                }
-
-                free(p);
-            }
-
-            /* must be late assembly for the first file when making a binary */
-            if ((i == 0) && build_bin)
-            {
-                c_crt_incpath = ptr;
-                if (verbose) printf("WILL ACT AS CRT\n");
-                continue;
-            }
-
-            if (process(".asm", c_extension, c_assembler, ptr, assembler_style, i, YES, NO))
-                exit(1);
-            free(ptr);
-            break;
-        case OBJFILE2:
-            if (process(".obj", c_extension, c_copycmd, "", filter_out, i, YES, YES))
-                exit(1);
-        case OBJFILE:
-            break;
-        default:
-            if (strcmp(filelist[i], original_filenames[i]) == 0)
-                fprintf(stderr, "Filetype of %s unrecognized\n", filelist[i]);
-            else
-                fprintf(stderr, "Filetype of %s (%s) unrecognized\n", filelist[i], original_filenames[i]);
-            exit(1);
-        }
-    }
+    /* Parse through the files, handling each one in turn, the crt last */
+    /* Each file writes its pragmas to its own fragment, they are merged into zcc_opt.def for the crt */
+    if (c_jobs > 1 && nfiles > 2)
+        process_files_in_parallel(1, nfiles);
+    else
+        for (i = 1; i < nfiles; i++)
+            process_file_pragmas(i);
+    merge_pragmas(1, nfiles);
+    if (nfiles > 0)
+        process_file(0);
 
     if (verbose) printf("\nGENERATING OUTPUT\n");
 
@@ -1732,31 +1424,518 @@ int main(int argc, char **argv)
 }
 
 
-static void apply_copt_rules(int filenumber, int num, char **rules, char *ext1, char *ext2, char *ext)
+/* process_file - run file i through all the steps up to the object file */
+static void process_file(int i)
 {
-    char   argbuf[FILENAME_MAX+1];
-    int    i;
-    char  *input_ext;
-    char  *output_ext;
+    char   temp_filename[FILENAME_MAX+1];
+    char   asmarg[4096];    /* Hell, that should be long enough! */
+    char   *ext;
+    char   *ptr;
+    int    ft;
+
+    if (verbose) printf("\nPROCESSING %s\n", original_filenames[i]);
+SWITCH_REPEAT:
+    switch (get_filetype_by_suffix(filelist[i]))
+    {
+    case M4FILE:
+        // Strip off the .m4 suffix and find the underlying extension
+        snprintf(temp_filename,sizeof(temp_filename),"%s", filelist[i]);
+        ext = find_file_ext(temp_filename);
+        if ( ext != NULL ) {
+            *ext = 0;
+            ext = find_file_ext(temp_filename);
+        }
+        if ( ext == NULL) ext = "";
+
+        if (process(".m4", ext, "m4", (m4arg == NULL) ? "" : m4arg, filter, i, YES, YES))
+            exit(1);
+        /* Disqualify recursive .m4 extensions */
+        ft = get_filetype_by_suffix(filelist[i]);
+        if (ft == M4FILE) {
+            fprintf(stderr, "Cannot process recursive .m4 file %s\n", original_filenames[i]);
+            exit(1);
+        }
+        if ( c_copy_m4_processed_files ) {
+            /* Write processed file to original source location immediately */		
+             ptr = stripsuffix(original_filenames[i], ".m4");		
+             if (copy_file(filelist[i], "", ptr, "")) {		
+                 fprintf(stderr, "Couldn't write output file %s\n", ptr);		
+                 exit(1);		
+             }		
+             /* Copied file becomes the new original file */		
+             free(original_filenames[i]);		
+             free(filelist[i]);		
+             original_filenames[i] = ptr;		
+             filelist[i] = muststrdup(ptr);
+        }
+        /* No more processing for .h and .inc files */
+        ft = get_filetype_by_suffix(filelist[i]);
+        if ((ft == HDRFILE) || (ft == INCFILE)) return;
+        /* Continue processing macro expanded source file */
+        goto SWITCH_REPEAT;
+        break;
+    CASE_LLFILE:
+    case LLFILE:
+        if (m4only || clangonly) return;
+        /* llvm-cbe translates llvm-ir to c */
+        if (zopt && process(".ll", ".opt.ll", "zopt", llvmopt, outspecified_flag, i, YES, NO))
+            exit(1);
+        if (process(".ll", ".cbe.c", c_llvm_exe, llvmarg, outspecified_flag, i, YES, NO))
+            exit(1);
+        /* Write .cbe.c to original directory immediately */
+        ptr = changesuffix(original_filenames[i], ".cbe.c");
+        if (copy_file(filelist[i], "", ptr, "")) {
+            fprintf(stderr, "Couldn't write output file %s\n", ptr);
+            exit(1);
+        }
+        /* Copied file becomes the new original file */
+        free(original_filenames[i]);
+        free(filelist[i]);
+        original_filenames[i] = ptr;
+        filelist[i] = muststrdup(ptr);
+    case CFILE:
+        if (m4only) return;
+        /* special treatment for clang+llvm */
+        if ((strcmp(c_compiler_type, "clang") == 0) && !hassuffix(filelist[i], ".cbe.c")) {
+            if (process(".c", ".ll", c_clang_exe, clangarg, outspecified_flag, i, YES, NO))
+                exit(1);
+            goto CASE_LLFILE;
+        }
+        if (clangonly || llvmonly) return;
+        if (hassuffix(filelist[i], ".cbe.c"))
+            BuildOptions(&cpparg, clangcpparg);
+        /* past clang+llvm related pre-processing */
+        if (process(".c", ".i2", c_cpp_exe, cpparg, c_stylecpp, i, YES, YES))
+            exit(1);
+        if (filter_pragmas(i, compiler_type != CC_SDCC))
+            exit(1);
+    case CPPFILE:
+        if (m4only || clangonly || llvmonly || preprocessonly) return;
+        if (compiler_type == CC_SCCZ80) {
+            /* sccz80 adds its pragmas to the fragment of the file */
+            ptr = mustmalloc(strlen(comparg) + strlen(zcc_opt_def) + 16);
+            sprintf(ptr, "%s -zcc-opt=\"%s\"", comparg, zcc_opt_def);
+            if (process(".i", ".opt", c_compiler, ptr, compiler_style, i, YES, NO))
+                exit(1);
+            free(ptr);
+        }
+        else if (process(".i", ".opt", c_compiler, comparg, compiler_style, i, YES, NO))
+            exit(1);
+    case OPTFILE:
+        if (m4only || clangonly || llvmonly || preprocessonly) return;
+        if (compiler_type == CC_SDCC) {
+            char  *rules[MAX_COPT_RULE_FILES];
+            int    num_rules = 0;
+
+            /* filter comments out of asz80 asm file see issue #801 on github */
+            if (peepholeopt) zsdcc_asm_filter_comments(i, ".op1");
+
+            /* sdcc_opt.9 bugfixes critical sections and implements RST substitution */
+            /* rules[num_rules++] = c_sdccopt9;                                      */
+
+            switch (peepholeopt)
+            {
+            case 0:
+                rules[num_rules++] = c_sdccopt9;
+                break;
+            case 1:
+                rules[num_rules++] = c_sdccopt1;
+                rules[num_rules++] = c_sdccopt9;
+                break;
+            default:
+                rules[num_rules++] = c_sdccopt1;
+                rules[num_rules++] = c_sdccopt9;
+                rules[num_rules++] = c_sdccopt2;
+                break;
+            }
+
+            if ( c_coptrules_target ) {
+                rules[num_rules++] = c_coptrules_target;
+            }
+
+            if ( coptrules_cpu ) {
+                rules[num_rules++] = coptrules_cpu;
+            }
+
+            if ( c_coptrules_user ) {
+                rules[num_rules++] = c_coptrules_user;
+            }
+
 
-    for ( i = 0; i < num ; i++ ) {
-        if (i % 2 == 0) {
-            input_ext = ext1;
-            output_ext = ext2;
+
+            if (peepholeopt == 0)
+                apply_copt_rules(i, num_rules, rules, ".opt", ".s");
+            else
+                apply_copt_rules(i, num_rules, rules, ".op1", ".asm");
         } else {
-            input_ext = ext2;
-            output_ext = ext1;
+            char  *rules[MAX_COPT_RULE_FILES];
+            int    num_rules = 0;
+
+            /* z80rules.9 implements intrinsics and RST substitution */
+            rules[num_rules++] = c_coptrules9;
+
+            switch (peepholeopt) {
+            case 0:
+                break;
+            case 1:
+                rules[num_rules++] = c_coptrules1;
+                break;
+            case 2:
+                rules[num_rules++] = c_coptrules2;
+                rules[num_rules++] = c_coptrules1;
+                break;
+            default:
+                rules[num_rules++] = c_coptrules2;
+                rules[num_rules++] = c_coptrules1;
+                rules[num_rules++] = c_coptrules3;
+                break;
+            }
+
+            if ( c_coptrules_target ) {
+                rules[num_rules++] = c_coptrules_target;
+            }
+
+
+            if ( coptrules_cpu ) {
+                rules[num_rules++] = coptrules_cpu;
+            }
+
+            if ( c_coptrules_sccz80 ) {
+                rules[num_rules++] = c_coptrules_sccz80;
+            }
+
+            if ( c_coptrules_user ) {
+                rules[num_rules++] = c_coptrules_user;
+            }
+
+            apply_copt_rules(i, num_rules, rules, ".opt", ".asm");
+        }
+        /* continue processing if this is not a .s file */
+        if ((compiler_type != CC_SDCC) || (peepholeopt != 0))
+            goto CASE_ASMFILE;
+        /* user wants to stop at the .s file if stopping at assembly translation */
+        if (assembleonly) return;
+    case SFILE:
+        if (m4only || clangonly || llvmonly || preprocessonly) return;
+        /* filter comments out of asz80 asm file see issue #801 on github */
+        zsdcc_asm_filter_comments(i, ".s2");
+        if (process(".s2", ".asm", c_copt_exe, c_sdccopt1, filter, i, YES, NO))
+            exit(1);
+    CASE_ASMFILE:
+    case ASMFILE:
+        if (m4only || clangonly || llvmonly || preprocessonly || assembleonly)
+            return;
+
+        /* See #16 on github.                                                                    */
+        /* z80asm is unable to output object files to an arbitrary destination directory.        */
+        /* We don't want to assemble files in their original source directory because that would */
+        /* create a temporary object file there which may accidentally overwrite user files.     */
+
+        /* Instead the plan is to copy the asm file to the temp directory and add the original   */
+        /* source directory to the include search path                                           */
+
+        BuildAsmLine(asmarg, sizeof(asmarg), " -s ");
+
+        /* Check if source .asm file is in the temp directory already (indicates this is an intermediate file) */
+        ptr = changesuffix(temporary_filenames[i], ".asm");
+        if (strcmp(ptr, filelist[i]) == 0) {
+            free(ptr);
+            ptr = muststrdup(asmarg);
+        } else {
+            char *p, tmp[FILENAME_MAX*2 + 2];
+
+            /* copy .asm file to temp directory */
+            if (copy_file(filelist[i], "", ptr, "")) {
+                fprintf(stderr, "Couldn't write output file %s\n", ptr);
+                exit(1);
+            }
+
+            /* determine path to original source directory */
+            p = last_path_char(filelist[i]);
+
+            if (!is_path_absolute(filelist[i])) {
+                int len;
+#ifdef WIN32
+                if (_getcwd(tmp, sizeof(tmp) - 1) == NULL)
+                    *tmp = '\0';
+#else
+                if (getcwd(tmp, sizeof(tmp) - 1) == NULL)
+                    *tmp = '\0';
+#endif
+                if (p) {
+                    len = strlen(tmp);
+                    snprintf(tmp + len, sizeof(tmp) - len - 1, "/%.*s", (int)(p - filelist[i]), filelist[i]);
+                }
+
+                if (*tmp == '\0')
+                    strcpy(tmp, ".");
+            }
+            else if (p) {
+                snprintf(tmp, sizeof(tmp) - 1, "%.*s", (int)(p - filelist[i]), filelist[i]);
+            } else {
+                strcpy(tmp, ".");
+            }
+
+            /* working file is now the .asm file in the temp directory */
+            free(filelist[i]);
+            filelist[i] = ptr;
+
+            /* add original source directory to the include path */
+            ptr = mustmalloc((strlen(asmarg) + strlen(tmp) + 7) * sizeof(char));
+            sprintf(ptr, "%s -I\"%s\" ", asmarg, tmp);
+        }
+
+        /* insert module directive at front of .asm file see issue #46 on github                                                 */
+        /* this is a bit of a hack - foo.asm is copied to foo.tmp and then foo.tmp is written back to foo.asm with module header */
+
+        {
+            char *p, *q, tmp[FILENAME_MAX*2 + 100];
+
+            p = changesuffix(temporary_filenames[i], ".tmp");
+
+            if (copy_file(filelist[i], "", p, "")) {
+                fprintf(stderr, "Couldn't write output file %s\n", p);
+                exit(1);
+            }
+
+            if ((q = last_path_char(original_filenames[i])) != NULL )
+                q++;
+            else
+                q = original_filenames[i];
+
+            snprintf(tmp, sizeof(tmp) - 3, 
+						 "MODULE %s%s\n"
+                     "LINE 0, \"%s\"\n\n", 
+						isdigit(*q) ? "_" : "", q, original_filenames[i]);
+
+            /* change non-alnum chars in module name to underscore */
+
+            for (q = tmp+7; *q != '\n'; ++q)
+                if (!isalnum(*q)) *q = '_';
+
+            if (prepend_file(p, "", filelist[i], "", tmp)) {
+                fprintf(stderr, "Couldn't append output file %s\n", p);
+                exit(1);
+            }
+
+            free(p);
         }
 
-        if ( i == (num-1) ) {
-            output_ext = ext;
+        /* must be late assembly for the first file when making a binary */
+        if ((i == 0) && build_bin)
+        {
+            c_crt_incpath = ptr;
+            if (verbose) printf("WILL ACT AS CRT\n");
+            return;
         }
-        snprintf(argbuf,sizeof(argbuf),"%s %s %s", select_cpu(CPU_MAP_TOOL_COPT), coptarg ? coptarg : "", rules[i]);
-        if (process(input_ext, output_ext, c_copt_exe, argbuf, filter, filenumber, YES, NO))
+
+        if (process(".asm", c_extension, c_assembler, ptr, assembler_style, i, YES, NO))
+            exit(1);
+        free(ptr);
+        break;
+    case OBJFILE2:
+        if (process(".obj", c_extension, c_copycmd, "", filter_out, i, YES, YES))
             exit(1);
+    case OBJFILE:
+        break;
+    default:
+        if (strcmp(filelist[i], original_filenames[i]) == 0)
+            fprintf(stderr, "Filetype of %s unrecognized\n", filelist[i]);
+        else
+            fprintf(stderr, "Filetype of %s (%s) unrecognized\n", filelist[i], original_filenames[i]);
+        exit(1);
     }
 }
 
+#ifndef WIN32
+/* process_files_in_parallel - process files first..last-1 in up to c_jobs child processes.
+   Each child writes the pragmas of its file to its own zcc_opt.def fragment, as in a sequential build. */
+static void process_files_in_parallel(int first, int last)
+{
+    struct job {
+        pid_t   pid;
+        int     fd;                 /* pipe to read the final file names */
+        int     file;
+    } *jobs;
+    char    buffer[FILENAME_MAX * 2 + 2];
+    int     next = first, running = 0, failed = 0;
+    int     i, fds[2], status;
+    pid_t   pid;
+    ssize_t len;
+
+    jobs = mustmalloc(c_jobs * sizeof(*jobs));
+    for (i = 0; i < c_jobs; i++)
+        jobs[i].pid = 0;
+
+    while (running > 0 || (next < last && !failed)) {
+        /* start jobs on the free slots */
+        for (i = 0; i < c_jobs && next < last && !failed; i++) {
+            if (jobs[i].pid != 0)
+                continue;
+            fflush(stdout);
+            fflush(stderr);
+            if (pipe(fds) != 0 || (pid = fork()) < 0) {
+                fprintf(stderr, "Cannot start a parallel job for %s\n", original_filenames[next]);
+                exit(1);
+            }
+            if (pid == 0) {
+                /* child: the parent owns the temporary files */
+                close(fds[0]);
+                cleanup = 0;
+                process_file_pragmas(next);
+                /* send back the new names of the file */
+                len = snprintf(buffer, sizeof(buffer), "%s%c%s", filelist[next], 0, original_filenames[next]);
+                if (write(fds[1], buffer, len + 1) != len + 1)
+                    exit(1);
+                close(fds[1]);
+                exit(0);
+            }
+            close(fds[1]);
+            jobs[i].pid = pid;
+            jobs[i].fd = fds[0];
+            jobs[i].file = next++;
+            running++;
+        }
+
+        /* wait for one job to finish */
+        if ((pid = wait(&status)) < 0)
+            break;
+        for (i = 0; i < c_jobs && jobs[i].pid != pid; i++)
+            ;
+        if (i == c_jobs)
+            continue;
+        running--;
+        jobs[i].pid = 0;
+        len = read(jobs[i].fd, buffer, sizeof(buffer) - 1);
+        close(jobs[i].fd);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || len <= 0) {
+            failed = 1;
+            continue;
+        }
+        buffer[len] = 0;
+        free(filelist[jobs[i].file]);
+        filelist[jobs[i].file] = muststrdup(buffer);
+        if (strcmp(original_filenames[jobs[i].file], buffer + strlen(buffer) + 1) != 0) {
+            free(original_filenames[jobs[i].file]);
+            original_filenames[jobs[i].file] = muststrdup(buffer + strlen(buffer) + 1);
+        }
+    }
+    free(jobs);
+    if (failed)
+        exit(1);
+}
+#else
+/* no fork() on Windows, process the files one after the other */
+static void process_files_in_parallel(int first, int last)
+{
+    int  i;
+
+    for (i = first; i < last; i++)
+        process_file_pragmas(i);
+}
+#endif
+
+/* process_file_pragmas - process a file writing its pragmas to its own zcc_opt.def fragment */
+static void process_file_pragmas(int i)
+{
+    char   *saved = zcc_opt_def;
+
+    zcc_opt_def = changesuffix(temporary_filenames[i], ".zop");
+    remove(zcc_opt_def);
+    process_file(i);
+    free(zcc_opt_def);
+    zcc_opt_def = saved;
+}
+
+/* merge_pragmas - merge the fragments of files first..last-1 into zcc_opt.def in file order,
+   a pragma repeated by several files is written once, conflicting ones are reported */
+static void merge_pragmas(int first, int last)
+{
+    pragma_set *pragmas = pragma_set_new();
+    char       *zop;
+    int         i;
+
+    if (verbose) printf("Merging the pragmas into \"%s\" in process\n", zcc_opt_def);
+    pragma_read(pragmas, zcc_opt_def, "the command line");
+    for (i = first; i < last; i++) {
+        zop = changesuffix(temporary_filenames[i], ".zop");
+        pragma_read(pragmas, zop, original_filenames[i]);
+        remove(zop);
+        free(zop);
+    }
+    if (pragma_write(pragmas, zcc_opt_def, "w")) {
+        fprintf(stderr, "Could not write %s\n", zcc_opt_def);
+        exit(1);
+    }
+    pragma_set_free(pragmas);
+}
+
+/* filter_pragmas - the .i2 to .i step: collect the pragmas of the preprocessed file, done in process */
+static int filter_pragmas(int number, int sccz80_mode)
+{
+    pragma_set *pragmas;
+    FILE       *in, *out;
+    char       *outname;
+    int         errs = 0;
+
+    if (!hassuffix(filelist[number], ".i2"))
+        return 0;
+
+    outname = changesuffix(temporary_filenames[number], ".i");
+    if (verbose) {
+        printf("Filtering the pragmas of \"%s\" into \"%s\" in process\n", filelist[number], outname);
+        fflush(stdout);
+    }
+    if ((in = fopen(filelist[number], "r")) == NULL) {
+        fprintf(stderr, "Cannot open %s\n", filelist[number]);
+        free(outname);
+        return 1;
+    }
+    if ((out = fopen(outname, "w")) == NULL) {
+        fprintf(stderr, "Cannot create %s\n", outname);
+        fclose(in);
+        free(outname);
+        return 1;
+    }
+
+    pragmas = pragma_set_new();
+    pragma_filter(pragmas, in, out, sccz80_mode);
+    fclose(in);
+    if (fclose(out) != 0 || pragma_write(pragmas, zcc_opt_def, "a")) {
+        fprintf(stderr, "Cannot write the pragmas of %s\n", original_filenames[number]);
+        errs = 1;
+    }
+    pragma_set_free(pragmas);
+
+    if (errs) {
+        free(outname);
+    }
+    else {
+        free(filelist[number]);
+        filelist[number] = outname;
+    }
+    return errs;
+}
+
+static void apply_copt_rules(int filenumber, int num, char **rules, char *ext1, char *ext)
+{
+    char   argbuf[FILENAME_MAX+1];
+    size_t len;
+    int    i;
+
+    /* one copt process applies each rule file in turn, separated by -s */
+    len = snprintf(argbuf,sizeof(argbuf),"%s %s", select_cpu(CPU_MAP_TOOL_COPT), coptarg ? coptarg : "");
+    for ( i = 0; i < num && len < sizeof(argbuf); i++ ) {
+        len += snprintf(argbuf + len, sizeof(argbuf) - len, "%s%s", i == 0 ? " " : " -s ", rules[i]);
+    }
+    if ( len >= sizeof(argbuf) ) {
+        fprintf(stderr, "Error: copt rule file list too long\n");
+        exit(1);
+    }
+    if (process(ext1, ext, c_copt_exe, argbuf, filter, filenumber, YES, NO))
+        exit(1);
+}
+
 
 /* filter comments out of asz80 asm file see issue #801 on github */
 void zsdcc_asm_filter_comments(int filenumber, char *ext)
@@ -2871,7 +3050,7 @@ static void configure_compiler()
                 BuildOptions(&asmargs, "-D__SCCZ80");
                 BuildOptions(&linkargs, "-D__SCCZ80");
         /* Indicate to sccz80 what assembler we want */
-        snprintf(buf, sizeof(buf), "-ext=opt %s -zcc-opt=\"%s\"", select_cpu(CPU_MAP_TOOL_SCCZ80),zcc_opt_def);
+        snprintf(buf, sizeof(buf), "-ext=opt %s", select_cpu(CPU_MAP_TOOL_SCCZ80));
         add_option_to_compiler(buf);
 
         if (sccz80arg) {
@@ -2888,6 +3067,19 @@ static void configure_compiler()
         if ( c_generate_debug_info) {
             add_option_to_compiler("-debug-defc");
         }
+        if (c_cpp_snapshot_dir && strstr(c_cpp_exe, "ucpp") != NULL) {
+            /* ucpp keys the snapshots by its options, so targets can share the directory */
+            char *arg = mustmalloc(strlen(c_cpp_snapshot_dir) + 16);
+
+#ifdef WIN32
+            mkdir(c_cpp_snapshot_dir);
+#else
+            mkdir(c_cpp_snapshot_dir, 0777);
+#endif
+            sprintf(arg, "-snapshot \"%s\"", c_cpp_snapshot_dir);
+            BuildOptions(&cpparg, arg);
+            free(arg);
+        }
         c_compiler = c_sccz80_exe;
         compiler_style = outspecified_flag;
     } else {
@@ -3108,6 +3300,7 @@ void remove_temporary_files(void)
             remove_file_with_extension(temporary_filenames[j], ".def");
             remove_file_with_extension(temporary_filenames[j], ".tmp");
             remove_file_with_extension(temporary_filenames[j], ".lis");
+            remove_file_with_extension(temporary_filenames[j], ".zop");
         }
         /* Cleanup zcc_opt files */
         remove(zcc_opt_def);
@@ -0,0 +1,704 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include "pragma.h"
+
+#define NAMESIZE 256
+
+typedef struct block_s {
+    char           *key;        /* first line of the block */
+    char           *text;       /* whole block, from the IF to the ENDIF */
+    char           *origin;     /* where it was seen first */
+    int             guarded;    /* only the first block with this key has any effect */
+    struct block_s *next;
+} block;
+
+struct pragma_set_s {
+    block          *first;
+    block         **last;
+};
+
+static char buf[65536];
+
+static char filename[FILENAME_MAX+1];
+static int  lineno = 0;
+
+/* Block being built */
+static char   *block_text = NULL;
+static size_t  block_len = 0, block_size = 0;
+
+
+static void *must_malloc(size_t size)
+{
+    void *ptr = malloc(size);
+
+    if ( ptr == NULL ) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static char *must_strdup(const char *s)
+{
+    return strcpy(must_malloc(strlen(s) + 1), s);
+}
+
+static char *skip_ws(char *ptr)
+{
+    while ( isspace(*ptr) ) {
+        ptr++;
+    }
+    return ptr;
+}
+
+static void strip_nl(char *ptr)
+{
+    char *nl;
+    if ( ( nl = strchr(ptr,'\n') ) != NULL || (nl = strchr(ptr,'\r')) != NULL ) {
+        *nl = 0;
+    }
+}
+
+static void first_word_only(char *ptr)
+{
+    while (!isspace(*ptr))
+        ++ptr;
+    *ptr = 0;
+}
+
+static void begin_block(void)
+{
+    block_len = 0;
+    if ( block_text == NULL ) {
+        block_size = 1024;
+        block_text = must_malloc(block_size);
+    }
+    block_text[0] = 0;
+}
+
+static void add_text(const char *fmt, ...)
+{
+    va_list ap;
+    int     len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(block_text + block_len, block_size - block_len, fmt, ap);
+    va_end(ap);
+
+    if ( block_len + len >= block_size ) {
+        while ( block_len + len >= block_size )
+            block_size *= 2;
+        block_text = realloc(block_text, block_size);
+        if ( block_text == NULL ) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        va_start(ap, fmt);
+        vsnprintf(block_text + block_len, block_size - block_len, fmt, ap);
+        va_end(ap);
+    }
+    block_len += len;
+}
+
+/* The value given to name by a "defc name = value" line of the block, NULL if none */
+static char *defc_value(const char *text, const char *name, size_t name_len, size_t *value_len)
+{
+    const char *ptr = text;
+
+    while ( ptr != NULL && *ptr ) {
+        while ( *ptr == ' ' || *ptr == '\t' )
+            ptr++;
+        if ( strncmp(ptr, "defc", 4) == 0 && isspace(ptr[4]) ) {
+            ptr += 4;
+            while ( *ptr == ' ' || *ptr == '\t' )
+                ptr++;
+            if ( strncmp(ptr, name, name_len) == 0 ) {
+                ptr += name_len;
+                while ( *ptr == ' ' || *ptr == '\t' )
+                    ptr++;
+                if ( *ptr == '=' ) {
+                    const char *end;
+
+                    ptr = skip_ws((char *)ptr + 1);
+                    end = strchr(ptr, '\n');
+                    if ( end == NULL )
+                        end = ptr + strlen(ptr);
+                    while ( end > ptr && isspace(end[-1]) )
+                        end--;
+                    *value_len = end - ptr;
+                    return (char *)ptr;
+                }
+            }
+        }
+        if ( (ptr = strchr(ptr, '\n')) != NULL )
+            ptr++;
+    }
+    return NULL;
+}
+
+/* Two guarded blocks for the same name that only differ in the way the value is written */
+static int same_value(const char *key, const char *text1, const char *text2)
+{
+    const char *name = key + 4;
+    char       *v1, *v2, *end1, *end2;
+    size_t      name_len, len1, len2;
+
+    if ( strncmp(name, "DEFINED_", 8) != 0 )
+        return 0;
+    name += 8;
+    name_len = strlen(name);
+    if ( (v1 = defc_value(text1, name, name_len, &len1)) == NULL ||
+         (v2 = defc_value(text2, name, name_len, &len2)) == NULL )
+        return 0;
+    if ( len1 == len2 && strncmp(v1, v2, len1) == 0 )
+        return 1;
+    return strtol(v1, &end1, 0) == strtol(v2, &end2, 0) && end1 == v1 + len1 && end2 == v2 + len2;
+}
+
+static void add_block(pragma_set *set, const char *origin)
+{
+    block  *b;
+    char   *nl;
+    int     guarded;
+    size_t  key_len;
+
+    if ( block_len == 0 )
+        return;
+
+    nl = strchr(block_text, '\n');
+    key_len = nl ? (size_t)(nl - block_text) : block_len;
+    while ( key_len > 0 && isspace(block_text[key_len - 1]) )
+        key_len--;
+
+    /* IF !DEFINED_x / IF !NEED_x without an ELSE that adds to the first value */
+    guarded = strncmp(block_text, "IF !", 4) == 0 && strstr(block_text, "\nELSE\n") == NULL;
+
+    for ( b = set->first; b != NULL; b = b->next ) {
+        if ( strlen(b->key) != key_len || strncmp(b->key, block_text, key_len) != 0 )
+            continue;
+        if ( strcmp(b->text, block_text) == 0 )
+            return;
+        if ( guarded && b->guarded ) {
+            char *name = b->key + 4;
+
+            if ( same_value(b->key, b->text, block_text) )
+                return;
+            if ( strncmp(name, "DEFINED_", 8) == 0 )
+                name += 8;
+            fprintf(stderr, "%s: warning: conflicting #pragma for %s ignored, using the one from %s\n", origin, name, b->origin);
+            return;
+        }
+    }
+
+    b = must_malloc(sizeof(*b));
+    b->key = must_malloc(key_len + 1);
+    memcpy(b->key, block_text, key_len);
+    b->key[key_len] = 0;
+    b->text = must_strdup(block_text);
+    b->origin = must_strdup(origin);
+    b->guarded = guarded;
+    b->next = NULL;
+    *set->last = b;
+    set->last = &b->next;
+}
+
+/* Add the block built from a #pragma at the current line */
+static void add_pragma_block(pragma_set *set)
+{
+    char origin[FILENAME_MAX + 32];
+
+    snprintf(origin, sizeof(origin), "%s:%d", filename, lineno);
+    add_block(set, origin);
+}
+
+pragma_set *pragma_set_new(void)
+{
+    pragma_set *set = must_malloc(sizeof(*set));
+
+    set->first = NULL;
+    set->last = &set->first;
+    return set;
+}
+
+void pragma_set_free(pragma_set *set)
+{
+    block *b, *next;
+
+    for ( b = set->first; b != NULL; b = next ) {
+        next = b->next;
+        free(b->key);
+        free(b->text);
+        free(b->origin);
+        free(b);
+    }
+    free(set);
+}
+
+/*
+ * Dump some text into the zcc_opt.def, this allows us to define some
+ * things that the startup code might need
+ */
+
+static void write_pragma_string(pragma_set *set, char *ptr)
+{
+    char *text;
+
+    ptr = skip_ws(ptr);
+    strip_nl(ptr);
+    text = strchr(ptr,' ');
+    if ( text == NULL ) text = strchr(ptr,'\t');
+
+    if ( text != NULL ) {
+        *text = 0;
+        text++;
+        text = skip_ws(text);
+        begin_block();
+        add_text("IF NEED_%s\n",ptr);
+        add_text("\tdefm\t\"%s\"\n",text);
+        add_text("\tdefc DEFINED_NEED_%s = 1\n",ptr);
+        add_text("ENDIF\n");
+        add_pragma_block(set);
+    }
+}
+
+/* Dump some bytes into the zcc_opt.def file */
+
+static void write_bytes(pragma_set *set, char *line, int flag)
+{
+    char    sname[NAMESIZE+1];
+    char   *ptr;
+    long value;
+    int     count;
+
+    ptr = sname;
+    while ( isalpha(*line) && ( ptr - sname) < NAMESIZE ) {
+        *ptr++ = *line++;
+    }
+    *ptr = 0;
+
+    if ( strlen(sname) ) {
+        begin_block();
+        add_text("IF NEED_%s\n",sname);
+        if ( flag ) {
+            add_text("\tdefc DEFINED_NEED_%s = 1\n",sname);
+        }
+
+        /* Now, do the numbers */
+        count=0;
+        ptr = skip_ws(line);
+
+        while ( *line != ';' ) {
+            char *end;
+
+            if ( count == 0 ) {
+                add_text("\n\tdefb\t");
+            } else {
+                add_text(",");
+            }
+
+            value = strtol(line, &end, 0);
+
+            if ( end != line ) {
+                add_text("%ld",value);
+            } else {
+                fprintf(stderr, "%s:%d Invalid number format %.10s\n",filename, lineno, line);
+                break;
+            }
+            line = skip_ws(end);
+
+            if ( *line == ';' ) {
+                break;
+            } else if ( *line != ',' ) {
+                fprintf(stderr, "%s:%d Invalid syntax for #pragma line\n", filename, lineno);
+                break;
+            }
+            line = skip_ws(line);
+            count++;
+            if ( count == 9 ) count=0;
+        }
+        add_text("\nENDIF\n");
+        add_pragma_block(set);
+    }
+}
+
+
+static void write_defined(pragma_set *set, char *sname, int32_t value, int export)
+{
+    strip_nl(sname);
+
+    begin_block();
+    add_text("IF !DEFINED_%s\n",sname);
+    add_text("\tdefc\tDEFINED_%s = 1\n",sname);
+    if (export) add_text("\tPUBLIC\t%s\n", sname);
+    if ( value < 0 ) {
+        add_text("\tdefc %s = %d\n",sname,value);
+    } else {
+        add_text("\tdefc %s = %0#x\n",sname,value);
+    }
+    add_text("\tIFNDEF %s\n\tENDIF\n",sname);
+    add_text("ENDIF\n");
+    add_pragma_block(set);
+}
+
+static void write_redirect(pragma_set *set, char *sname, char *value)
+{
+    strip_nl(sname);
+    value = skip_ws(value);
+    first_word_only(value);
+    begin_block();
+    add_text("IF !DEFINED_%s\n",sname);
+    add_text("\tPUBLIC %s\n",sname);
+    add_text("\tEXTERN %s\n",value);
+    add_text("\tdefc\tDEFINED_%s = 1\n",sname);
+    add_text("\tdefc %s = %s\n",sname,value);
+    add_text("ENDIF\n");
+    add_pragma_block(set);
+}
+
+typedef struct convspec_s {
+    char fmt;
+    char complex;
+    uint32_t val;
+    uint32_t lval;
+    uint32_t llval;
+} CONVSPEC;
+
+static CONVSPEC printf_formats[] = {
+    { 'd', 1, 0x01, 0x1000, 0x01 },
+    { 'u', 1, 0x02, 0x2000, 0x02 },
+    { 'x', 2, 0x04, 0x4000, 0x04 },
+    { 'X', 2, 0x08, 0x8000, 0x08 },
+    { 'o', 2, 0x10, 0x10000, 0x10 },
+    { 'n', 2, 0x20, 0x20000, 0 },
+    { 'i', 2, 0x40, 0x40000, 0x40 },
+    { 'p', 2, 0x80, 0x80000, 0 },
+    { 'B', 2, 0x100, 0x100000, 0 },
+    { 's', 1, 0x200, 0, 0 },
+    { 'c', 1, 0x400, 0, 0 },
+    { 'I', 0, 0x800, 0, 0 },
+    { 'a', 0, 0x400000, 0x400000, 0 },
+    { 'A', 0, 0x800000, 0x800000, 0 },
+    { 'e', 3, 0x1000000, 0x1000000, 0 },
+    { 'E', 3, 0x2000000, 0x2000000, 0 },
+    { 'f', 3, 0x4000000, 0x4000000, 0 },
+    { 'F', 3, 0x8000000, 0x8000000, 0 },
+    { 'g', 3, 0x10000000, 0x10000000, 0 },
+    { 'G', 3, 0x20000000, 0x20000000, 0 },
+    { 0, 0, 0, 0 }
+};
+
+static CONVSPEC scanf_formats[] = {
+    { 'd', 1, 0x01, 0x1000, 0x01 },
+    { 'u', 1, 0x02, 0x2000, 0x02 },
+    { 'x', 2, 0x04, 0x4000, 0x04 },
+    { 'X', 2, 0x08, 0x8000, 0x08 },
+    { 'o', 2, 0x10, 0x10000, 0x10 },
+    { 'n', 2, 0x20, 0x20000, 0 },
+    { 'i', 2, 0x40, 0x40000, 0x40 },
+    { 'p', 2, 0x80, 0x80000, 0 },
+    { 'B', 2, 0x100, 0x100000, 0 },
+    { 's', 1, 0x200, 0, 0 },
+    { 'c', 1, 0x400, 0, 0 },
+    { 'I', 0, 0x800, 0, 0 },
+    { '[', 0, 0x200000, 0x200000, 0},
+    { 'a', 0, 0x400000, 0x400000, 0 },
+    { 'A', 0, 0x800000, 0x800000, 0 },
+    { 'e', 3, 0x1000000, 0x1000000, 0 },
+    { 'E', 3, 0x2000000, 0x2000000, 0 },
+    { 'f', 3, 0x4000000, 0x4000000, 0 },
+    { 'F', 3, 0x8000000, 0x8000000, 0 },
+    { 'g', 3, 0x10000000, 0x10000000, 0 },
+    { 'G', 3, 0x20000000, 0x20000000, 0 },
+    { 0, 0, 0, 0 }
+};
+
+static uint64_t parse_format_string(char *arg, CONVSPEC *specifiers)
+{
+    char c;
+    int complex, islong;
+    uint64_t format_option = 0;
+    CONVSPEC *fmt;
+
+    for (complex = 1; (c = *arg); ++arg)
+    {
+        if (c == '/')
+            break;
+
+        if ((c == '%') || isspace(c) || (c == '"') || (c == '='))
+            continue;
+
+        if (*arg == '-' || *arg == '0' || *arg == '+' || *arg == ' ' || *arg == '*' || *arg == '.')
+        {
+            if (complex < 2)
+                complex = 2; /* Switch to standard */
+            format_option |= 0x40000000;
+            while (!isalpha(*arg))
+                arg++;
+        }
+        else if (isdigit(*arg))
+        {
+            if (complex < 2)
+                complex = 2; /* Switch to standard */
+            format_option |= 0x40000000;
+            while (isdigit(*arg) || *arg == '.')
+                arg++;
+        }
+
+        islong = 0;
+        if (*arg == 'l')
+        {
+            if (complex < 2)
+                complex = 2;
+            arg++;
+            islong = 1;
+            if (*arg == 'l')
+            {
+                arg++;
+                islong = 2;
+            }
+        } else if ( *arg == 'h' ) {
+            arg++;
+            if ( *arg == 'h' ) arg++;
+        } else if ( *arg == 'z' ) {
+            arg++;
+        }
+
+        fmt = specifiers;
+        while (fmt->fmt)
+        {
+            if (fmt->fmt == *arg)
+            {
+                if (complex < fmt->complex)
+                    complex = fmt->complex;
+                switch (islong)
+                {
+                case 0:
+                    format_option |= fmt->val;
+                    break;
+                case 1:
+                    format_option |= fmt->lval;
+                    break;
+                default:
+                    format_option |= (uint64_t)(fmt->llval) << 32;
+                    break;
+                }
+                break;
+            }
+            fmt++;
+        }
+        if (fmt->fmt == 0)
+            fprintf(stderr, "Ignoring unrecognized %s format specifier %%%c\n", (specifiers == printf_formats) ? "printf" : "scanf", *arg);
+    }
+
+    return format_option;
+}
+
+static void put(const char *s, FILE *out)
+{
+    if ( out != NULL )
+        fputs(s, out);
+}
+
+void pragma_filter(pragma_set *set, FILE *in, FILE *out, int sccz80_mode)
+{
+    char   *ptr;
+
+    strcpy(filename,"<stdin>");
+    lineno = 0;
+
+    while ( fgets(buf, sizeof(buf) - 1, in) != NULL ) {
+        lineno++;
+        ptr = skip_ws(buf);
+        if ( strncmp(ptr,"#pragma", 7) == 0 ) {
+            int  ol = 1;
+
+            if ( ptr[7] == '-' )
+                ptr++;
+            ptr = skip_ws(ptr + 7);
+
+            if ( ( strncmp(ptr, "output",6) == 0 ) || ( strncmp(ptr, "define",6) == 0 ) || ( strncmp(ptr, "export",6) == 0 ) ) {
+                char *offs;
+                int   value = 0;
+                int   exp = strncmp(ptr, "export",6) == 0;
+
+                if (ispunct(ptr[6]))
+                    ptr++;
+
+                ptr = skip_ws(ptr+6);
+
+                if ( (offs = strchr(ptr+1,'=') ) != NULL  ) {
+                    value = (int)strtol(offs+1,NULL,0);
+                    *offs = 0;
+                }
+                write_defined(set,ptr,value,exp);
+                if ( strncmp(ptr, "STACKPTR",8) == 0 ) {
+                    write_defined(set,"REGISTER_SP",value,exp);
+                }
+                if ( strncmp(ptr, "nostreams",9) == 0 ) {
+                    write_defined(set,"CRT_ENABLE_STDIO",0,exp);
+                }
+            } else if ( strncmp(ptr, "redirect",8) == 0 ) {
+                char *offs;
+                char *value = "0";
+
+                if (ispunct(ptr[8]))
+                    ptr++;
+                ptr = skip_ws(ptr+8);
+                if ( (offs = strchr(ptr+1,'=') ) != NULL  ) {
+                    value = offs + 1;
+                    *offs = 0;
+                }
+                write_redirect(set,ptr,value);
+            } else if ( strncmp(ptr,"printf", 6) == 0 ) {
+                uint64_t value = parse_format_string(ptr + 6, printf_formats);
+                write_defined(set,"CLIB_OPT_PRINTF", (int32_t)(value & 0xffffffff), 0);
+                write_defined(set,"CLIB_OPT_PRINTF_2", (int32_t)((value >> 32) & 0xffffffff), 0);
+            } else if ( strncmp(ptr,"scanf", 5) == 0 ) {
+                uint64_t value = parse_format_string(ptr + 5, scanf_formats);
+                write_defined(set,"CLIB_OPT_SCANF", (int32_t)(value & 0xffffffff), 0);
+                write_defined(set,"CLIB_OPT_SCANF_2", (int32_t)((value >> 32) & 0xffffffff), 0);
+            } else if ( strncmp(ptr,"string",6) == 0 ) {
+                write_pragma_string(set,ptr + 6);
+            } else if ( strncmp(ptr, "data", 4) == 0 && isspace(*(ptr+4)) ) {
+                write_bytes(set,ptr + 4, 1);
+            } else if ( strncmp(ptr, "byte", 4) == 0 ) {
+                write_bytes(set,ptr + 4, 0);
+            } else if ( sccz80_mode == 0 && strncmp(ptr, "asm", 3) == 0 ) {
+                put("__asm\n",out);
+                ol = 0;
+            } else if ( sccz80_mode == 0 && strncmp(ptr, "endasm", 6) == 0 ) {
+                put("__endasm;\n",out);
+                ol = 0;
+            } else if ( sccz80_mode == 1 && strncmp(ptr, "asm", 3) == 0 ) {
+                put("#asm\n",out);
+                ol = 0;
+            } else if ( sccz80_mode == 1 && strncmp(ptr, "endasm", 6) == 0 ) {
+                put("#endasm\n",out);
+                ol = 0;
+            } else if (strncmp(ptr, "-zorg=", 6) == 0 ) {
+                /* It's an option, this may tweak something */
+                write_defined(set,"CRT_ORG_CODE", strtol(ptr+6, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-reqpag=", 8) == 0 ) {
+                write_defined(set,"CRT_Z88_BADPAGES", strtol(ptr+8, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-defvars=", 8) == 0 ) {
+                write_defined(set,"defvarsaddr", strtol(ptr+8, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-safedata=", 10) == 0 ) {
+                write_defined(set,"CRT_Z88_SAFEDATA", strtol(ptr+9, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-startup=", 9) == 0 ) {
+                write_defined(set,"startup", strtol(ptr+9, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-farheap=", 9) == 0 ) {
+                write_defined(set,"farheapsz", strtol(ptr+9, NULL, 0), 0);
+            } else if ( strncmp(ptr, "-expandz88", 9) == 0 ) {
+                write_defined(set,"CRT_Z88_EXPANDED", 1, 0);
+            } else if ( strncmp(ptr, "-no-expandz88", 9) == 0 ) {
+                write_defined(set,"CRT_Z88_EXPANDED", 0, 0);
+            } else if ( out != NULL ) {
+                fprintf(out,"%s\n",buf);
+            }
+            if ( ol ) {
+                put("\n",out);
+            }
+        } else if ( sccz80_mode == 0 && strncmp(ptr, "#asm", 4) == 0 ) {
+            put("__asm\n",out);
+        } else if ( sccz80_mode == 0 && strncmp(ptr, "#endasm", 7) == 0 ) {
+            put("__endasm;\n",out);
+        } else if ( sccz80_mode == 1 && strncmp(ptr, "__asm", 5) == 0 && strncmp(ptr,"__asm__", 7) ) {
+            put("#asm\n",out);
+        } else if ( sccz80_mode == 1 && strncmp(ptr, "__endasm", 8) == 0 ) {
+            put("#endasm;\n",out);
+        } else {
+            int skip = 0;
+            if ( (skip=2, strncmp(ptr,"# ",2) == 0)  || ( skip=5, strncmp(ptr,"#line",5) == 0) ) {
+                int     num=0;
+                char    tmp[FILENAME_MAX+1];
+
+                ptr = skip_ws(ptr + skip);
+
+                tmp[0]=0;
+                sscanf(ptr,"%d %s",&num,tmp);
+                if   (num) lineno=--num;
+                /* The preprocessor quotes the name, keep it without the quotes */
+                while ( isdigit(*ptr) ) ptr++;
+                ptr = skip_ws(ptr);
+                if ( *ptr == '"' ) {
+                    char *end = strchr(++ptr, '"');
+                    size_t len = end != NULL ? (size_t)(end - ptr) : 0;
+
+                    if ( len > FILENAME_MAX ) len = FILENAME_MAX;
+                    memcpy(tmp, ptr, len);
+                    tmp[len] = 0;
+                }
+                if      (strlen(tmp)) strcpy(filename,tmp);
+            }
+
+            put(buf,out);
+        }
+    }
+}
+
+/* A zcc_opt.def file is a sequence of IF..ENDIF blocks, other text is kept as it is */
+int pragma_read(pragma_set *set, const char *zcc_opt, const char *origin)
+{
+    FILE   *fp;
+    int     depth = 0;
+
+    if ( (fp = fopen(zcc_opt, "r")) == NULL )
+        return 1;
+
+    begin_block();
+    while ( fgets(buf, sizeof(buf) - 1, fp) != NULL ) {
+        char *ptr = skip_ws(buf);
+        char *end = ptr;
+        size_t len;
+
+        strip_nl(buf);
+        while ( isalpha(*end) )
+            end++;
+        len = end - ptr;
+
+        if ( depth == 0 ) {
+            if ( *ptr == 0 ) {
+                add_block(set, origin);
+                begin_block();
+                continue;
+            }
+            if ( len == 2 && strncmp(ptr, "IF", 2) == 0 ) {
+                add_block(set, origin);
+                begin_block();
+            }
+        }
+        add_text("%s\n", buf);
+
+        if ( (len == 2 && strncmp(ptr, "IF", 2) == 0) ||
+             (len == 5 && strncmp(ptr, "IFDEF", 5) == 0) ||
+             (len == 6 && strncmp(ptr, "IFNDEF", 6) == 0) ) {
+            depth++;
+        } else if ( depth > 0 && len == 5 && strncmp(ptr, "ENDIF", 5) == 0 && --depth == 0 ) {
+            add_block(set, origin);
+            begin_block();
+        }
+    }
+    add_block(set, origin);
+    fclose(fp);
+    return 0;
+}
+
+int pragma_write(pragma_set *set, const char *zcc_opt, const char *mode)
+{
+    FILE   *fp;
+    block  *b;
+    int     err;
+
+    if ( (fp = fopen(zcc_opt, mode)) == NULL )
+        return 1;
+
+    for ( b = set->first; b != NULL; b = b->next )
+        fprintf(fp, "\n%s\n", b->text);
+
+    err = ferror(fp);
+    return fclose(fp) != 0 || err;
+}
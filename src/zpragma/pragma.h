@@ -0,0 +1,32 @@
+/*
+ * zpragma - filter the #pragmas out of a preprocessed C file and collect
+ * them as zcc_opt.def blocks, shared by z88dk-zpragma and zcc
+ *
+ * Each pragma becomes an assembler block keyed by its first line, eg.
+ * "IF !DEFINED_CRT_ORG_CODE". A set holds each block only once: a guarded
+ * block (IF !DEFINED_x / IF !NEED_x) seen again with different contents
+ * is a conflict, it is reported and dropped as the assembler would ignore
+ * it anyway, blocks that accumulate (IF NEED_x data, IF/ELSE that ORs a
+ * value) are kept unless they are identical.
+ */
+
+#ifndef ZPRAGMA_PRAGMA_H
+#define ZPRAGMA_PRAGMA_H
+
+#include <stdio.h>
+
+typedef struct pragma_set_s pragma_set;
+
+extern pragma_set *pragma_set_new(void);
+extern void        pragma_set_free(pragma_set *set);
+
+/* Copy in to out (if not NULL) converting the asm pragmas, collect the other pragmas in set */
+extern void        pragma_filter(pragma_set *set, FILE *in, FILE *out, int sccz80_mode);
+
+/* Add the blocks of a zcc_opt.def file, origin names it in conflict warnings; 1 if it cannot be read */
+extern int         pragma_read(pragma_set *set, const char *filename, const char *origin);
+
+/* Write the blocks to a zcc_opt.def file opened with mode "w" or "a"; 1 on error */
+extern int         pragma_write(pragma_set *set, const char *filename, const char *mode);
+
+#endif
@@ -0,0 +1,271 @@
+#!/usr/bin/perl
+
+#------------------------------------------------------------------------------
+# Cycle and code size benchmarks of the generated code
+#
+# Each subdirectory is a benchmark program, laid out like test/suites: the
+# C sources of the directory are built with zcc +test for every compiler
+# configuration and run under z88dk-ticks -profile. The cycles of every
+# function (including what it calls) come from the folded call stacks, its
+# code size from the map file. The results are compared with baseline.json
+# and any function beyond the thresholds is reported as a regression.
+#
+#   perl benchmark.pl [options] [benchmark...]
+#
+#   --config NAME=FLAGS   compiler configuration, may be repeated, replaces
+#                         the default ones
+#   --cflags FLAGS        more zcc options for all configurations
+#   --baseline FILE       baseline, default baseline.json
+#   --update              write the results as the new baseline
+#   --cycles-threshold N  percent of cycles allowed above the baseline (1)
+#   --size-threshold N    percent of code size allowed above the baseline (0)
+#
+# Exits with 1 if a benchmark fails or regresses.
+#------------------------------------------------------------------------------
+
+use 5.020;
+use warnings;
+no warnings "portable";			# 64 bit values in map files
+use Cwd qw( abs_path );
+use File::Basename;
+use File::Path qw( make_path );
+use FindBin;
+use Getopt::Long;
+use JSON::PP;
+
+my %default_configs = (
+	'sccz80'	=> '-compiler=sccz80',
+	'sccz80-O3'	=> '-compiler=sccz80 -O3',
+);
+
+my @config_opts;
+my $cflags = "";
+my $baseline_file = "$FindBin::Bin/baseline.json";
+my $update;
+my $cycles_threshold = 1;
+my $size_threshold = 0;
+
+GetOptions(
+	"config=s"				=> \@config_opts,
+	"cflags=s"				=> \$cflags,
+	"baseline=s"			=> \$baseline_file,
+	"update"				=> \$update,
+	"cycles-threshold=f"	=> \$cycles_threshold,
+	"size-threshold=f"		=> \$size_threshold,
+) or die "Usage: perl $0 [--config NAME=FLAGS]... [--cflags FLAGS] [--baseline FILE] [--update] ".
+		 "[--cycles-threshold N] [--size-threshold N] [benchmark...]\n";
+
+my %configs = %default_configs;
+if (@config_opts) {
+	%configs = ();
+	for (@config_opts) {
+		my($name, $flags) = /^([^=]+)=(.*)$/ or die "--config $_: expected NAME=FLAGS\n";
+		$configs{$name} = $flags;
+	}
+}
+
+my @benchmarks = @ARGV ? @ARGV :
+	sort grep { my @c = glob("$_/*.c"); @c } grep { -d } glob("$FindBin::Bin/*");
+
+my $build_dir = "$FindBin::Bin/build";
+my %results;
+my $failed = 0;
+
+for my $config (sort keys %configs) {
+	for my $bench_dir (@benchmarks) {
+		my $bench = basename($bench_dir);
+		my $result = run_benchmark($config, $configs{$config}, $bench_dir);
+		if ($result) {
+			$results{$config}{$bench} = $result;
+		}
+		else {
+			$failed = 1;
+		}
+	}
+}
+
+my $baseline = -f $baseline_file ? read_json($baseline_file) : {};
+my $regressed = compare($baseline, \%results);
+
+if ($update) {
+	# keep the baseline of the configurations and benchmarks that were not run
+	for my $config (keys %results) {
+		for my $bench (keys %{$results{$config}}) {
+			$baseline->{$config}{$bench} = $results{$config}{$bench};
+		}
+	}
+	write_json($baseline_file, $baseline);
+	say "Baseline written to $baseline_file";
+	exit($failed);
+}
+exit($failed || $regressed ? 1 : 0);
+
+#------------------------------------------------------------------------------
+# build and run one benchmark, return { functions => { name => {...} }, total => {...} }
+sub run_benchmark {
+	my($config, $flags, $bench_dir) = @_;
+	my $bench = basename($bench_dir);
+	my @sources = map { abs_path($_) } sort glob("$bench_dir/*.c");
+	my $dir = "$build_dir/$config";
+	my $bin = "$dir/$bench.bin";
+	(my $map = $bin) =~ s/\.bin$/.map/;
+	(my $folded = $bin) =~ s/\.bin$/.folded/;
+
+	make_path($dir);
+	unlink($bin, $map, $folded);
+	if (!run("zcc +test -vn $flags $cflags @sources -o $bin -m")) {
+		say "$config/$bench: build failed";
+		return;
+	}
+	if (!run("z88dk-ticks -w 30 -x $map -profile $folded $bin > $dir/$bench.out")) {
+		say "$config/$bench: run failed, see $dir/$bench.out";
+		return;
+	}
+
+	my $functions = read_map($map, \@sources);
+	my %cycles = read_folded($folded);
+	my $total = { cycles => 0, size => 0 };
+	for my $name (keys %$functions) {
+		$functions->{$name}{cycles} = $cycles{$name} // 0;
+		$total->{size} += $functions->{$name}{size};
+	}
+	$total->{cycles} = $cycles{''} // 0;
+
+	return { total => $total, functions => $functions };
+}
+
+sub run {
+	my($cmd) = @_;
+	return system($cmd) == 0;
+}
+
+#------------------------------------------------------------------------------
+# functions defined in the sources and their code size, from the map file
+# lines like:
+# _fill = $01DE ; addr, public, , module, code_compiler, /path/sort.c::fill::0::1:18
+sub read_map {
+	my($map, $sources) = @_;
+	my %is_source = map { $_ => 1 } @$sources;
+	my(%functions, %bounds, %module_start, %tail);
+
+	open(my $fh, "<", $map) or die "$map: $!\n";
+	while (<$fh>) {
+		my($name, $value, $type, $module, $section, $location) =
+			/^(\S+)\s*=\s*\$([0-9A-F]+)\s*;\s*(\w+),\s*\w*,\s*\w*,\s*(\S*),\s*(\S*),\s*(.*?)\s*$/i
+			or next;
+		$value = hex($value);
+		if ($name =~ /^__(\w+)_tail$/ && $type eq 'const') {
+			$tail{$1} = $value;
+			next;
+		}
+		next unless $type eq 'addr' && $section =~ /^code_/;
+
+		# the first label of each module in the section ends the previous module
+		my $key = "$section $module";
+		$module_start{$key} = $value
+			if !defined($module_start{$key}) || $value < $module_start{$key};
+
+		# C functions: the label is the function named in its location,
+		# local labels may carry the wrong function name
+		my($file, $function) = $location =~ /^(.*?)::(\w+)::/ or next;
+		next unless $name eq "_$function";
+		push @{$bounds{$section}}, $value;
+		if ($is_source{$file} || $is_source{abs_path($file) // ''}) {
+			$functions{$name} = { section => $section, address => $value };
+		}
+	}
+	close($fh);
+
+	for (keys %module_start) {
+		my($section) = split ' ';
+		push @{$bounds{$section}}, $module_start{$_};
+	}
+	for (keys %tail) {
+		push @{$bounds{$_}}, $tail{$_} if $bounds{$_};
+	}
+
+	for my $name (keys %functions) {
+		my $f = $functions{$name};
+		my($end) = sort { $a <=> $b } grep { $_ > $f->{address} } @{$bounds{$f->{section}}};
+		$functions{$name} = { size => defined($end) ? $end - $f->{address} : 0 };
+	}
+	return \%functions;
+}
+
+# cycles of each function including the functions it calls, '' is the whole program
+# lines like: $0000;_main;_fill 58
+sub read_folded {
+	my($folded) = @_;
+	my %cycles;
+
+	open(my $fh, "<", $folded) or die "$folded: $!\n";
+	while (<$fh>) {
+		my($stack, $count) = /^(.*) (\d+)$/ or next;
+		my %seen;
+		for my $frame (split /;/, $stack) {
+			$frame =~ s/[+@].*//;				# offset and bank
+			$cycles{$frame} += $count unless $seen{$frame}++;
+		}
+		$cycles{''} += $count;
+	}
+	close($fh);
+	return %cycles;
+}
+
+#------------------------------------------------------------------------------
+# print the changes against the baseline, return true if something got worse
+sub compare {
+	my($baseline, $results) = @_;
+	my $regressed = 0;
+
+	for my $config (sort keys %$results) {
+		for my $bench (sort keys %{$results->{$config}}) {
+			my $new = $results->{$config}{$bench};
+			my $old = $baseline->{$config}{$bench};
+			my @names = ('', sort keys %{$new->{functions}});
+
+			say "$config/$bench:";
+			for my $name (@names) {
+				my $n = $name eq '' ? $new->{total} : $new->{functions}{$name};
+				my $o = !$old ? undef : $name eq '' ? $old->{total} : $old->{functions}{$name};
+				my $line = sprintf("  %-24s", $name eq '' ? "(total)" : $name);
+				my $line_worse = 0;
+				for (['cycles', $cycles_threshold], ['size', $size_threshold]) {
+					my($metric, $threshold) = @$_;
+					my($text, $worse) = delta($n->{$metric}, $o ? $o->{$metric} : undef, $threshold);
+					$line .= sprintf(" %6s %10d %-10s", $metric, $n->{$metric}, $text);
+					$line_worse ||= $worse;
+				}
+				$line .= " REGRESSION" if $line_worse;
+				$regressed ||= $line_worse;
+				say $line =~ s/\s+$//r;
+			}
+		}
+	}
+	return $regressed;
+}
+
+sub delta {
+	my($new, $old, $threshold) = @_;
+	return ("(new)", 0) unless defined $old;
+	return ("", 0) if $new == $old;
+	my $percent = $old ? 100 * ($new - $old) / $old : 100;
+	return (sprintf("(%+.1f%%)", $percent), $percent > $threshold);
+}
+
+#------------------------------------------------------------------------------
+sub read_json {
+	my($file) = @_;
+	open(my $fh, "<", $file) or die "$file: $!\n";
+	local $/;
+	my $json = <$fh>;
+	close($fh);
+	return JSON::PP->new->decode($json);
+}
+
+sub write_json {
+	my($file, $data) = @_;
+	open(my $fh, ">", $file) or die "$file: $!\n";
+	print $fh JSON::PP->new->canonical->pretty->encode($data);
+	close($fh);
+}
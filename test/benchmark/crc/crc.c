@@ -0,0 +1,47 @@
+/*
+ * CRC-16/CCITT and a 32 bit checksum over a buffer, bit operations
+ * and long arithmetic
+ */
+
+#define SIZE  1024
+
+static unsigned char buffer[SIZE];
+
+unsigned int crc16(unsigned char *data, int n)
+{
+    unsigned int crc = 0xffff;
+    int i;
+
+    while (n--) {
+        crc ^= (unsigned int)*data++ << 8;
+        for (i = 0; i < 8; i++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+unsigned long adler32(unsigned char *data, int n)
+{
+    unsigned long a = 1, b = 0;
+
+    while (n--) {
+        a = (a + *data++) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+int main(void)
+{
+    int i;
+
+    for (i = 0; i < SIZE; i++) {
+        buffer[i] = i * 7;
+    }
+    return crc16(buffer, SIZE) == 0 || adler32(buffer, SIZE) == 0;
+}
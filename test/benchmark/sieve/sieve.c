@@ -0,0 +1,33 @@
+/*
+ * Sieve of Eratosthenes, the classic byte array and loop benchmark
+ */
+
+#include <string.h>
+
+#define SIZE      8190
+#define EXPECTED  1899
+
+static unsigned char flags[SIZE + 1];
+
+int sieve(void)
+{
+    int i, k, prime, count;
+
+    count = 0;
+    memset(flags, 1, sizeof(flags));
+    for (i = 0; i <= SIZE; i++) {
+        if (flags[i]) {
+            prime = i + i + 3;
+            for (k = i + prime; k <= SIZE; k += prime) {
+                flags[k] = 0;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(void)
+{
+    return sieve() != EXPECTED;
+}
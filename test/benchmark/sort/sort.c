@@ -0,0 +1,93 @@
+/*
+ * Sorting of an int array: insertion sort and a recursive quicksort,
+ * exercising array indexing, comparisons and calls
+ */
+
+#define SIZE  256
+
+static int data[SIZE];
+static unsigned int seed = 1;
+
+static int next_random(void)
+{
+    seed = seed * 25173 + 13849;
+    return seed & 0x7fff;
+}
+
+void fill(int *array, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        array[i] = next_random();
+    }
+}
+
+void insertion_sort(int *array, int n)
+{
+    int i, j, value;
+
+    for (i = 1; i < n; i++) {
+        value = array[i];
+        for (j = i - 1; j >= 0 && array[j] > value; j--) {
+            array[j + 1] = array[j];
+        }
+        array[j + 1] = value;
+    }
+}
+
+void quick_sort(int *array, int lo, int hi)
+{
+    int i, j, pivot, tmp;
+
+    while (lo < hi) {
+        pivot = array[(lo + hi) / 2];
+        i = lo;
+        j = hi;
+        while (i <= j) {
+            while (array[i] < pivot) i++;
+            while (array[j] > pivot) j--;
+            if (i <= j) {
+                tmp = array[i];
+                array[i] = array[j];
+                array[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (j - lo < hi - i) {
+            quick_sort(array, lo, j);
+            lo = i;
+        } else {
+            quick_sort(array, i, hi);
+            hi = j;
+        }
+    }
+}
+
+int is_sorted(int *array, int n)
+{
+    int i;
+
+    for (i = 1; i < n; i++) {
+        if (array[i - 1] > array[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void)
+{
+    int res = 0;
+
+    fill(data, SIZE);
+    insertion_sort(data, SIZE);
+    res += !is_sorted(data, SIZE);
+
+    fill(data, SIZE);
+    quick_sort(data, 0, SIZE - 1);
+    res += !is_sorted(data, SIZE);
+
+    return res;
+}
@@ -56,8 +56,12 @@ void test_long_division()
 void test_long_mod()
 {
      int32_t val = -1;
-     Assert( val % 2           == 1, "val % 2");
-     Assert( val % 4           == 1, "val % 4");
+     Assert( val % 2           == -1, "val % 2");
+     Assert( val % 4           == -1, "val % 4");
+     val = -300;
+     Assert( val % 128         == -44, "-300 % 128");
+     Assert( val % 256         == -44, "-300 % 256");
+     Assert( val % 512         == -300, "-300 % 512");
 }
 
 void test_signed_division()
@@ -77,13 +81,17 @@ void test_signed_mod()
 {
     int16_t val = -1;
 
-    Assert( val % 2  == 1, "-1 % 2");
+    Assert( val % 2  == -1, "-1 % 2");
     Assert( val % -4  == -1, "-1 % -4");
-    Assert( val % 8  == 1, "-1 % 8");
+    Assert( val % 8  == -1, "-1 % 8");
     Assert( val % -16  == -1, "-1 % -16");
     Assert( -val % -32  == 1, " 1 % -32");
     Assert( -val % 64  == 1, " 1 % 64");
     Assert( -val % -128  == 1, " 1 % -128");
+    val = -300;
+    Assert( val % 4  == 0, "-300 % 4");
+    Assert( val % 256  == -44, "-300 % 256");
+    Assert( val % 512  == -300, "-300 % 512");
 }
 
 
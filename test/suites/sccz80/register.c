@@ -0,0 +1,155 @@
+#include "test.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* In register_frameix.c */
+extern int call_frameix(int (*func)(int), int arg);
+
+
+static int by_param(register int n)
+{
+    int s = 0;
+    while ( n )
+        s += n--;
+    return s;
+}
+
+static int by_local(int n)
+{
+    register int i;
+    int s = 0;
+    for ( i = 0; i < n; i++ )
+        s += i;
+    return s;
+}
+
+static int char_local(int n)
+{
+    register unsigned char c = n;
+    return c + 1;
+}
+
+static int nested_break(int n)
+{
+    int s = 0, j;
+    for ( j = 0; j < n; j++ ) {
+        register int k = j * 2;
+        if ( k > 10 ) break;
+        if ( k == 4 ) continue;
+        s += k;
+    }
+    return s;
+}
+
+static int nested_return(int n)
+{
+    int a = 1;
+    {
+        int b = 2;
+        {
+            register char c = n;
+            if ( c ) return c + a + b;
+        }
+    }
+    return a;
+}
+
+static int forward_goto(int n)
+{
+    int r = 0;
+    {
+        register int g = n;
+        if ( g > 3 ) goto out;
+        r = g;
+    }
+    r += 100;
+out:
+    return r;
+}
+
+static int backward_goto(int n)
+{
+    int r = 0;
+again:
+    {
+        register int g = n--;
+        r += g;
+        if ( g > 0 ) goto again;
+    }
+    return r;
+}
+
+static int long_helper(register int i)
+{
+    long l = 70000;
+    l = l * i;
+    return l / 7000;
+}
+
+static int recursive_helper(register int n)
+{
+    long l;
+    if ( n == 0 ) return 0;
+    l = (long)recursive_helper(n - 1) * 1000;
+    return l / 1000 + n;
+}
+
+void test_param()
+{
+    assertEqual(55, call_frameix(by_param, 10));
+}
+
+void test_local()
+{
+    assertEqual(45, call_frameix(by_local, 10));
+    assertEqual(1, call_frameix(char_local, 256));
+}
+
+void test_break_continue()
+{
+    assertEqual(26, call_frameix(nested_break, 10));
+}
+
+void test_nested_return()
+{
+    assertEqual(8, call_frameix(nested_return, 5));
+    assertEqual(1, call_frameix(nested_return, 0));
+}
+
+void test_goto()
+{
+    assertEqual(102, call_frameix(forward_goto, 2));
+    assertEqual(0, call_frameix(forward_goto, 9));
+    assertEqual(10, call_frameix(backward_goto, 4));
+}
+
+void test_helper()
+{
+    assertEqual(30, call_frameix(long_helper, 3));
+    assertEqual(10, call_frameix(recursive_helper, 4));
+}
+
+
+int suite_register()
+{
+    suite_setup("Register Variable Tests");
+
+    suite_add_test(test_param);
+    suite_add_test(test_local);
+    suite_add_test(test_break_continue);
+    suite_add_test(test_nested_return);
+    suite_add_test(test_goto);
+    suite_add_test(test_helper);
+
+    return suite_run();
+}
+
+
+int main(int argc, char *argv[])
+{
+    int  res = 0;
+
+    res += suite_register();
+
+    exit(res);
+}
@@ -0,0 +1,21 @@
+/* Built with -frameix, so ix is the frame pointer of this file's functions
+   and has to survive the calls into register.c */
+
+#include "test.h"
+
+static int get_ix(void) __naked
+{
+#asm
+    push    ix
+    pop     hl
+    ret
+#endasm
+}
+
+int call_frameix(int (*func)(int), int arg)
+{
+    int ix = get_ix();
+    int ret = func(arg);
+    assertEqual(ix, get_ix());
+    return ret;
+}
@@ -0,0 +1,43 @@
+#include <string.h>
+
+struct pos {
+    int x, y, z;
+};
+
+char buf[300];
+struct pos p, q;
+
+void clear_small(void)
+{
+    memset(buf, 0, 3);
+}
+
+void clear_line(void)
+{
+    memset(buf, ' ', 32);
+}
+
+void clear_all(void)
+{
+    memset(buf, 0, sizeof(buf));
+}
+
+void fill(char c)
+{
+    memset(buf, c, 10);
+}
+
+void copy_pos(void)
+{
+    memcpy(&p, &q, sizeof(p));
+}
+
+void copy_line(char *dst)
+{
+    memcpy(dst, buf, 2);
+}
+
+void copy_all(char *dst, char *src)
+{
+    memcpy(dst, src, sizeof(buf));
+}
@@ -0,0 +1,53 @@
+/* Multiply, divide and modulus by constants */
+
+unsigned int mult9(unsigned int v) {
+   return v * 9;
+}
+
+int mult_minus3(int v) {
+   return v * -3;
+}
+
+unsigned int mult100(unsigned int v) {
+   return v * 100;
+}
+
+long mult131072(long v) {
+   return v * 131072L;
+}
+
+long mult16777216(long v) {
+   return v * 16777216L;
+}
+
+int div1024(int v) {
+   return v / 1024;
+}
+
+unsigned int udiv4096(unsigned int v) {
+   return v / 4096;
+}
+
+long div1048576(long v) {
+   return v / 1048576L;
+}
+
+int mod8(int v) {
+   return v % 8;
+}
+
+unsigned int umod512(unsigned int v) {
+   return v % 512;
+}
+
+unsigned long umod1024(unsigned long v) {
+   return v % 1024;
+}
+
+long mod10(long v) {
+   return v % 10;
+}
+
+unsigned char ucdiv10(unsigned char v) {
+   return v / 10;
+}
@@ -0,0 +1,36 @@
+
+
+/* A jump table in user assembler after jp (hl) must be kept */
+
+int dispatch(int n)
+{
+#asm
+    pop     bc
+    pop     hl
+    push    hl
+    push    bc
+    ld      h,0
+    add     hl,hl
+    add     hl,hl
+    ld      de,table
+    add     hl,de
+    jp      (hl)
+table:
+    jp      case0
+    nop
+    jp      case1
+    nop
+case0:
+    ld      hl,10
+    ret
+case1:
+    ld      hl,20
+    ret
+#endasm
+}
+
+int dispatch_asm(int n)
+{
+    asm("\tjp\t(hl)\n\tjp\tcase2\n\tjp\tcase3\n");
+    return n;
+}
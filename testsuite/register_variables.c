@@ -0,0 +1,49 @@
+/* register locals and parameters kept in ix */
+
+extern int func(int a);
+
+int sum_bytes(register unsigned char *p, int n) {
+   int s = 0;
+   while ( n-- )
+      s += *p++;
+   return s;
+}
+
+void fill(char *d, int n) {
+   register char c = 'A';
+   while ( n-- )
+      *d++ = c++;
+}
+
+int across_call(void) {
+   register int i;
+   int t = 0;
+   for ( i = 0; i < 10; i++ )
+      t += func(i);
+   return t;
+}
+
+long across_helper(register int i) {
+   long l = 100000;
+   l = l * i;
+   return l + i;
+}
+
+int only_first(void) {
+   register int a = 1;
+   register int b = 2;
+   return a + b;
+}
+
+int scoped(void) {
+   int r = 0;
+   {
+      register unsigned char u = 200;
+      r += u;
+   }
+   {
+      register int v = 300;
+      r += v;
+   }
+   return r;
+}
@@ -0,0 +1,143 @@
+/* Linear, jump table, binary search and compare tree switches */
+
+int int_linear(int v) {
+   switch ( v ) {
+   case 1:
+      return 1;
+   case 100:
+      return 2;
+   case 1000:
+      return 3;
+   }
+   return 0;
+}
+
+int int_table(int v) {
+   switch ( v ) {
+   case -2:
+      return 1;
+   case -1:
+      return 2;
+   case 0:
+      return 3;
+   case 1:
+      return 4;
+   case 3:
+      return 5;
+   }
+   return 0;
+}
+
+int int_bsearch(int v) {
+   switch ( v ) {
+   case -5000:
+      return 1;
+   case -300:
+      return 2;
+   case -7:
+      return 3;
+   case 0:
+      return 4;
+   case 2:
+      return 5;
+   case 9:
+      return 6;
+   case 40:
+      return 7;
+   case 77:
+      return 8;
+   case 100:
+      return 9;
+   case 512:
+      return 10;
+   case 1000:
+      return 11;
+   case 2048:
+      return 12;
+   case 4096:
+      return 13;
+   case 9999:
+      return 14;
+   case 20000:
+      return 15;
+   case 32767:
+      return 16;
+   }
+   return 0;
+}
+
+int char_table(unsigned char v) {
+   switch ( v ) {
+   case 97:
+      return 1;
+   case 98:
+      return 2;
+   case 99:
+      return 3;
+   case 100:
+      return 4;
+   case 101:
+      return 5;
+   case 102:
+      return 6;
+   case 103:
+      return 7;
+   case 104:
+      return 8;
+   case 105:
+      return 9;
+   case 106:
+      return 10;
+   case 107:
+      return 11;
+   case 108:
+      return 12;
+   case 109:
+      return 13;
+   case 110:
+      return 14;
+   case 111:
+      return 15;
+   case 112:
+      return 16;
+   }
+   return 0;
+}
+
+int char_tree(char v) {
+   switch ( v ) {
+   case -100:
+      return 1;
+   case -50:
+      return 2;
+   case -2:
+      return 3;
+   case 0:
+      return 4;
+   case 1:
+      return 5;
+   case 3:
+      return 6;
+   case 8:
+      return 7;
+   case 10:
+      return 8;
+   case 20:
+      return 9;
+   case 32:
+      return 10;
+   case 48:
+      return 11;
+   case 64:
+      return 12;
+   case 80:
+      return 13;
+   case 96:
+      return 14;
+   case 112:
+      return 15;
+   case 127:
+      return 16;
+   }
+   return 0;
+}